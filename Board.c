@@ -0,0 +1,69 @@
+/*
+ * Board.c
+ *
+ *  3x3 game state as one 9-bit occupancy mask per tile.
+ */
+
+#include "Board.h"
+
+// *********** Win Table *********** //
+// The eight lines as masks: rows, columns, then the two diagonals.
+#define ROW_0 0x007
+#define ROW_1 0x038
+#define ROW_2 0x1C0
+#define COL_0 0x049
+#define COL_1 0x092
+#define COL_2 0x124
+#define DIAG_0 0x111		// Cells 0, 4, 8
+#define DIAG_1 0x054		// Cells 2, 4, 6
+
+#define HAS(m, line) (((m) & (line)) == (line))
+#define WIN(m) (HAS(m, ROW_0) || HAS(m, ROW_1) || HAS(m, ROW_2) \
+		|| HAS(m, COL_0) || HAS(m, COL_1) || HAS(m, COL_2) \
+		|| HAS(m, DIAG_0) || HAS(m, DIAG_1))
+
+#define WIN4(m) WIN(m), WIN((m) + 1), WIN((m) + 2), WIN((m) + 3)
+#define WIN16(m) WIN4(m), WIN4((m) + 4), WIN4((m) + 8), WIN4((m) + 12)
+#define WIN64(m) WIN16(m), WIN16((m) + 16), WIN16((m) + 32), WIN16((m) + 48)
+#define WIN256(m) WIN64(m), WIN64((m) + 64), WIN64((m) + 128), WIN64((m) + 192)
+
+const u8 Board_WinTable[1 << BOARD_CELLS] = { WIN256(0), WIN256(256) };
+
+void Board_Clear(Board *board)
+{
+	board->tiles[0] = 0;
+	board->tiles[1] = 0;
+}
+
+int Board_Place(Board *board, int tile, int cell)
+{
+	if ((tile != BOARD_X && tile != BOARD_O) || cell < 0 || cell >= BOARD_CELLS
+			|| (BOARD_OCCUPIED(board) & BOARD_CELL_BIT(cell)))
+	{
+		return 0;
+	}
+	board->tiles[tile - 1] |= BOARD_CELL_BIT(cell);
+	return 1;
+}
+
+int Board_TileAt(const Board *board, int cell)
+{
+	if (board->tiles[0] & BOARD_CELL_BIT(cell))
+	{
+		return BOARD_X;
+	}
+	if (board->tiles[1] & BOARD_CELL_BIT(cell))
+	{
+		return BOARD_O;
+	}
+	return BOARD_EMPTY;
+}
+
+int Board_Result(const Board *board, int tile)
+{
+	if (BOARD_IS_WIN(board->tiles[tile - 1]))
+	{
+		return tile;
+	}
+	return BOARD_IS_FULL(board) ? BOARD_RESULT_DRAW : BOARD_RESULT_PLAYING;
+}
@@ -0,0 +1,58 @@
+/*
+ * Board.h
+ *
+ *  3x3 game state as one 9-bit occupancy mask per tile.
+ *
+ *  Cell row * 3 + col is bit (row * 3 + col) of a mask. Whether a mask holds
+ *  a line is one lookup in Board_WinTable, which the preprocessor expands at
+ *  compile time; a draw is both masks covering BOARD_FULL_MASK. Positions
+ *  can be evaluated as often as a search or replay needs without touching
+ *  the cells one by one.
+ */
+
+#ifndef SRC_BOARD_H_
+#define SRC_BOARD_H_
+
+#include "xil_types.h"
+
+// Tiles; match X_TILE and O_TILE in tictactoe.c
+#define BOARD_EMPTY 0
+#define BOARD_X 1
+#define BOARD_O 2
+
+#define BOARD_CELLS 9
+#define BOARD_FULL_MASK 0x1FF
+#define BOARD_CELL_BIT(cell) (1 << (cell))
+
+// Results of Board_Result besides the winning tile
+#define BOARD_RESULT_PLAYING -1
+#define BOARD_RESULT_DRAW 0
+
+typedef struct Board {
+	u16 tiles[2];		// Occupancy of BOARD_X ([0]) and BOARD_O ([1])
+} Board;
+
+// Non-zero for every mask that contains a row, column or diagonal.
+extern const u8 Board_WinTable[1 << BOARD_CELLS];
+
+#define BOARD_IS_WIN(mask) (Board_WinTable[(mask)])
+#define BOARD_OCCUPIED(board) ((board)->tiles[0] | (board)->tiles[1])
+#define BOARD_IS_FULL(board) (BOARD_OCCUPIED(board) == BOARD_FULL_MASK)
+
+// Empties the board.
+void Board_Clear(Board *board);
+
+// Puts tile (BOARD_X or BOARD_O) in cell.
+// Return: 1 if placed, 0 if the cell is taken or out of range or tile is
+// neither.
+int Board_Place(Board *board, int tile, int cell);
+
+// Return: the tile in cell, or BOARD_EMPTY.
+int Board_TileAt(const Board *board, int cell);
+
+// Result after tile has moved; only tile can have just completed a line.
+// Return: tile if it has a line, BOARD_RESULT_DRAW if the board is full,
+// otherwise BOARD_RESULT_PLAYING.
+int Board_Result(const Board *board, int tile);
+
+#endif /* SRC_BOARD_H_ */
@@ -0,0 +1,163 @@
+/*
+ * Engine.c
+ *
+ *  k-in-a-row on a width x height board, stored as one packed bitboard per
+ *  tile.
+ */
+
+#include <string.h>
+#include "Engine.h"
+
+#define BIT_TEST(words, i) (((words)[(i) >> 5] >> ((i) & 31)) & 1)
+
+static void Engine_ShiftRight(u32 *out, const u32 *in, int words, int bits);
+
+int Engine_Initialize(Engine *engine, int width, int height, int k)
+{
+	if (width < 1 || width > ENGINE_MAX_WIDTH || height < 1 || height > ENGINE_MAX_HEIGHT
+			|| k < 1 || (k > width && k > height))
+	{
+		return 0;
+	}
+	engine->width = width;
+	engine->height = height;
+	engine->k = k;
+	engine->stride = width + 1;
+	engine->words = (height * engine->stride + 31) / 32;
+	Engine_Clear(engine);
+	return 1;
+}
+
+void Engine_Clear(Engine *engine)
+{
+	memset(engine->tiles, 0, sizeof(engine->tiles));
+	engine->moves = 0;
+}
+
+int Engine_Cell(const Engine *engine, int row, int col)
+{
+	return row * engine->stride + col;
+}
+
+int Engine_Place(Engine *engine, int tile, int cell)
+{
+	if ((tile != ENGINE_X && tile != ENGINE_O) || cell < 0 || cell >= engine->height * engine->stride
+			|| cell % engine->stride == engine->width
+			|| BIT_TEST(engine->tiles[0], cell) || BIT_TEST(engine->tiles[1], cell))
+	{
+		return 0;
+	}
+	engine->tiles[tile - 1][cell >> 5] |= (u32) 1 << (cell & 31);
+	engine->moves++;
+	return 1;
+}
+
+int Engine_TileAt(const Engine *engine, int cell)
+{
+	if (BIT_TEST(engine->tiles[0], cell))
+	{
+		return ENGINE_X;
+	}
+	if (BIT_TEST(engine->tiles[1], cell))
+	{
+		return ENGINE_O;
+	}
+	return ENGINE_EMPTY;
+}
+
+/*
+ * Counts tile's run through cell in each direction. The empty column and the
+ * range check stop a walk at every edge of the board.
+ */
+int Engine_IsWinAt(const Engine *engine, int tile, int cell)
+{
+	const u32 *b = engine->tiles[tile - 1];
+	int end = engine->height * engine->stride;
+	int steps[4] = { 1, engine->stride, engine->stride + 1, engine->stride - 1 };
+
+	for (int dir = 0; dir < 4; dir++)
+	{
+		int d = steps[dir];
+		int run = 1;
+
+		for (int i = cell + d; run < engine->k && i < end && BIT_TEST(b, i); i += d)
+		{
+			run++;
+		}
+		for (int i = cell - d; run < engine->k && i >= 0 && BIT_TEST(b, i); i -= d)
+		{
+			run++;
+		}
+		if (run >= engine->k)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// *********** Shift-and-AND Kernels *********** //
+/*
+ * out = in >> bits over the first words words; bits shifted in from past the
+ * end are zero. Each output word takes its bits from at most two input words.
+ */
+static void Engine_ShiftRight(u32 *out, const u32 *in, int words, int bits)
+{
+	int skip = bits >> 5;
+	int s = bits & 31;
+
+	for (int i = 0; i < words; i++)
+	{
+		u32 lo = i + skip < words ? in[i + skip] : 0;
+		u32 hi = i + skip + 1 < words ? in[i + skip + 1] : 0;
+		out[i] = s == 0 ? lo : (lo >> s) | (hi << (32 - s));
+	}
+}
+
+/*
+ * For each direction, ANDs the bitboard with itself shifted one step k - 1
+ * times: after j rounds a bit is left where a run of j + 1 starts. Stops
+ * early once no run is left.
+ */
+int Engine_HasLine(const Engine *engine, int tile)
+{
+	const u32 *b = engine->tiles[tile - 1];
+	int steps[4] = { 1, engine->stride, engine->stride + 1, engine->stride - 1 };
+	u32 run[ENGINE_WORDS];
+	u32 shifted[ENGINE_WORDS];
+
+	for (int dir = 0; dir < 4; dir++)
+	{
+		u32 any = 0;
+
+		for (int i = 0; i < engine->words; i++)
+		{
+			run[i] = b[i];
+			any |= b[i];
+		}
+		for (int j = 1; j < engine->k && any != 0; j++)
+		{
+			Engine_ShiftRight(shifted, run, engine->words, steps[dir]);
+			any = 0;
+			for (int i = 0; i < engine->words; i++)
+			{
+				run[i] &= shifted[i];
+				any |= run[i];
+			}
+		}
+		if (any != 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int Engine_Result(const Engine *engine, int tile, int cell)
+{
+	if (Engine_IsWinAt(engine, tile, cell))
+	{
+		return tile;
+	}
+	return engine->moves == engine->width * engine->height ? ENGINE_RESULT_DRAW : ENGINE_RESULT_PLAYING;
+}
@@ -0,0 +1,78 @@
+/*
+ * Engine.h
+ *
+ *  k-in-a-row on a width x height board (3x3/3 tic-tac-toe, 7x6/4, 15x15/5
+ *  gomoku, ...), stored as one packed bitboard per tile.
+ *
+ *  Cell (row, col) is bit row * stride + col, with stride = width + 1. The
+ *  extra column is always empty, so a run that leaves the board on one side
+ *  never continues on the next row. A line of k in direction d (1 across,
+ *  stride down, stride + 1 and stride - 1 diagonally) exists when
+ *
+ *		B & (B >> d) & (B >> 2d) & ... & (B >> (k - 1)d)
+ *
+ *  is not zero. Engine_HasLine evaluates that for all four directions with
+ *  word-wide shifts and ANDs, 32 cells per operation. Engine_IsWinAt is the
+ *  scalar fallback for the usual case of checking the move just made: it
+ *  walks at most 2(k - 1) cells per direction, whatever the board size.
+ */
+
+#ifndef SRC_ENGINE_H_
+#define SRC_ENGINE_H_
+
+#include "xil_types.h"
+
+// Largest board
+#define ENGINE_MAX_WIDTH 15
+#define ENGINE_MAX_HEIGHT 15
+#define ENGINE_WORDS ((ENGINE_MAX_HEIGHT * (ENGINE_MAX_WIDTH + 1) + 31) / 32)
+
+// Tiles, as in Board.h
+#define ENGINE_EMPTY 0
+#define ENGINE_X 1
+#define ENGINE_O 2
+
+// Results of Engine_Result besides the winning tile
+#define ENGINE_RESULT_PLAYING -1
+#define ENGINE_RESULT_DRAW 0
+
+typedef struct Engine {
+	u8 width;
+	u8 height;
+	u8 k;
+	u8 stride;				// width + 1
+	u8 words;				// Words of tiles[] in use
+	u16 moves;				// Tiles on the board
+	u32 tiles[2][ENGINE_WORDS];	// Bitboards of ENGINE_X ([0]) and ENGINE_O ([1])
+} Engine;
+
+// Sets up an empty width x height board where k in a row wins.
+// Return: 1, or 0 if the sizes are out of range (k must fit on the board).
+int Engine_Initialize(Engine *engine, int width, int height, int k);
+
+// Empties the board.
+void Engine_Clear(Engine *engine);
+
+// Return: the bit index of (row, col); cells are numbered by this index.
+int Engine_Cell(const Engine *engine, int row, int col);
+
+// Puts tile (ENGINE_X or ENGINE_O) in cell.
+// Return: 1 if placed, 0 if the cell is taken or not on the board or tile is
+// neither.
+int Engine_Place(Engine *engine, int tile, int cell);
+
+// Return: the tile in cell, or ENGINE_EMPTY.
+int Engine_TileAt(const Engine *engine, int cell);
+
+// Checks whether tile has k in a row through cell (scalar).
+int Engine_IsWinAt(const Engine *engine, int tile, int cell);
+
+// Checks whether tile has k in a row anywhere (shift-and-AND kernels).
+int Engine_HasLine(const Engine *engine, int tile);
+
+// Result after tile has moved to cell.
+// Return: tile if that move made a line, ENGINE_RESULT_DRAW if the board is
+// full, otherwise ENGINE_RESULT_PLAYING.
+int Engine_Result(const Engine *engine, int tile, int cell);
+
+#endif /* SRC_ENGINE_H_ */
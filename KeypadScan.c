@@ -0,0 +1,179 @@
+/*
+ * KeypadScan.c
+ *
+ *  Timer-driven PmodKYPD scanner with per-key debouncing and a queue of key
+ *  press and release events.
+ */
+
+#include "KeypadScan.h"
+#include "Timebase.h"
+
+#ifdef XPAR_TMRCTR_0_BASEADDR
+#include "xtmrctr_l.h"
+#define KEYPADSCAN_TIMER 1		// Timer 0 is the Timebase.
+#endif
+
+#define KEYPADSCAN_KEYS 16
+
+// *********** Event Queue *********** //
+// Single producer (KeypadScan_Tick, usually in the timer interrupt), single
+// consumer (KeypadScan_Poll). Same scheme as the PmodBLE receive ring: free
+// running indices, each side writes only its own.
+#define QUEUE_MASK (KEYPADSCAN_QUEUE_LEN - 1)
+#define QUEUE_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+static KeypadScan_Event queue[KEYPADSCAN_QUEUE_LEN];
+static volatile u32 queue_head = 0;		// Written by KeypadScan_Tick.
+static volatile u32 queue_tail = 0;		// Written by KeypadScan_Poll.
+static volatile u32 queue_dropped = 0;
+
+// *********** Scanner State *********** //
+static PmodKYPD *scan_kypd = NULL;
+static u16 stable_keys = 0;					// Debounced state, one bit per key.
+static u8 lockout_scans[KEYPADSCAN_KEYS];	// Scans left before a key may change again.
+static int timer_scanning = 0;
+static u32 next_scan = 0;					// For KeypadScan_Service.
+
+static void KeypadScan_Queue(u8 key, u8 pressed, u32 timestamp);
+
+void KeypadScan_Initialize(PmodKYPD *kypd)
+{
+	scan_kypd = kypd;
+	stable_keys = 0;
+	for (int i = 0; i < KEYPADSCAN_KEYS; i++)
+	{
+		lockout_scans[i] = 0;
+	}
+	queue_head = 0;
+	queue_tail = 0;
+	queue_dropped = 0;
+	timer_scanning = 0;
+	next_scan = Timebase_Ticks();
+}
+
+/*
+ * Programs timer 1 to count down from one scan period, reload and interrupt.
+ */
+void KeypadScan_StartTimer()
+{
+#ifdef XPAR_TMRCTR_0_BASEADDR
+	XTmrCtr_SetLoadReg(XPAR_TMRCTR_0_BASEADDR, KEYPADSCAN_TIMER,
+			KEYPADSCAN_PERIOD_US * TIMEBASE_TICKS_PER_US - 2);
+	XTmrCtr_LoadTimerCounterReg(XPAR_TMRCTR_0_BASEADDR, KEYPADSCAN_TIMER);
+	XTmrCtr_SetControlStatusReg(XPAR_TMRCTR_0_BASEADDR, KEYPADSCAN_TIMER,
+			XTC_CSR_ENABLE_TMR_MASK | XTC_CSR_ENABLE_INT_MASK | XTC_CSR_AUTO_RELOAD_MASK | XTC_CSR_DOWN_COUNT_MASK);
+	timer_scanning = 1;
+#endif
+}
+
+void KeypadScan_TimerHandler(void *CallbackRef)
+{
+#ifdef XPAR_TMRCTR_0_BASEADDR
+	// Writing the interrupt bit back clears it.
+	u32 csr = XTmrCtr_GetControlStatusReg(XPAR_TMRCTR_0_BASEADDR, KEYPADSCAN_TIMER);
+	XTmrCtr_SetControlStatusReg(XPAR_TMRCTR_0_BASEADDR, KEYPADSCAN_TIMER, csr | XTC_CSR_INT_OCCURED_MASK);
+#endif
+	KeypadScan_Tick();
+}
+
+/*
+ * Adds an event to the queue; the event is dropped if the queue is full.
+ */
+static void KeypadScan_Queue(u8 key, u8 pressed, u32 timestamp)
+{
+	u32 head = queue_head;
+
+	if (head - queue_tail == KEYPADSCAN_QUEUE_LEN)
+	{
+		queue_dropped++;
+		return;
+	}
+
+	KeypadScan_Event *event = &queue[head & QUEUE_MASK];
+	event->timestamp = timestamp;
+	event->key = key;
+	event->pressed = pressed;
+
+	QUEUE_BARRIER();	// Publish the event before the new head.
+	queue_head = head + 1;
+}
+
+/*
+ * Scans the matrix once. A key that reads differently from its debounced
+ * state flips at once and the flip is queued as a press or release; the key
+ * then ignores its contacts for KEYPADSCAN_DEBOUNCE_SCANS scans while they
+ * bounce.
+ */
+void KeypadScan_Tick()
+{
+	if (scan_kypd == NULL)
+	{
+		return;
+	}
+
+	u16 raw = KYPD_getKeyStates(scan_kypd);
+	u16 differ = raw ^ stable_keys;
+	u32 now = Timebase_Ticks();
+
+	for (int i = 0; i < KEYPADSCAN_KEYS; i++)
+	{
+		if (lockout_scans[i] > 0)
+		{
+			lockout_scans[i]--;
+			continue;
+		}
+		if (!(differ & (1 << i)))
+		{
+			continue;
+		}
+
+		lockout_scans[i] = KEYPADSCAN_DEBOUNCE_SCANS;
+		stable_keys ^= 1 << i;
+		KeypadScan_Queue(scan_kypd->keytable[i], (stable_keys >> i) & 1, now);
+	}
+}
+
+void KeypadScan_Service()
+{
+	if (timer_scanning || !Timebase_Expired(next_scan))
+	{
+		return;
+	}
+	next_scan = Timebase_Deadline(KEYPADSCAN_PERIOD_US);
+	KeypadScan_Tick();
+}
+
+int KeypadScan_Poll(KeypadScan_Event *event)
+{
+	u32 tail = queue_tail;
+
+	if (queue_head == tail)
+	{
+		return 0;
+	}
+	QUEUE_BARRIER();	// Read the event only after seeing the head that covers it.
+
+	*event = queue[tail & QUEUE_MASK];
+
+	QUEUE_BARRIER();
+	queue_tail = tail + 1;
+	return 1;
+}
+
+int KeypadScan_Wait(KeypadScan_Event *event, u32 deadline)
+{
+	while (!KeypadScan_Poll(event))
+	{
+		if (Timebase_Expired(deadline))
+		{
+			return 0;
+		}
+		KeypadScan_Service();
+	}
+	return 1;
+}
+
+u32 KeypadScan_Dropped()
+{
+	return queue_dropped;
+}
@@ -0,0 +1,65 @@
+/*
+ * KeypadScan.h
+ *
+ *  Timer-driven PmodKYPD scanner with per-key debouncing and a queue of key
+ *  press and release events.
+ *
+ *  KeypadScan_Tick scans the whole matrix once. It runs from the timer 1
+ *  interrupt of the AXI Timer (see KeypadScan_StartTimer), or, without the
+ *  interrupt, from KeypadScan_Service in the main loop. A key's press or
+ *  release is queued on the first scan that sees it; the key then ignores
+ *  its contacts for KEYPADSCAN_DEBOUNCE_SCANS scans, so contact bounce never
+ *  produces extra events. Keys are debounced on their own, so a key pressed
+ *  before the previous one is released (rollover) is still reported.
+ */
+
+#ifndef SRC_KEYPADSCAN_H_
+#define SRC_KEYPADSCAN_H_
+
+#include "xil_types.h"
+#include "PmodKYPD.h"
+
+// Scan period and debounce
+#define KEYPADSCAN_PERIOD_US 1000
+#define KEYPADSCAN_DEBOUNCE_SCANS 4
+
+// Event queue length; must be a power of two.
+#define KEYPADSCAN_QUEUE_LEN 16
+
+// One key event; timestamp is in Timebase ticks.
+typedef struct KeypadScan_Event {
+	u32 timestamp;
+	u8 key;			// Character from the keypad's key table
+	u8 pressed;		// 1 for a press, 0 for a release
+} KeypadScan_Event;
+
+// Starts scanning kypd (already set up with KYPD_begin / KYPD_loadKeyTable)
+// with every key released and the queue empty.
+void KeypadScan_Initialize(PmodKYPD *kypd);
+
+// Makes timer 1 of the AXI Timer interrupt every KEYPADSCAN_PERIOD_US.
+// KeypadScan_TimerHandler must already be connected to the timer interrupt.
+void KeypadScan_StartTimer();
+
+// AXI Timer interrupt handler; acknowledges the timer and scans once.
+void KeypadScan_TimerHandler(void *CallbackRef);
+
+// Scans the matrix once and queues the debounced changes.
+void KeypadScan_Tick();
+
+// Scans if a period has passed since the last scan; does nothing while the
+// timer interrupt is scanning. Never waits.
+void KeypadScan_Service();
+
+// Takes the oldest event.
+// Return: 1 if *event was filled, 0 if the queue is empty.
+int KeypadScan_Poll(KeypadScan_Event *event);
+
+// Waits for the next event until the Timebase deadline.
+// Return: 1 if *event was filled, 0 if the deadline passed first.
+int KeypadScan_Wait(KeypadScan_Event *event, u32 deadline);
+
+// Number of events dropped because the queue was full.
+u32 KeypadScan_Dropped();
+
+#endif /* SRC_KEYPADSCAN_H_ */
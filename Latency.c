@@ -0,0 +1,127 @@
+/*
+ * Latency.c
+ *
+ *  Timestamp probes at the stage boundaries of a move, and fixed-bucket
+ *  latency histograms kept in RAM.
+ */
+
+#include <string.h>
+#include "Latency.h"
+
+u32 Latency_Marks[LATENCY_MARKS];
+
+static Latency_Histogram histograms[LATENCY_SPANS];
+
+static const char *const span_names[LATENCY_SPANS] = {
+	"key_to_tx",
+	"key_to_drawn",
+	"rx_to_drawn",
+	"cmd_enter",
+	"cmd_exit",
+	"connect",
+};
+
+static int Latency_PutString(char *out, const char *s);
+static int Latency_PutNumber(char *out, u32 value);
+
+void Latency_Reset()
+{
+	memset(histograms, 0, sizeof(histograms));
+}
+
+/*
+ * The bucket is the bit length of the latency in microseconds.
+ */
+void Latency_Record(int span, u32 ticks)
+{
+	Latency_Histogram *hist = &histograms[span];
+	u32 us = Timebase_TicksToUs(ticks);
+	int bucket = 0;
+
+	while (bucket < LATENCY_BUCKETS - 1 && (us >> bucket) != 0)
+	{
+		bucket++;
+	}
+	hist->buckets[bucket]++;
+	hist->count++;
+	hist->total_us += us;
+	if (us > hist->max_us)
+	{
+		hist->max_us = us;
+	}
+}
+
+const Latency_Histogram *Latency_Get(int span)
+{
+	return &histograms[span];
+}
+
+// *********** Dump *********** //
+static int Latency_PutString(char *out, const char *s)
+{
+	int len = strlen(s);
+
+	memcpy(out, s, len);
+	return len;
+}
+
+static int Latency_PutNumber(char *out, u32 value)
+{
+	char digits[10];
+	int n = 0;
+
+	do
+	{
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+
+	for (int i = 0; i < n; i++)
+	{
+		out[i] = digits[n - 1 - i];
+	}
+	return n;
+}
+
+/*
+ * Each line is "<span> <count> <average us> <most us>" and then the bucket
+ * counts, a line at a time so that no more than one line is buffered.
+ *
+ * Input:
+ * 		sink - Takes each line, e.g. a send on the system UART.
+ * Output:
+ * 		Number of bytes written.
+ */
+int Latency_Dump(void (*sink)(const u8 *bytes, int count))
+{
+	// Longest line: the name, three numbers and the buckets, 11 characters each.
+	char line[16 + (3 + LATENCY_BUCKETS) * 11 + 2];
+	int total = 0;
+
+	int len = Latency_PutString(line, "span count avg_us max_us buckets\r\n");
+	sink((const u8 *) line, len);
+	total += len;
+
+	for (int span = 0; span < LATENCY_SPANS; span++)
+	{
+		const Latency_Histogram *hist = &histograms[span];
+
+		len = Latency_PutString(line, span_names[span]);
+		line[len++] = ' ';
+		len += Latency_PutNumber(&line[len], hist->count);
+		line[len++] = ' ';
+		len += Latency_PutNumber(&line[len], hist->count ? hist->total_us / hist->count : 0);
+		line[len++] = ' ';
+		len += Latency_PutNumber(&line[len], hist->max_us);
+		for (int b = 0; b < LATENCY_BUCKETS; b++)
+		{
+			line[len++] = ' ';
+			len += Latency_PutNumber(&line[len], hist->buckets[b]);
+		}
+		line[len++] = '\r';
+		line[len++] = '\n';
+		sink((const u8 *) line, len);
+		total += len;
+	}
+	return total;
+}
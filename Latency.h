@@ -0,0 +1,85 @@
+/*
+ * Latency.h
+ *
+ *  Timestamp probes at the stage boundaries of a move, and fixed-bucket
+ *  latency histograms kept in RAM.
+ *
+ *  A probe is either a mark, which stores the Timebase tick count for its
+ *  stage (one timer read and one store), or a span, which adds the time
+ *  since a mark to a histogram. Spans are only taken where a stage ends, so
+ *  the bucket search stays off the hot paths. A mark keeps its time until it
+ *  is taken again; a span must only follow the mark it measures from.
+ *
+ *  Histogram buckets are powers of two in microseconds: bucket 0 holds 0 us,
+ *  bucket b 2^(b-1) us up to 2^b us, and the last bucket everything longer.
+ *
+ *  The two boards have separate clocks, so a move's latency across the link
+ *  is measured in halves: key to transmit (and key to drawn) on the board
+ *  that moved, receive to drawn on the other one.
+ */
+
+#ifndef SRC_LATENCY_H_
+#define SRC_LATENCY_H_
+
+#include "xil_types.h"
+#include "Timebase.h"
+
+// Probes; 0 compiles them out.
+#ifndef LATENCY_PROBES
+#define LATENCY_PROBES 1
+#endif
+
+// Buckets per histogram
+#define LATENCY_BUCKETS 24
+
+// Marks
+#define LATENCY_MARK_KEY 0			// Key press seen by the scanner
+#define LATENCY_MARK_RX 1			// Move from the other board decoded
+#define LATENCY_MARK_CMD_ENTER 2	// Command mode entry started
+#define LATENCY_MARK_CMD_EXIT 3		// Command mode exit started
+#define LATENCY_MARK_CONNECT 4		// Connect attempt started
+#define LATENCY_MARKS 5
+
+// Spans, one histogram each
+#define LATENCY_KEY_TO_TX 0			// Our move handed to the PmodBLE UART
+#define LATENCY_KEY_TO_DRAWN 1		// Our move on our panel
+#define LATENCY_RX_TO_DRAWN 2		// The other board's move on our panel
+#define LATENCY_CMD_ENTER 3			// Guard time, "$$$" and the prompt
+#define LATENCY_CMD_EXIT 4			// "---" and "END"
+#define LATENCY_CONNECT 5			// Connect command to "%CONNECT%"
+#define LATENCY_SPANS 6
+
+typedef struct Latency_Histogram {
+	u32 buckets[LATENCY_BUCKETS];
+	u32 count;
+	u32 max_us;
+	u32 total_us;
+} Latency_Histogram;
+
+// Tick counts of the marks; written by the probes.
+extern u32 Latency_Marks[LATENCY_MARKS];
+
+#if LATENCY_PROBES
+#define LATENCY_MARK(mark) (Latency_Marks[mark] = Timebase_Ticks())
+#define LATENCY_MARK_AT(mark, ticks) (Latency_Marks[mark] = (ticks))
+#define LATENCY_SPAN(span, mark) Latency_Record(span, Timebase_Ticks() - Latency_Marks[mark])
+#else
+#define LATENCY_MARK(mark) do {} while (0)
+#define LATENCY_MARK_AT(mark, ticks) do {} while (0)
+#define LATENCY_SPAN(span, mark) do {} while (0)
+#endif
+
+// Empties every histogram.
+void Latency_Reset();
+
+// Adds a latency of ticks Timebase ticks to the span's histogram.
+void Latency_Record(int span, u32 ticks);
+
+// Histogram of a span.
+const Latency_Histogram *Latency_Get(int span);
+
+// Writes the histograms as text, one line per span, to sink.
+// Return: number of bytes written.
+int Latency_Dump(void (*sink)(const u8 *bytes, int count));
+
+#endif /* SRC_LATENCY_H_ */
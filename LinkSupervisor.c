@@ -0,0 +1,113 @@
+/*
+ * LinkSupervisor.c
+ *
+ *  Keeps the PmodBLE link to the other board up and the MoveLink exchange in
+ *  step across link losses.
+ */
+
+#include <string.h>
+#include "LinkSupervisor.h"
+#include "Timebase.h"
+
+#if PMODBLE_LOG_LEVEL >= PMODBLE_LOG_INFO
+#define LINK_INFO(...) xil_printf(__VA_ARGS__)
+#else
+#define LINK_INFO(...) do {} while (0)
+#endif
+
+static void LinkSupervisor_Down(LinkSupervisor *sup);
+static void LinkSupervisor_Up(LinkSupervisor *sup);
+
+void LinkSupervisor_Initialize(LinkSupervisor *sup, MoveLink *link, const u8 *address)
+{
+	memset(sup, 0, sizeof(*sup));
+	sup->ble = link->ble;
+	sup->link = link;
+	memcpy(sup->address, address, sizeof(sup->address) - 1);
+	sup->backoff_us = LINKSUPERVISOR_BACKOFF_MIN_US;
+	sup->retry_at = Timebase_Ticks();
+	sup->down_since = sup->retry_at;
+	sup->state = PmodBLE_Interface_IsConnected(sup->ble) ? LINKSUPERVISOR_UP : LINKSUPERVISOR_DOWN;
+}
+
+void LinkSupervisor_InitializeDialer(LinkSupervisor *sup, PmodBLE_Interface_t *ble, const u8 *address)
+{
+	memset(sup, 0, sizeof(*sup));
+	sup->ble = ble;
+	sup->dial = 1;
+	memcpy(sup->address, address, sizeof(sup->address) - 1);
+	sup->backoff_us = LINKSUPERVISOR_BACKOFF_MIN_US;
+	sup->retry_at = Timebase_Ticks();
+	sup->down_since = sup->retry_at;
+	sup->state = PmodBLE_Interface_IsConnected(sup->ble) ? LINKSUPERVISOR_UP : LINKSUPERVISOR_DOWN;
+}
+
+static void LinkSupervisor_Down(LinkSupervisor *sup)
+{
+	sup->state = LINKSUPERVISOR_DOWN;
+	sup->disconnects++;
+	sup->down_since = Timebase_Ticks();
+	sup->backoff_us = LINKSUPERVISOR_BACKOFF_MIN_US;
+	sup->retry_at = Timebase_Deadline(LINKSUPERVISOR_BACKOFF_MIN_US);
+	LINK_INFO("Link lost; reconnecting\r\n");
+}
+
+static void LinkSupervisor_Up(LinkSupervisor *sup)
+{
+	sup->state = LINKSUPERVISOR_UP;
+	sup->connects++;
+	sup->last_outage_us = Timebase_TicksToUs(Timebase_Ticks() - sup->down_since);
+	PmodBLE_Interface_TakeStatusToken(sup->ble);		// The loss is dealt with.
+	if (sup->link != NULL)
+	{
+		MoveLink_Resync(sup->link);
+	}
+	LINK_INFO("Link back after %d us\r\n", (int) sup->last_outage_us);
+}
+
+int LinkSupervisor_Run(LinkSupervisor *sup)
+{
+	if (sup->state == LINKSUPERVISOR_UP)
+	{
+		// The status comes in with the data; the pin catches a loss while
+		// nothing is being read.
+		if (PmodBLE_Interface_TakeStatusToken(sup->ble) == PMODBLE_TOKEN_DISCONNECT
+				|| !PmodBLE_Interface_IsConnected(sup->ble))
+		{
+			LinkSupervisor_Down(sup);
+			return 0;
+		}
+		return 1;
+	}
+
+	// The other board may have reconnected to us.
+	if (PmodBLE_Interface_IsConnected(sup->ble))
+	{
+		LinkSupervisor_Up(sup);
+		return 1;
+	}
+	if (!Timebase_Expired(sup->retry_at))
+	{
+		return 0;
+	}
+
+	// As the peripheral there is nothing to attempt; check again after the
+	// shortest backoff.
+	int status = sup->dial ? PmodBLE_Interface_ConnectTo(sup->ble, sup->address)
+			: PmodBLE_Interface_ConnectPeer(sup->ble, sup->address);
+	if (status == PMODBLE_STATUS_CONNECTING)
+	{
+		sup->retry_at = Timebase_Deadline(LINKSUPERVISOR_BACKOFF_MIN_US);
+		return 0;
+	}
+	sup->attempts++;
+	if (status == PMODBLE_STATUS_CONNECTED)
+	{
+		LinkSupervisor_Up(sup);
+		return 1;
+	}
+	sup->retry_at = Timebase_Deadline(sup->backoff_us);
+	sup->backoff_us = sup->backoff_us * 2 > LINKSUPERVISOR_BACKOFF_MAX_US
+			? LINKSUPERVISOR_BACKOFF_MAX_US : sup->backoff_us * 2;
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * LinkSupervisor.h
+ *
+ *  Keeps the PmodBLE link to the other board up and the MoveLink exchange in
+ *  step across link losses.
+ *
+ *  LinkSupervisor_Run is an event handler for the main loop. While the link
+ *  is up it watches for a "%DISCONNECT%" status and checks
+ *  PmodBLE_IsConnected. Once the link is down it reconnects, waiting
+ *  LINKSUPERVISOR_BACKOFF_MIN_US after the loss and twice as long after each
+ *  failed attempt, up to LINKSUPERVISOR_BACKOFF_MAX_US. If the other board
+ *  connects first, that counts as well. When the link is back,
+ *  MoveLink_Resync exchanges sequence numbers so that only the moves lost
+ *  while it was down are sent again.
+ *
+ *  Only the board PmodBLE_ConnectPeer makes the central dials; the
+ *  peripheral keeps advertising and waits to be connected. A connect attempt
+ *  waits in PmodBLE_ConnectTo for the module's answer (see
+ *  CONN_TO_DEVICE_TIMEOUT_US); the keypad keeps being scanned by its timer
+ *  interrupt meanwhile.
+ *
+ *  A board watching a game (see Spectators.h) supervises its link with
+ *  LinkSupervisor_InitializeDialer: the watched board's seats only advertise,
+ *  so it always dials, and there is no move exchange to resync.
+ */
+
+#ifndef SRC_LINKSUPERVISOR_H_
+#define SRC_LINKSUPERVISOR_H_
+
+#include "xil_types.h"
+#include "MoveLink.h"
+#include "PmodBLE_Interface.h"
+
+// Reconnect backoff
+#define LINKSUPERVISOR_BACKOFF_MIN_US 250000
+#define LINKSUPERVISOR_BACKOFF_MAX_US 8000000
+
+// States
+#define LINKSUPERVISOR_UP 0
+#define LINKSUPERVISOR_DOWN 1
+
+typedef struct LinkSupervisor {
+	PmodBLE_Interface_t *ble;
+	MoveLink *link;			// Resynced after each reconnect; NULL if none
+	int dial;				// Set: always dial, whatever the addresses say
+	u8 address[12 + 1];		// Other board's PmodBLE address, NUL-terminated for the connect command
+	int state;
+	u32 backoff_us;			// Wait before the next attempt after this one fails
+	u32 retry_at;			// Timebase deadline of the next attempt
+	u32 down_since;			// Timebase ticks at the loss
+
+	// Statistics
+	u32 disconnects;
+	u32 attempts;			// Connect attempts; the peripheral makes none
+	u32 connects;			// The first connection included
+	u32 last_outage_us;		// From noticing the loss to the resync
+} LinkSupervisor;
+
+// Starts supervising the link to address (12 characters, no NUL needed) for
+// link, on link's PmodBLE instance. A link that is already up counts as up; otherwise the first attempt
+// is made on the first run.
+void LinkSupervisor_Initialize(LinkSupervisor *sup, MoveLink *link, const u8 *address);
+
+// Starts supervising ble's link to address, which only advertises; this
+// board dials every time.
+void LinkSupervisor_InitializeDialer(LinkSupervisor *sup, PmodBLE_Interface_t *ble, const u8 *address);
+
+// Checks the link and, while it is down, reconnects when the backoff allows.
+// Return: 1 while the link is up, 0 while it is down.
+int LinkSupervisor_Run(LinkSupervisor *sup);
+
+#endif /* SRC_LINKSUPERVISOR_H_ */
@@ -0,0 +1,232 @@
+/*
+ * Mcts.c
+ *
+ *  Monte Carlo tree search opponent for ultimate tic-tac-toe.
+ */
+
+#include <math.h>
+#include "Mcts.h"
+#include "Timebase.h"
+
+static u32 Mcts_Random(Mcts *mcts);
+static int Mcts_Select(const Mcts *mcts, int node);
+static int Mcts_Expand(Mcts *mcts, int node, const Ultimate *game);
+static int Mcts_Playout(Mcts *mcts, Ultimate *game);
+static void Mcts_Iterate(Mcts *mcts);
+
+int Mcts_Initialize(Mcts *mcts, Mcts_Node *pool, int pool_nodes, u32 seed)
+{
+	mcts->nodes = pool;
+	mcts->max_nodes = pool_nodes < MCTS_MIN_POOL ? 0 : pool_nodes > MCTS_MAX_POOL ? MCTS_MAX_POOL : pool_nodes;
+	mcts->used = 0;
+	mcts->rng = seed != 0 ? seed : 0x9E3779B9;
+	mcts->ticks = Timebase_Ticks;
+	mcts->ticks_per_us = TIMEBASE_TICKS_PER_US;
+	mcts->playouts = 0;
+	mcts->search_us = 0;
+	Ultimate_Initialize(&mcts->root);
+	return mcts->max_nodes != 0;
+}
+
+void Mcts_SetClock(Mcts *mcts, u32 (*ticks)(void), u32 ticks_per_us)
+{
+	mcts->ticks = ticks;
+	mcts->ticks_per_us = ticks_per_us;
+}
+
+static u32 Mcts_Random(Mcts *mcts)
+{
+	u32 x = mcts->rng;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	mcts->rng = x;
+	return x;
+}
+
+void Mcts_Begin(Mcts *mcts, const Ultimate *root)
+{
+	mcts->root = *root;
+	mcts->playouts = 0;
+	mcts->search_us = 0;
+	if (mcts->max_nodes == 0)
+	{
+		return;		// No pool; see Mcts_Initialize.
+	}
+
+	Mcts_Node *node = &mcts->nodes[0];
+	mcts->used = 1;
+
+	node->visits = 0;
+	node->score = 0;
+	node->parent = MCTS_NO_NODE;
+	node->first_child = MCTS_NO_NODE;
+	node->num_children = 0;
+	node->move = 0;
+	node->tile = root->to_move == BOARD_X ? BOARD_O : BOARD_X;
+}
+
+/*
+ * Picks the child of node with the highest UCT value; a child that has not
+ * been visited yet is taken first.
+ */
+static int Mcts_Select(const Mcts *mcts, int node)
+{
+	const Mcts_Node *parent = &mcts->nodes[node];
+	float log_visits = logf((float) parent->visits);
+	float best_value = -1.0f;
+	int best = parent->first_child;
+
+	for (int i = 0; i < parent->num_children; i++)
+	{
+		const Mcts_Node *child = &mcts->nodes[parent->first_child + i];
+		if (child->visits == 0)
+		{
+			return parent->first_child + i;
+		}
+		float value = child->score / (2.0f * child->visits)
+				+ MCTS_EXPLORATION * sqrtf(log_visits / child->visits);
+		if (value > best_value)
+		{
+			best_value = value;
+			best = parent->first_child + i;
+		}
+	}
+	return best;
+}
+
+/*
+ * Adds a child for every legal move of game (the position at node).
+ *
+ * Output:
+ * 		Number of children added; 0 if the pool has no room for all of them.
+ */
+static int Mcts_Expand(Mcts *mcts, int node, const Ultimate *game)
+{
+	u8 moves[ULTIMATE_MOVES];
+	int n = Ultimate_Moves(game, moves);
+
+	if (n == 0 || mcts->used + n > mcts->max_nodes)
+	{
+		return 0;
+	}
+
+	mcts->nodes[node].first_child = mcts->used;
+	mcts->nodes[node].num_children = n;
+	for (int i = 0; i < n; i++)
+	{
+		Mcts_Node *child = &mcts->nodes[mcts->used++];
+		child->visits = 0;
+		child->score = 0;
+		child->parent = node;
+		child->first_child = MCTS_NO_NODE;
+		child->num_children = 0;
+		child->move = moves[i];
+		child->tile = game->to_move;
+	}
+	return n;
+}
+
+/*
+ * Plays random legal moves to the end of the game.
+ *
+ * Output:
+ * 		The result: the winning tile or BOARD_RESULT_DRAW.
+ */
+static int Mcts_Playout(Mcts *mcts, Ultimate *game)
+{
+	u8 moves[ULTIMATE_MOVES];
+
+	while (game->result == BOARD_RESULT_PLAYING)
+	{
+		int n = Ultimate_Moves(game, moves);
+		Ultimate_Play(game, moves[Mcts_Random(mcts) % n]);
+	}
+	return game->result;
+}
+
+static void Mcts_Iterate(Mcts *mcts)
+{
+	Ultimate game = mcts->root;
+	int node = 0;
+
+	// Selection
+	while (mcts->nodes[node].num_children > 0)
+	{
+		node = Mcts_Select(mcts, node);
+		Ultimate_Play(&game, mcts->nodes[node].move);
+	}
+
+	// Expansion, once a leaf has been played out from before
+	if (game.result == BOARD_RESULT_PLAYING && (node == 0 || mcts->nodes[node].visits > 0)
+			&& Mcts_Expand(mcts, node, &game) > 0)
+	{
+		node = mcts->nodes[node].first_child + Mcts_Random(mcts) % mcts->nodes[node].num_children;
+		Ultimate_Play(&game, mcts->nodes[node].move);
+	}
+
+	// Playout and backpropagation
+	int result = Mcts_Playout(mcts, &game);
+	while (node != MCTS_NO_NODE)
+	{
+		Mcts_Node *n = &mcts->nodes[node];
+		n->visits++;
+		n->score += result == n->tile ? 2 : result == BOARD_RESULT_DRAW ? 1 : 0;
+		node = n->parent;
+	}
+	mcts->playouts++;
+}
+
+u32 Mcts_Run(Mcts *mcts, u32 budget_us, u32 max_playouts)
+{
+	u32 start = mcts->ticks();
+	u32 budget = budget_us * mcts->ticks_per_us;
+	u32 elapsed = 0;
+	u32 n = 0;
+
+	if (mcts->root.result != BOARD_RESULT_PLAYING || mcts->used == 0)
+	{
+		return 0;
+	}
+
+	while ((max_playouts == 0 || n < max_playouts) && elapsed < budget)
+	{
+		Mcts_Iterate(mcts);
+		n++;
+		elapsed = mcts->ticks() - start;
+	}
+	mcts->search_us += elapsed / mcts->ticks_per_us;
+	return n;
+}
+
+int Mcts_BestMove(const Mcts *mcts)
+{
+	u32 best_visits = 0;
+	int best = -1;
+
+	if (mcts->used == 0)
+	{
+		return -1;
+	}
+
+	const Mcts_Node *root = &mcts->nodes[0];
+
+	for (int i = 0; i < root->num_children; i++)
+	{
+		const Mcts_Node *child = &mcts->nodes[root->first_child + i];
+		if (child->visits > best_visits)
+		{
+			best_visits = child->visits;
+			best = child->move;
+		}
+	}
+	return best;
+}
+
+int Mcts_Search(Mcts *mcts, const Ultimate *root, u32 budget_us, u32 max_playouts)
+{
+	Mcts_Begin(mcts, root);
+	Mcts_Run(mcts, budget_us, max_playouts);
+	return Mcts_BestMove(mcts);
+}
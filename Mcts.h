@@ -0,0 +1,86 @@
+/*
+ * Mcts.h
+ *
+ *  Monte Carlo tree search opponent for ultimate tic-tac-toe.
+ *
+ *  Each iteration walks down the tree by UCT, adds the children of the leaf
+ *  it reaches, plays the game out with random moves and adds the result to
+ *  every node on the way back up. Nodes come from a pool the caller sets
+ *  aside; once it is full the tree stops growing and the search goes on
+ *  with playouts from its leaves.
+ *
+ *  A search can run in slices: Mcts_Begin, then Mcts_Run as often as the
+ *  event loop allows, then Mcts_BestMove. Mcts_Run never runs past its time
+ *  budget by more than one playout. Time comes from the Timebase unless
+ *  Mcts_SetClock gives another tick source (a host clock, for instance).
+ *  A search touches nothing but its Mcts and its pool, so searches in
+ *  different threads do not interfere.
+ */
+
+#ifndef SRC_MCTS_H_
+#define SRC_MCTS_H_
+
+#include "xil_types.h"
+#include "Ultimate.h"
+
+#define MCTS_NO_NODE 0xFFFF
+#define MCTS_MAX_POOL 0xFFFF		// Node indices are 16 bits
+#define MCTS_MIN_POOL (1 + ULTIMATE_MOVES)	// The root and all of its children
+
+// Exploration constant of UCT (results are 0, 0.5 or 1)
+#define MCTS_EXPLORATION 1.0f
+
+typedef struct Mcts_Node {
+	u32 visits;
+	u32 score;			// 2 per win and 1 per draw for tile
+	u16 parent;
+	u16 first_child;	// Children are consecutive; MCTS_NO_NODE until expanded
+	u8 num_children;
+	u8 move;			// Move that led here
+	u8 tile;			// Tile that made it
+	u8 reserved;
+} Mcts_Node;
+
+typedef struct Mcts {
+	Mcts_Node *nodes;
+	u16 max_nodes;
+	u16 used;
+	Ultimate root;
+	u32 rng;			// xorshift32 state; never 0
+
+	// Tick source for the time budget
+	u32 (*ticks)(void);
+	u32 ticks_per_us;
+
+	// Statistics of the current search
+	u32 playouts;
+	u32 search_us;
+} Mcts;
+
+// Sets up a search that takes its nodes from pool (pool_nodes of them, at
+// most MCTS_MAX_POOL). seed starts the random playouts. A pool of fewer than
+// MCTS_MIN_POOL nodes could never expand the root; it is not used, and every
+// search finds no move.
+// Return: 1, or 0 if the pool is too small.
+int Mcts_Initialize(Mcts *mcts, Mcts_Node *pool, int pool_nodes, u32 seed);
+
+// Replaces the Timebase as the tick source of the time budget.
+void Mcts_SetClock(Mcts *mcts, u32 (*ticks)(void), u32 ticks_per_us);
+
+// Starts a new search from position root; the pool is emptied.
+void Mcts_Begin(Mcts *mcts, const Ultimate *root);
+
+// Runs iterations until budget_us has passed or, if max_playouts is not 0,
+// that many have run in this call.
+// Return: number of playouts run.
+u32 Mcts_Run(Mcts *mcts, u32 budget_us, u32 max_playouts);
+
+// Most visited move from the root so far.
+// Return: the move, or -1 if no iteration has run, the game is over or the
+// pool is too small.
+int Mcts_BestMove(const Mcts *mcts);
+
+// Mcts_Begin, Mcts_Run and Mcts_BestMove in one call.
+int Mcts_Search(Mcts *mcts, const Ultimate *root, u32 budget_us, u32 max_playouts);
+
+#endif /* SRC_MCTS_H_ */
@@ -0,0 +1,198 @@
+/*
+ * MoveLink.c
+ *
+ *  Framed binary move protocol carried over the PmodBLE link.
+ */
+
+#include <string.h>
+#include "MoveLink.h"
+#include "PmodBLE_Interface.h"
+#include "Latency.h"
+
+#define MOVELINK_HISTORY_MASK (MOVELINK_HISTORY - 1)
+
+// CRC-8 (poly 0x07) of a nibble; two lookups per byte keep the table at 16 bytes.
+static const u8 crc8_nibble[16] = {
+	0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+	0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+static void MoveLink_SendFrame(MoveLink *link, u8 type, u8 seq, u8 cell, u8 tile);
+static void MoveLink_Resend(MoveLink *link, u8 ack, int again);
+
+u8 MoveLink_Crc8(const u8 *buf, int len)
+{
+	u8 crc = 0;
+
+	for (int i = 0; i < len; i++)
+	{
+		crc ^= buf[i];
+		crc = (u8) (crc << 4) ^ crc8_nibble[crc >> 4];
+		crc = (u8) (crc << 4) ^ crc8_nibble[crc >> 4];
+	}
+	return crc;
+}
+
+void MoveLink_Encode(u8 *buf, u8 type, u8 seq, u8 ack, u8 cell, u8 tile)
+{
+	buf[0] = MOVELINK_SYNC;
+	buf[1] = type;
+	buf[2] = seq;
+	buf[3] = ack;
+	buf[4] = (cell << 4) | (tile & 0x0F);
+	buf[5] = MoveLink_Crc8(&buf[1], 4);
+}
+
+void MoveLink_Initialize(MoveLink *link)
+{
+	MoveLink_InitializeOn(link, PmodBLE_DefaultInterface());
+}
+
+void MoveLink_InitializeOn(MoveLink *link, PmodBLE_Interface_t *ble)
+{
+	memset(link, 0, sizeof(*link));
+	link->ble = ble;
+	link->tx_seq = 1;
+	link->rx_expected = 1;
+}
+
+/*
+ * Sends one frame; every frame carries the ack for the moves received so far.
+ */
+static void MoveLink_SendFrame(MoveLink *link, u8 type, u8 seq, u8 cell, u8 tile)
+{
+	u8 frame[MOVELINK_FRAME_BYTES];
+
+	MoveLink_Encode(frame, type, seq, link->rx_expected - 1, cell, tile);
+	PmodBLE_Interface_SendBuffer(link->ble, frame, MOVELINK_FRAME_BYTES);
+	link->frames_sent++;
+}
+
+void MoveLink_SendMove(MoveLink *link, u8 cell, u8 tile)
+{
+	link->history[link->tx_seq & MOVELINK_HISTORY_MASK] = (cell << 4) | tile;
+	MoveLink_SendFrame(link, MOVELINK_TYPE_MOVE, link->tx_seq, cell, tile);
+	link->tx_seq++;
+}
+
+/*
+ * Sends the moves after ack again, oldest first. Moves that have dropped out
+ * of the history cannot be recovered, so at most MOVELINK_HISTORY are sent.
+ * Unless again is set, the moves are not sent if they were the last ones
+ * resent and nothing was sent or acked since (a stale ack on a move and a
+ * SYNC after a link loss both ask for them).
+ */
+static void MoveLink_Resend(MoveLink *link, u8 ack, int again)
+{
+	if (!again && ack == link->resent_ack && link->tx_seq == link->resent_tx_seq)
+	{
+		return;
+	}
+	link->resent_ack = ack;
+	link->resent_tx_seq = link->tx_seq;
+
+	u8 missing = link->tx_seq - (u8) (ack + 1);
+	if (missing > MOVELINK_HISTORY)
+	{
+		missing = MOVELINK_HISTORY;
+	}
+
+	for (u8 seq = link->tx_seq - missing; seq != link->tx_seq; seq++)
+	{
+		u8 packed = link->history[seq & MOVELINK_HISTORY_MASK];
+		MoveLink_SendFrame(link, MOVELINK_TYPE_MOVE, seq, packed >> 4, packed & 0x0F);
+		link->resends_sent++;
+	}
+}
+
+void MoveLink_Resync(MoveLink *link)
+{
+	MoveLink_SendFrame(link, MOVELINK_TYPE_SYNC, link->tx_seq - 1, 0, 1);
+}
+
+/*
+ * Frames are decoded where they sit in the receive buffer; only a trailing
+ * partial frame is moved to the front for the next poll.
+ */
+int MoveLink_Poll(MoveLink *link, MoveLink_Move *moves, int max)
+{
+	int count = 0;
+	int idx = 0;
+
+	link->rx_len += PmodBLE_Interface_ReceiveMessage(link->ble, &link->rx_buf[link->rx_len], MOVELINK_RX_BYTES - link->rx_len);
+
+	while (link->rx_len - idx >= MOVELINK_FRAME_BYTES && count < max)
+	{
+		const u8 *frame = &link->rx_buf[idx];
+
+		// Skip anything that is not a valid frame (e.g. a "%...%" status
+		// message from the module) one byte at a time.
+		if (frame[0] != MOVELINK_SYNC)
+		{
+			idx++;
+			continue;
+		}
+		if (MoveLink_Crc8(&frame[1], 4) != frame[5])
+		{
+			link->crc_errors++;
+			idx++;
+			continue;
+		}
+		idx += MOVELINK_FRAME_BYTES;
+		link->frames_received++;
+
+		u8 type = frame[1];
+		u8 seq = frame[2];
+		u8 ack = frame[3];
+
+		if (type == MOVELINK_TYPE_RESEND)
+		{
+			MoveLink_Resend(link, ack, 1);
+		}
+		else if (type == MOVELINK_TYPE_SYNC)
+		{
+			// Only what the peer misses goes out; the SYNC back tells it what
+			// we miss.
+			link->syncs_received++;
+			MoveLink_Resend(link, ack, 0);
+			if (frame[4] & 0x0F)
+			{
+				MoveLink_SendFrame(link, MOVELINK_TYPE_SYNC, link->tx_seq - 1, 0, 0);
+			}
+		}
+		else if (type == MOVELINK_TYPE_MOVE)
+		{
+			s8 ahead = (s8) (seq - link->rx_expected);
+
+			if (ahead == 0)
+			{
+				LATENCY_MARK(LATENCY_MARK_RX);
+				moves[count].seq = seq;
+				moves[count].cell = frame[4] >> 4;
+				moves[count].tile = frame[4] & 0x0F;
+				count++;
+				link->rx_expected++;
+				link->resend_requested = 0;
+
+				// The peer moves after seeing our last move, so an older ack
+				// means some of our moves were lost on the way.
+				if ((s8) (link->tx_seq - 1 - ack) > 0)
+				{
+					MoveLink_Resend(link, ack, 0);
+				}
+			}
+			else if (ahead > 0 && !link->resend_requested)
+			{
+				// Gap: ask for everything after our last in-order move, once.
+				MoveLink_SendFrame(link, MOVELINK_TYPE_RESEND, 0, 0, 0);
+				link->resend_requested = 1;
+			}
+			// ahead < 0: a duplicate of a move we already have.
+		}
+	}
+
+	// Keep the unparsed tail for the next poll.
+	memmove(link->rx_buf, &link->rx_buf[idx], link->rx_len - idx);
+	link->rx_len -= idx;
+	return count;
+}
@@ -0,0 +1,96 @@
+/*
+ * MoveLink.h
+ *
+ *  Framed binary move protocol carried over the PmodBLE link.
+ *
+ *  Every frame is MOVELINK_FRAME_BYTES long:
+ *
+ *		[0] MOVELINK_SYNC
+ *		[1] type
+ *		[2] seq		- sequence number of this move (MOVE) or 0
+ *		[3] ack		- last move seq received in order from the peer
+ *		[4] cell << 4 | tile
+ *		[5] CRC-8 (poly 0x07) of bytes 1..4
+ *
+ *  Acks ride on the next move, so a move exchange costs one frame each way.
+ *  A receiver that sees a sequence gap asks for a resend from its last
+ *  in-order move; only the missing moves are sent again.
+ *
+ *  After the link was lost, one side sends a SYNC with its last sent seq and
+ *  its ack; the other resends what the ack misses and answers with its own
+ *  SYNC, which does the same the other way. A resync costs two frames plus
+ *  the moves that were lost.
+ */
+
+#ifndef SRC_MOVELINK_H_
+#define SRC_MOVELINK_H_
+
+#include "xil_types.h"
+#include "PmodBLE_Interface.h"
+
+// Frame Layout
+#define MOVELINK_FRAME_BYTES 6
+#define MOVELINK_SYNC 0xA5
+
+// Frame Types
+#define MOVELINK_TYPE_MOVE 1
+#define MOVELINK_TYPE_RESEND 2		// Resend every move after ack
+#define MOVELINK_TYPE_SYNC 3		// Resend every move after ack; [4] is 1 to ask for a SYNC back
+
+// Sent moves kept for resends; must be a power of two.
+#define MOVELINK_HISTORY 16
+
+// Receive buffer; holds at least one partial frame plus a BLE read.
+#define MOVELINK_RX_BYTES 64
+
+// One decoded move.
+typedef struct MoveLink_Move {
+	u8 seq;
+	u8 cell;	// 0..8, row * 3 + col
+	u8 tile;	// X_TILE or O_TILE
+} MoveLink_Move;
+
+typedef struct MoveLink {
+	PmodBLE_Interface_t *ble;	// Module the frames go through
+	u8 tx_seq;					// Seq of the next move we send.
+	u8 rx_expected;				// Seq of the next move we accept.
+	u8 resend_requested;		// Non-zero while a resend for rx_expected is pending.
+	u8 resent_ack;				// ack and tx_seq of the last resend, so the
+	u8 resent_tx_seq;			// same moves are not sent twice in a row.
+	u8 history[MOVELINK_HISTORY];	// cell << 4 | tile of sent moves, by seq.
+	u8 rx_buf[MOVELINK_RX_BYTES];
+	int rx_len;
+
+	// Statistics
+	u32 frames_sent;
+	u32 frames_received;
+	u32 crc_errors;
+	u32 resends_sent;			// Moves sent again after a resend request.
+	u32 syncs_received;
+} MoveLink;
+
+// Starts a new exchange over the default PmodBLE instance; both sides must
+// agree (e.g. at game start).
+void MoveLink_Initialize(MoveLink *link);
+
+// Same, over the given PmodBLE instance.
+void MoveLink_InitializeOn(MoveLink *link, PmodBLE_Interface_t *ble);
+
+// Sends a move, with an ack for the moves received so far.
+void MoveLink_SendMove(MoveLink *link, u8 cell, u8 tile);
+
+// Asks the peer to resync after the link was lost (see above).
+void MoveLink_Resync(MoveLink *link);
+
+// Reads what the peer sent, answers resend requests, and copies out up to
+// max new in-order moves.
+// Return: number of moves copied.
+int MoveLink_Poll(MoveLink *link, MoveLink_Move *moves, int max);
+
+// Builds a frame in buf (MOVELINK_FRAME_BYTES long).
+void MoveLink_Encode(u8 *buf, u8 type, u8 seq, u8 ack, u8 cell, u8 tile);
+
+// CRC-8 (poly 0x07, init 0) of len bytes.
+u8 MoveLink_Crc8(const u8 *buf, int len);
+
+#endif /* SRC_MOVELINK_H_ */
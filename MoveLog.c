@@ -0,0 +1,166 @@
+/*
+ * MoveLog.c
+ *
+ *  Compact, append-only log of the moves of recent games, kept in a fixed
+ *  RAM ring.
+ */
+
+#include "MoveLog.h"
+
+#define RING_BITS (MOVELOG_RING_BYTES * 8)
+#define MOVE_END(bits) ((1 << (bits)) - 1)		// All ones ends a game.
+
+static void MoveLog_Write(MoveLog *log, u32 value, int bits);
+static u32 MoveLog_ReadBits(const MoveLog *log, u32 *pos, int bits);
+
+void MoveLog_Initialize(MoveLog *log)
+{
+	log->bit_head = 0;
+	log->games = 0;
+	log->bits = 0;
+	log->moves = 0;
+	log->sink = NULL;
+}
+
+void MoveLog_SetSink(MoveLog *log, void (*sink)(const u8 *bytes, int count))
+{
+	log->sink = sink;
+}
+
+// *********** Bit Packing *********** //
+/*
+ * Appends the low bits of value, LSB first, and hands each byte it completes
+ * to the sink.
+ */
+static void MoveLog_Write(MoveLog *log, u32 value, int bits)
+{
+	while (bits > 0)
+	{
+		u8 *byte = &log->ring[(log->bit_head >> 3) & (MOVELOG_RING_BYTES - 1)];
+		int used = log->bit_head & 7;
+		int take = 8 - used < bits ? 8 - used : bits;
+		u8 mask = ((1 << take) - 1) << used;
+
+		*byte = (*byte & ~mask) | ((value << used) & mask);
+		value >>= take;
+		bits -= take;
+		log->bit_head += take;
+
+		if ((log->bit_head & 7) == 0 && log->sink != NULL)
+		{
+			log->sink(byte, 1);
+		}
+	}
+}
+
+static u32 MoveLog_ReadBits(const MoveLog *log, u32 *pos, int bits)
+{
+	u32 value = 0;
+
+	for (int i = 0; i < bits; i++, (*pos)++)
+	{
+		u8 byte = log->ring[(*pos >> 3) & (MOVELOG_RING_BYTES - 1)];
+		value |= ((byte >> (*pos & 7)) & 1) << i;
+	}
+	return value;
+}
+
+// *********** Games *********** //
+void MoveLog_BeginGame(MoveLog *log, u8 variant, u8 first_tile)
+{
+	if (log->bits != 0)
+	{
+		MoveLog_EndGame(log);
+	}
+
+	log->starts[log->games % MOVELOG_GAMES] = log->bit_head;
+	MoveLog_Write(log, MOVELOG_TAG | (variant & 3) << 2 | (first_tile & 3), 8);
+	MoveLog_Write(log, log->games & 0xFF, 8);
+	log->games++;
+	log->bits = variant == MOVELOG_ULTIMATE ? MOVELOG_ULTIMATE_BITS : MOVELOG_PLAIN_BITS;
+	log->moves = 0;
+}
+
+int MoveLog_Append(MoveLog *log, u8 move)
+{
+	if (log->bits == 0 || move >= MOVE_END(log->bits) || log->moves >= MOVELOG_MAX_MOVES)
+	{
+		return 0;
+	}
+	MoveLog_Write(log, move, log->bits);
+	log->moves++;
+	return 1;
+}
+
+/*
+ * Writes the end marker and pads to a byte, so the next header starts on a
+ * byte boundary and the sink has seen the whole game.
+ */
+void MoveLog_EndGame(MoveLog *log)
+{
+	if (log->bits == 0)
+	{
+		return;
+	}
+	MoveLog_Write(log, MOVE_END(log->bits), log->bits);
+	if (log->bit_head & 7)
+	{
+		MoveLog_Write(log, 0, 8 - (log->bit_head & 7));
+	}
+	log->bits = 0;
+}
+
+/*
+ * A game is still whole while everything written since its header fits in
+ * the ring.
+ */
+int MoveLog_Read(const MoveLog *log, int back, MoveLog_Game *game, u8 *moves)
+{
+	if (back < 0 || back >= MOVELOG_GAMES || (u32) back >= log->games)
+	{
+		return -1;
+	}
+	u32 pos = log->starts[(log->games - 1 - back) % MOVELOG_GAMES];
+	if (log->bit_head - pos > RING_BITS)
+	{
+		return -1;
+	}
+
+	u32 header = MoveLog_ReadBits(log, &pos, 8);
+	game->number = MoveLog_ReadBits(log, &pos, 8);
+	game->variant = (header >> 2) & 3;
+	game->first_tile = header & 3;
+	game->ended = 1;
+	if ((header & MOVELOG_TAG_MASK) != MOVELOG_TAG)
+	{
+		return -1;
+	}
+
+	int bits = game->variant == MOVELOG_ULTIMATE ? MOVELOG_ULTIMATE_BITS : MOVELOG_PLAIN_BITS;
+	int n = 0;
+	while (n < MOVELOG_MAX_MOVES)
+	{
+		// The game in progress ends at the head, without a marker.
+		if (back == 0 && log->bits != 0 && pos + bits > log->bit_head)
+		{
+			game->ended = 0;
+			break;
+		}
+		u32 move = MoveLog_ReadBits(log, &pos, bits);
+		if (move == MOVE_END(bits))
+		{
+			break;
+		}
+		moves[n++] = move;
+	}
+	return n;
+}
+
+int MoveLog_GameBytes(const MoveLog *log)
+{
+	if (log->games == 0)
+	{
+		return 0;
+	}
+	return (log->bit_head - log->starts[(log->games - 1) % MOVELOG_GAMES] + 7) / 8;
+}
@@ -0,0 +1,89 @@
+/*
+ * MoveLog.h
+ *
+ *  Compact, append-only log of the moves of recent games, kept in a fixed
+ *  RAM ring.
+ *
+ *  Each game is a two-byte header followed by its moves, packed LSB first:
+ *
+ *		[0] MOVELOG_TAG | variant << 2 | first tile
+ *		[1] game number (mod 256)
+ *		moves, MOVELOG_PLAIN_BITS (cell 0..8) or MOVELOG_ULTIMATE_BITS
+ *		(sub-board * 9 + cell) each, then a move of all ones once the game
+ *		has ended, padded with zeros to a whole byte.
+ *
+ *  The tiles alternate from the first one, so a plain game costs at most
+ *  seven bytes. When the ring is full the oldest games are overwritten. Every
+ *  byte can also go to a sink (the system UART, for instance) as soon as it
+ *  is complete, so the same stream can be captured off the board.
+ */
+
+#ifndef SRC_MOVELOG_H_
+#define SRC_MOVELOG_H_
+
+#include "xil_types.h"
+
+// Ring size; must be a power of two and hold the longest game.
+#define MOVELOG_RING_BYTES 256
+
+// Start of the most recent games, for reading them back
+#define MOVELOG_GAMES 16
+
+// Header
+#define MOVELOG_TAG 0xB0
+#define MOVELOG_TAG_MASK 0xF0
+
+// Variants and their move sizes
+#define MOVELOG_PLAIN 0
+#define MOVELOG_ULTIMATE 1
+#define MOVELOG_PLAIN_BITS 4
+#define MOVELOG_ULTIMATE_BITS 7
+
+// Most moves in a game of any variant
+#define MOVELOG_MAX_MOVES 81
+
+// Header of a game read back from the log
+typedef struct MoveLog_Game {
+	u8 variant;
+	u8 first_tile;
+	u8 number;
+	u8 ended;		// 1 once the game's end is logged
+} MoveLog_Game;
+
+typedef struct MoveLog {
+	u8 ring[MOVELOG_RING_BYTES];
+	u32 bit_head;					// Bits written, free running
+	u32 starts[MOVELOG_GAMES];		// bit_head at each game's header, by game number
+	u32 games;						// Games begun
+	u8 bits;						// Move size of the game in progress; 0 if none
+	u8 moves;						// Moves of the game in progress
+
+	// Completed bytes go here as well, if set
+	void (*sink)(const u8 *bytes, int count);
+} MoveLog;
+
+// Empties the log.
+void MoveLog_Initialize(MoveLog *log);
+
+// Streams every byte written from now on to sink (NULL stops it).
+void MoveLog_SetSink(MoveLog *log, void (*sink)(const u8 *bytes, int count));
+
+// Starts a new game; the one in progress, if any, is ended first.
+void MoveLog_BeginGame(MoveLog *log, u8 variant, u8 first_tile);
+
+// Logs the next move of the game in progress.
+// Return: 1 if logged, 0 if no game is in progress or the move does not fit.
+int MoveLog_Append(MoveLog *log, u8 move);
+
+// Marks the end of the game in progress.
+void MoveLog_EndGame(MoveLog *log);
+
+// Reads back a game: back is 0 for the latest (possibly still in progress),
+// 1 for the one before and so on. moves must hold MOVELOG_MAX_MOVES.
+// Return: number of moves, or -1 if the game is no longer in the ring.
+int MoveLog_Read(const MoveLog *log, int back, MoveLog_Game *game, u8 *moves);
+
+// Bytes the game in progress takes so far, header included.
+int MoveLog_GameBytes(const MoveLog *log);
+
+#endif /* SRC_MOVELOG_H_ */
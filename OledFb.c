@@ -0,0 +1,364 @@
+/*
+ * OledFb.c
+ *
+ *  RGB565 framebuffer for the 96x64 PmodOLEDrgb.
+ */
+
+#include <string.h>
+#include "OledFb.h"
+
+#define RECT_AREA(rect) (((rect).c2 - (rect).c1 + 1) * ((rect).r2 - (rect).r1 + 1))
+
+static u8 stage[OLEDFB_STAGE_BYTES];
+
+static int OledFb_Clip(OledFb_Rect *rect, int c1, int r1, int c2, int r2);
+static OledFb_Rect OledFb_Union(OledFb_Rect a, OledFb_Rect b);
+static void OledFb_Plot(OledFb *fb, int c, int r, u16 color);
+static void OledFb_FlushRect(OledFb *fb, OledFb_Rect rect);
+
+void OledFb_Initialize(OledFb *fb, PmodOLEDrgb *oled)
+{
+	fb->oled = oled;
+	fb->flushes = 0;
+	fb->bytes_flushed = 0;
+	OledFb_Clear(fb);
+}
+
+void OledFb_Clear(OledFb *fb)
+{
+	memset(fb->pixels, 0, sizeof(fb->pixels));
+	fb->num_dirty = 0;
+	OLEDrgb_Clear(fb->oled);
+}
+
+// *********** Dirty Rectangles *********** //
+/*
+ * Orders the corners and clips them to the panel.
+ *
+ * Output:
+ * 		1 if some of the rectangle is on the panel, 0 if none of it is.
+ */
+static int OledFb_Clip(OledFb_Rect *rect, int c1, int r1, int c2, int r2)
+{
+	int t;
+
+	if (c1 > c2)
+	{
+		t = c1; c1 = c2; c2 = t;
+	}
+	if (r1 > r2)
+	{
+		t = r1; r1 = r2; r2 = t;
+	}
+	if (c2 < 0 || r2 < 0 || c1 >= OLEDFB_WIDTH || r1 >= OLEDFB_HEIGHT)
+	{
+		return 0;
+	}
+	rect->c1 = c1 < 0 ? 0 : c1;
+	rect->r1 = r1 < 0 ? 0 : r1;
+	rect->c2 = c2 >= OLEDFB_WIDTH ? OLEDFB_WIDTH - 1 : c2;
+	rect->r2 = r2 >= OLEDFB_HEIGHT ? OLEDFB_HEIGHT - 1 : r2;
+	return 1;
+}
+
+static OledFb_Rect OledFb_Union(OledFb_Rect a, OledFb_Rect b)
+{
+	OledFb_Rect u;
+
+	u.c1 = a.c1 < b.c1 ? a.c1 : b.c1;
+	u.r1 = a.r1 < b.r1 ? a.r1 : b.r1;
+	u.c2 = a.c2 > b.c2 ? a.c2 : b.c2;
+	u.r2 = a.r2 > b.r2 ? a.r2 : b.r2;
+	return u;
+}
+
+/*
+ * Adds a rectangle to the dirty list. It is merged with a dirty rectangle
+ * when their bounding box sends at most OLEDFB_MERGE_SLACK more pixels than
+ * the two do apart (one holds the other, they line up edge to edge, or
+ * nearly so); otherwise it gets its own entry. With the list full, it is
+ * merged with the entry whose bounding box grows the least.
+ *
+ * Input:
+ * 		fb - Framebuffer.
+ * 		c1, r1, c2, r2 - Corners, in any order; clipped to the panel.
+ */
+void OledFb_Invalidate(OledFb *fb, int c1, int r1, int c2, int r2)
+{
+	OledFb_Rect rect;
+
+	if (!OledFb_Clip(&rect, c1, r1, c2, r2))
+	{
+		return;
+	}
+
+	// A merge can make the result mergeable with another entry; keep going
+	// until it is not.
+	int i = 0;
+	while (i < fb->num_dirty)
+	{
+		OledFb_Rect u = OledFb_Union(fb->dirty[i], rect);
+		if (RECT_AREA(u) <= RECT_AREA(fb->dirty[i]) + RECT_AREA(rect) + OLEDFB_MERGE_SLACK)
+		{
+			rect = u;
+			fb->dirty[i] = fb->dirty[--fb->num_dirty];
+			i = 0;
+			continue;
+		}
+		i++;
+	}
+
+	if (fb->num_dirty < OLEDFB_MAX_DIRTY)
+	{
+		fb->dirty[fb->num_dirty++] = rect;
+		return;
+	}
+
+	int best = 0;
+	int best_growth = OLEDFB_WIDTH * OLEDFB_HEIGHT + 1;
+	for (i = 0; i < fb->num_dirty; i++)
+	{
+		int growth = RECT_AREA(OledFb_Union(fb->dirty[i], rect)) - RECT_AREA(fb->dirty[i]);
+		if (growth < best_growth)
+		{
+			best = i;
+			best_growth = growth;
+		}
+	}
+	fb->dirty[best] = OledFb_Union(fb->dirty[best], rect);
+}
+
+// *********** Drawing *********** //
+// Each primitive plots into RAM and then marks its bounding box dirty once.
+static void OledFb_Plot(OledFb *fb, int c, int r, u16 color)
+{
+	if (c >= 0 && c < OLEDFB_WIDTH && r >= 0 && r < OLEDFB_HEIGHT)
+	{
+		fb->pixels[r][2 * c] = color >> 8;
+		fb->pixels[r][2 * c + 1] = color & 0xFF;
+	}
+}
+
+u16 OledFb_GetPixel(OledFb *fb, int c, int r)
+{
+	if (c < 0 || c >= OLEDFB_WIDTH || r < 0 || r >= OLEDFB_HEIGHT)
+	{
+		return 0;
+	}
+	return (fb->pixels[r][2 * c] << 8) | fb->pixels[r][2 * c + 1];
+}
+
+void OledFb_DrawPixel(OledFb *fb, int c, int r, u16 color)
+{
+	OledFb_Plot(fb, c, r, color);
+	OledFb_Invalidate(fb, c, r, c, r);
+}
+
+/*
+ * Bresenham line, both end points included.
+ */
+void OledFb_DrawLine(OledFb *fb, int c1, int r1, int c2, int r2, u16 color)
+{
+	int x = c1, y = r1;
+	int dx = c2 > c1 ? c2 - c1 : c1 - c2, sx = c1 < c2 ? 1 : -1;
+	int dy = r2 > r1 ? r1 - r2 : r2 - r1, sy = r1 < r2 ? 1 : -1;
+	int err = dx + dy;
+
+	while (1)
+	{
+		OledFb_Plot(fb, x, y, color);
+		if (x == c2 && y == r2)
+		{
+			break;
+		}
+		int e2 = 2 * err;
+		if (e2 >= dy)
+		{
+			err += dy;
+			x += sx;
+		}
+		if (e2 <= dx)
+		{
+			err += dx;
+			y += sy;
+		}
+	}
+	OledFb_Invalidate(fb, c1, r1, c2, r2);
+}
+
+/*
+ * Midpoint circle outline.
+ */
+void OledFb_DrawCircle(OledFb *fb, int cx, int cy, int radius, u16 color)
+{
+	int x = 0;
+	int y = radius;
+	int d = 1 - radius;
+
+	while (x <= y)
+	{
+		// 8-way symmetry
+		OledFb_Plot(fb, cx + x, cy + y, color);
+		OledFb_Plot(fb, cx - x, cy + y, color);
+		OledFb_Plot(fb, cx + x, cy - y, color);
+		OledFb_Plot(fb, cx - x, cy - y, color);
+		OledFb_Plot(fb, cx + y, cy + x, color);
+		OledFb_Plot(fb, cx - y, cy + x, color);
+		OledFb_Plot(fb, cx + y, cy - x, color);
+		OledFb_Plot(fb, cx - y, cy - x, color);
+
+		if (d < 0)
+		{
+			d += 2 * x + 3;
+		}
+		else
+		{
+			d += 2 * (x - y) + 5;
+			y--;
+		}
+		x++;
+	}
+	OledFb_Invalidate(fb, cx - radius, cy - radius, cx + radius, cy + radius);
+}
+
+void OledFb_FillRect(OledFb *fb, int c1, int r1, int c2, int r2, u16 color)
+{
+	int t;
+
+	if (c1 > c2)
+	{
+		t = c1; c1 = c2; c2 = t;
+	}
+	if (r1 > r2)
+	{
+		t = r1; r1 = r2; r2 = t;
+	}
+	for (int r = r1; r <= r2; r++)
+	{
+		for (int c = c1; c <= c2; c++)
+		{
+			OledFb_Plot(fb, c, r, color);
+		}
+	}
+	OledFb_Invalidate(fb, c1, r1, c2, r2);
+}
+
+void OledFb_DrawSprite(OledFb *fb, const OledFb_Sprite *sprite, int c, int r, u16 color)
+{
+	int c0 = c + sprite->c;
+	int r0 = r + sprite->r;
+
+	for (int y = 0; y < sprite->height; y++)
+	{
+		u32 bits = sprite->rows[y];
+		for (int x = 0; bits != 0; x++, bits >>= 1)
+		{
+			if (bits & 1)
+			{
+				OledFb_Plot(fb, c0 + x, r0 + y, color);
+			}
+		}
+	}
+	OledFb_Invalidate(fb, c0, r0, c0 + sprite->width - 1, r0 + sprite->height - 1);
+}
+
+// *********** Panel Fills *********** //
+void OledFb_Erase(OledFb *fb, int c1, int r1, int c2, int r2)
+{
+	OledFb_Rect rect;
+
+	if (!OledFb_Clip(&rect, c1, r1, c2, r2))
+	{
+		return;
+	}
+	for (int r = rect.r1; r <= rect.r2; r++)
+	{
+		memset(&fb->pixels[r][2 * rect.c1], 0, 2 * (rect.c2 - rect.c1 + 1));
+	}
+	OLEDrgb_DrawRectangle(fb->oled, rect.c1, rect.r1, rect.c2, rect.r2, 0, 1, 0);
+}
+
+/*
+ * Blanks the rectangle on the panel, then marks each run of non-black pixels
+ * in each of its rows dirty. Runs in the same columns on neighbouring rows
+ * merge into one rectangle, so a grid line crossing the area costs one
+ * window write.
+ */
+void OledFb_Repaint(OledFb *fb, int c1, int r1, int c2, int r2)
+{
+	OledFb_Rect rect;
+
+	if (!OledFb_Clip(&rect, c1, r1, c2, r2))
+	{
+		return;
+	}
+	OLEDrgb_DrawRectangle(fb->oled, rect.c1, rect.r1, rect.c2, rect.r2, 0, 1, 0);
+
+	for (int r = rect.r1; r <= rect.r2; r++)
+	{
+		const u8 *row = fb->pixels[r];
+		int c = rect.c1;
+
+		while (c <= rect.c2)
+		{
+			if ((row[2 * c] | row[2 * c + 1]) == 0)
+			{
+				c++;
+				continue;
+			}
+			int start = c;
+			while (c <= rect.c2 && (row[2 * c] | row[2 * c + 1]) != 0)
+			{
+				c++;
+			}
+			OledFb_Invalidate(fb, start, r, c - 1, r);
+		}
+	}
+}
+
+// *********** Flush *********** //
+/*
+ * Sends one dirty rectangle. Full-width rows are contiguous in the
+ * framebuffer and are sent straight from it; narrower rectangles are packed
+ * into the staging buffer, as many rows per window write as fit.
+ */
+static void OledFb_FlushRect(OledFb *fb, OledFb_Rect rect)
+{
+	int row_bytes = 2 * (rect.c2 - rect.c1 + 1);
+
+	if (rect.c1 == 0 && rect.c2 == OLEDFB_WIDTH - 1)
+	{
+		OLEDrgb_DrawBitmap(fb->oled, rect.c1, rect.r1, rect.c2, rect.r2, &fb->pixels[rect.r1][0]);
+		fb->flushes++;
+		fb->bytes_flushed += row_bytes * (rect.r2 - rect.r1 + 1);
+		return;
+	}
+
+	int strip_rows = OLEDFB_STAGE_BYTES / row_bytes;
+	for (int r = rect.r1; r <= rect.r2; r += strip_rows)
+	{
+		int last = r + strip_rows - 1 < rect.r2 ? r + strip_rows - 1 : rect.r2;
+		u8 *out = stage;
+
+		for (int y = r; y <= last; y++)
+		{
+			memcpy(out, &fb->pixels[y][2 * rect.c1], row_bytes);
+			out += row_bytes;
+		}
+		OLEDrgb_DrawBitmap(fb->oled, rect.c1, r, rect.c2, last, stage);
+		fb->flushes++;
+		fb->bytes_flushed += out - stage;
+	}
+}
+
+int OledFb_Flush(OledFb *fb)
+{
+	u32 before = fb->flushes;
+
+	for (int i = 0; i < fb->num_dirty; i++)
+	{
+		OledFb_FlushRect(fb, fb->dirty[i]);
+	}
+	fb->num_dirty = 0;
+	return fb->flushes - before;
+}
@@ -0,0 +1,102 @@
+/*
+ * OledFb.h
+ *
+ *  RGB565 framebuffer for the 96x64 PmodOLEDrgb.
+ *
+ *  The drawing calls only write to RAM and record the rectangles they
+ *  changed. OledFb_Flush then sends each dirty rectangle with one window
+ *  write (OLEDrgb_DrawBitmap). A move costs one or two bulk SPI transfers
+ *  instead of a command sequence for every pixel or line.
+ *
+ *  Pixels are stored in the byte order the SSD1331 takes them, high byte
+ *  first. A rectangle as wide as the panel is already contiguous and goes
+ *  out without a copy. Narrower ones are packed into a staging buffer first,
+ *  in row strips if they do not fit in it.
+ */
+
+#ifndef SRC_OLEDFB_H_
+#define SRC_OLEDFB_H_
+
+#include "xil_types.h"
+#include "PmodOLEDrgb.h"
+
+// Panel size
+#define OLEDFB_WIDTH OLEDRGB_WIDTH
+#define OLEDFB_HEIGHT OLEDRGB_HEIGHT
+
+// Dirty rectangles kept before two are merged into their bounding box;
+// enough for every tile and mark of a board redrawn from scratch
+#define OLEDFB_MAX_DIRTY 32
+
+// Pixels a merge may add to the area sent; about what the command bytes and
+// chip-select framing of one more window write cost
+#define OLEDFB_MERGE_SLACK 8
+
+// Staging buffer for rectangles narrower than the panel; holds a whole cell
+#define OLEDFB_STAGE_BYTES 2048
+
+// Inclusive pixel rectangle
+typedef struct OledFb_Rect {
+	u8 c1, r1;
+	u8 c2, r2;
+} OledFb_Rect;
+
+// One-colour sprite up to 32 pixels wide: one u32 per row, bit n set when
+// column n (from the left edge) is inked. c and r place the sprite's top left
+// corner relative to the point it is drawn at.
+typedef struct OledFb_Sprite {
+	u8 c, r;
+	u8 width, height;
+	const u32 *rows;
+} OledFb_Sprite;
+
+typedef struct OledFb {
+	PmodOLEDrgb *oled;
+	u8 pixels[OLEDFB_HEIGHT][OLEDFB_WIDTH * 2];	// RGB565, high byte first
+	OledFb_Rect dirty[OLEDFB_MAX_DIRTY];
+	int num_dirty;
+
+	// Statistics
+	u32 flushes;			// Window writes sent
+	u32 bytes_flushed;		// Pixel bytes sent
+} OledFb;
+
+// Attaches fb to an OLED that is already set up with OLEDrgb_begin. The
+// panel is cleared so that it matches the all-black framebuffer.
+void OledFb_Initialize(OledFb *fb, PmodOLEDrgb *oled);
+
+// Clears the framebuffer and the panel to black. The panel uses its own
+// clear command, so nothing is left dirty.
+void OledFb_Clear(OledFb *fb);
+
+// Drawing; pixels outside the panel are clipped.
+void OledFb_DrawPixel(OledFb *fb, int c, int r, u16 color);
+void OledFb_DrawLine(OledFb *fb, int c1, int r1, int c2, int r2, u16 color);
+void OledFb_DrawCircle(OledFb *fb, int cx, int cy, int radius, u16 color);
+void OledFb_FillRect(OledFb *fb, int c1, int r1, int c2, int r2, u16 color);
+
+// Draws the inked pixels of a sprite in color, offset by (c, r); the other
+// pixels are left as they are. The sprite's box becomes one dirty rectangle.
+void OledFb_DrawSprite(OledFb *fb, const OledFb_Sprite *sprite, int c, int r, u16 color);
+
+// Fills a rectangle with black in the framebuffer and, with the panel's own
+// fill command, on the panel. Nothing becomes dirty, so erasing costs a few
+// command bytes instead of the rectangle's pixels.
+void OledFb_Erase(OledFb *fb, int c1, int r1, int c2, int r2);
+
+// Makes the panel match the framebuffer in a rectangle that was drawn over
+// straight on the panel (text, for instance). The rectangle is blanked with
+// the fill command and only its runs of non-black pixels become dirty.
+void OledFb_Repaint(OledFb *fb, int c1, int r1, int c2, int r2);
+
+// Marks a rectangle as changed; the drawing calls do this themselves.
+void OledFb_Invalidate(OledFb *fb, int c1, int r1, int c2, int r2);
+
+// Sends every dirty rectangle to the panel.
+// Return: number of window writes sent.
+int OledFb_Flush(OledFb *fb);
+
+// Reads back a pixel of the framebuffer (0 outside the panel).
+u16 OledFb_GetPixel(OledFb *fb, int c, int r);
+
+#endif /* SRC_OLEDFB_H_ */
@@ -0,0 +1,91 @@
+/*
+ * PerfectPlay.c
+ *
+ *  Perfect-play opponent for the 3x3 game, answered from a table.
+ */
+
+#include "PerfectPlay.h"
+
+// Image of each cell under the 8 symmetries of the board: identity, the
+// three rotations, then the four reflections.
+static const u8 symmetry_cells[PERFECTPLAY_SYMMETRIES][BOARD_CELLS] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8 },		// Identity
+	{ 2, 5, 8, 1, 4, 7, 0, 3, 6 },		// Rotate 90
+	{ 8, 7, 6, 5, 4, 3, 2, 1, 0 },		// Rotate 180
+	{ 6, 3, 0, 7, 4, 1, 8, 5, 2 },		// Rotate 270
+	{ 2, 1, 0, 5, 4, 3, 8, 7, 6 },		// Mirror left-right
+	{ 6, 7, 8, 3, 4, 5, 0, 1, 2 },		// Mirror top-bottom
+	{ 0, 3, 6, 1, 4, 7, 2, 5, 8 },		// Main diagonal
+	{ 8, 5, 2, 7, 4, 1, 6, 3, 0 },		// Other diagonal
+};
+
+static const u16 pow3[BOARD_CELLS] = { 1, 3, 9, 27, 81, 243, 729, 2187, 6561 };
+
+int PerfectPlay_MapCell(int symmetry, int cell)
+{
+	return symmetry_cells[symmetry][cell];
+}
+
+u16 PerfectPlay_Key(u16 mover, u16 opponent, int *symmetry)
+{
+	u16 best = 0xFFFF;
+
+	for (int s = 0; s < PERFECTPLAY_SYMMETRIES; s++)
+	{
+		u16 key = 0;
+		for (int cell = 0; cell < BOARD_CELLS; cell++)
+		{
+			if (mover & BOARD_CELL_BIT(cell))
+			{
+				key += pow3[symmetry_cells[s][cell]];
+			}
+			else if (opponent & BOARD_CELL_BIT(cell))
+			{
+				key += 2 * pow3[symmetry_cells[s][cell]];
+			}
+		}
+		if (key < best)
+		{
+			best = key;
+			*symmetry = s;
+		}
+	}
+	return best;
+}
+
+/*
+ * Looks the canonical position up and maps its move back through the
+ * symmetry that produced it.
+ */
+int PerfectPlay_BestMove(const Board *board, int tile)
+{
+	u16 mover = board->tiles[tile - 1];
+	u16 opponent = board->tiles[2 - tile];
+	int symmetry = 0;
+	u16 key = PerfectPlay_Key(mover, opponent, &symmetry);
+	int lo = 0, hi = PerfectPlay_Entries - 1;
+
+	while (lo <= hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (PerfectPlay_Keys[mid] < key)
+		{
+			lo = mid + 1;
+		}
+		else if (PerfectPlay_Keys[mid] > key)
+		{
+			hi = mid - 1;
+		}
+		else
+		{
+			for (int cell = 0; cell < BOARD_CELLS; cell++)
+			{
+				if (symmetry_cells[symmetry][cell] == PerfectPlay_Moves[mid])
+				{
+					return cell;
+				}
+			}
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,45 @@
+/*
+ * PerfectPlay.h
+ *
+ *  Perfect-play opponent for the 3x3 game, answered from a table.
+ *
+ *  A position is seen from the side to move: each cell is 0 (empty), 1 (the
+ *  mover's) or 2 (the opponent's), and its key is the base-3 number with
+ *  cell 0 as the lowest digit. Of the 8 rotations and reflections of a
+ *  position, the one with the smallest key stands for all of them. The table
+ *  holds the best move for every canonical position that can come up in a
+ *  game and is not yet decided, sorted by key.
+ *
+ *  The table (PerfectPlayTable.c) is solved on the host by
+ *  sim/gen_perfect_play.c (make -C sim perfect_play). On the target a move
+ *  is a canonicalisation and a binary search over a fixed-size table; no
+ *  search of the game runs here.
+ */
+
+#ifndef SRC_PERFECTPLAY_H_
+#define SRC_PERFECTPLAY_H_
+
+#include "xil_types.h"
+#include "Board.h"
+
+#define PERFECTPLAY_SYMMETRIES 8
+
+// Solved positions, sorted by key, and the best move in each (a cell of the
+// canonical position).
+extern const u16 PerfectPlay_Keys[];
+extern const u8 PerfectPlay_Moves[];
+extern const int PerfectPlay_Entries;
+
+// Best cell (0..8) for tile to play on board.
+// Return: the cell, or -1 if the game is over or the position cannot come
+// up in a game.
+int PerfectPlay_BestMove(const Board *board, int tile);
+
+// Canonical key of the position with the mover's and opponent's occupancy
+// masks; *symmetry is set to the transform that gives it.
+u16 PerfectPlay_Key(u16 mover, u16 opponent, int *symmetry);
+
+// Where transform symmetry moves cell.
+int PerfectPlay_MapCell(int symmetry, int cell);
+
+#endif /* SRC_PERFECTPLAY_H_ */
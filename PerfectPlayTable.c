@@ -0,0 +1,110 @@
+/*
+ * PerfectPlayTable.c
+ *
+ *  Generated by sim/gen_perfect_play.c (make -C sim perfect_play); do not edit.
+ */
+
+#include "PerfectPlay.h"
+
+const int PerfectPlay_Entries = 627;
+
+const u16 PerfectPlay_Keys[627] = {
+	    0,     2,     5,     6,     7,    11,    17,    23,    33,    35,
+	   44,    45,    47,    50,    51,    52,    61,    63,    65,    68,
+	   69,    70,    73,    75,    76,    83,    87,    89,    98,   101,
+	  104,   116,   128,   132,   141,   142,   146,   150,   152,   153,
+	  154,   156,   158,   160,   162,   163,   165,   167,   169,   173,
+	  176,   178,   194,   195,   196,   200,   204,   206,   207,   208,
+	  210,   212,   214,   225,   226,   228,   230,   232,   238,   278,
+	  290,   297,   299,   302,   303,   304,   308,   312,   314,   315,
+	  316,   318,   320,   322,   380,   384,   386,   395,   396,   398,
+	  401,   402,   403,   434,   438,   440,   449,   452,   455,   459,
+	  460,   462,   464,   466,   468,   470,   473,   474,   475,   478,
+	  480,   481,   541,   543,   544,   550,   554,   556,   621,   622,
+	  624,   626,   628,   632,   635,   637,   746,   747,   749,   752,
+	  753,   754,   776,   780,   798,   800,   801,   802,   804,   806,
+	  808,   830,   834,   882,   884,   887,   888,   889,   902,   906,
+	  908,   909,   910,   912,   914,   916,   935,   936,   938,   941,
+	  942,   960,   961,   964,   966,   967,   980,   992,   996,  1028,
+	 1032,  1034,  1043,  1044,  1046,  1049,  1050,  1051,  1115,  1127,
+	 1131,  1136,  1140,  1142,  1151,  1154,  1157,  1158,  1159,  1169,
+	 1181,  1185,  1190,  1193,  1194,  1195,  1199,  1203,  1205,  1206,
+	 1207,  1209,  1211,  1213,  1217,  1220,  1221,  1222,  1226,  1230,
+	 1232,  1234,  1238,  1240,  1244,  1248,  1250,  1259,  1260,  1262,
+	 1265,  1266,  1270,  1272,  1274,  1276,  1278,  1280,  1283,  1284,
+	 1285,  1288,  1290,  1291,  1298,  1302,  1304,  1316,  1319,  1320,
+	 1321,  1331,  1343,  1347,  1352,  1355,  1356,  1357,  1368,  1369,
+	 1371,  1373,  1375,  1378,  1382,  1384,  1388,  1391,  1392,  1393,
+	 1396,  1399,  1406,  1409,  1410,  1415,  1419,  1421,  1422,  1425,
+	 1427,  1477,  1479,  1480,  1506,  1508,  1510,  1557,  1558,  1560,
+	 1562,  1564,  1589,  1590,  1591,  1703,  1706,  1707,  1708,  1712,
+	 1716,  1718,  1720,  1722,  1724,  1726,  1730,  1734,  1736,  1745,
+	 1746,  1748,  1751,  1752,  1753,  1758,  1762,  1770,  1771,  1774,
+	 1776,  1777,  1784,  1788,  1790,  1799,  1802,  1805,  1806,  1807,
+	 1842,  1843,  1851,  1854,  1855,  1857,  1861,  1866,  1868,  1870,
+	 1874,  1877,  1878,  1879,  1892,  1895,  1896,  1897,  1901,  1905,
+	 1907,  1920,  1921,  1927,  1929,  1933,  1948,  1954,  1958,  1960,
+	 1966,  1974,  1976,  1978,  1982,  1985,  1986,  1987,  1990,  1992,
+	 1993,  2002,  2008,  2010,  2030,  2032,  2036,  2039,  2040,  2041,
+	 2044,  2047,  2054,  2057,  2058,  2059,  2063,  2067,  2069,  2071,
+	 2073,  2075,  2077,  2082,  2083,  2089,  2091,  2095,  2101,  2110,
+	 2116,  2136,  2137,  2143,  2145,  2147,  2149,  2490,  2492,  2501,
+	 2504,  2507,  2508,  2509,  2573,  2585,  2589,  2627,  2639,  2652,
+	 2653,  2657,  2661,  2663,  2665,  2667,  2669,  2671,  2730,  2732,
+	 2734,  2738,  2741,  2743,  2814,  2815,  2819,  2825,  3233,  3237,
+	 3341,  3392,  3395,  3398,  3399,  3400,  3410,  3419,  3422,  3425,
+	 3427,  3437,  3449,  3453,  3461,  3462,  3463,  3467,  3471,  3473,
+	 3475,  3477,  3479,  3481,  3491,  3503,  3543,  3545,  3557,  3561,
+	 3562,  3569,  3571,  3575,  3581,  3583,  3587,  3589,  3597,  3599,
+	 3608,  3611,  3614,  3615,  3908,  3911,  3913,  3939,  3967,  3989,
+	 4047,  4048,  4136,  4138,  4142,  4145,  4147,  4150,  4153,  4163,
+	 4164,  4165,  4169,  4173,  4175,  4177,  4181,  4183,  4195,  4201,
+	 4207,  4219,  4223,  4229,  4231,  4237,  4245,  4247,  4256,  4259,
+	 4263,  4264,  4273,  4281,  4282,  4285,  4303,  4307,  4309,  4325,
+	 4327,  4331,  4334,  4335,  4336,  4924,  5005,  5009,  5011,  5600,
+	 5603,  5605,  5608,  5611,  5633,  5639,  5659,  5665,  5689,  5693,
+	 5695,  5717,  5720,  5743,  5746,  5761,  5765,  5773,  5792,  6367,
+	 6421,  6448,  7310,  7361,  7364,  7367,  7369,  7445,  7469,  7472,
+	 7475,  7499,  7523,  7525,  7529,  7531,  7607,  7769,  7772,  7774,
+	 7841,  7847,  7853,  7931,  7934,  8038,  8042,  8044,  8069,  8071,
+	 8120,  8123,  8282,  8285,  8287,  8309,  8335,  8341,  8363,  8516,
+	 8519,  8521,  8543,  8549,  8555,  8557,  8575,  8581,  8597,  8603,
+	 8609,  8630,  8633,  8636,  8681,  8683,  8705,  8708,  8710, 10469,
+	10528, 10709, 10715, 10736, 10739, 10742, 10744, 10762, 10768, 10790,
+	10793, 10820, 10868, 12220, 14711, 14873, 17060,
+};
+
+const u8 PerfectPlay_Moves[627] = {
+	0, 4, 3, 0, 3, 5, 5, 4, 0, 2, 4, 0, 1, 4, 0, 6, 4, 0, 6, 6,
+	8, 4, 4, 4, 4, 1, 0, 2, 6, 1, 7, 5, 5, 5, 0, 8, 6, 6, 6, 0,
+	8, 7, 7, 8, 0, 1, 0, 8, 7, 8, 8, 7, 8, 7, 6, 8, 7, 5, 6, 6,
+	6, 5, 6, 5, 1, 0, 5, 5, 5, 4, 4, 0, 6, 6, 0, 8, 8, 8, 8, 0,
+	1, 0, 6, 4, 6, 2, 2, 6, 0, 1, 7, 0, 8, 8, 7, 2, 8, 1, 6, 0,
+	2, 2, 2, 7, 8, 8, 8, 8, 8, 6, 6, 6, 4, 4, 2, 1, 4, 4, 0, 8,
+	7, 7, 8, 6, 6, 6, 4, 0, 1, 7, 0, 3, 1, 0, 4, 4, 4, 8, 7, 7,
+	8, 1, 0, 7, 1, 7, 0, 8, 8, 7, 3, 0, 3, 0, 8, 3, 5, 0, 1, 8,
+	0, 0, 5, 5, 5, 5, 2, 1, 0, 2, 2, 2, 4, 0, 1, 7, 0, 8, 2, 1,
+	0, 8, 7, 2, 8, 1, 8, 0, 3, 2, 1, 0, 8, 8, 7, 7, 8, 8, 8, 0,
+	1, 0, 8, 7, 8, 4, 0, 3, 4, 4, 4, 3, 8, 3, 2, 0, 2, 4, 0, 1,
+	8, 0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 1, 0, 4, 2, 2, 2, 1, 7, 0,
+	3, 2, 1, 0, 2, 2, 2, 2, 8, 8, 7, 7, 8, 3, 2, 3, 1, 3, 0, 3,
+	3, 3, 8, 8, 0, 8, 0, 7, 0, 0, 8, 4, 4, 4, 4, 4, 4, 1, 8, 7,
+	7, 8, 5, 5, 5, 3, 3, 4, 4, 8, 8, 8, 4, 4, 3, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 0, 8, 8, 8, 4, 0, 4, 3, 3, 3, 3, 3, 3, 3, 3,
+	0, 8, 8, 0, 8, 7, 8, 2, 2, 2, 8, 8, 8, 8, 1, 2, 0, 2, 8, 8,
+	8, 0, 2, 1, 0, 8, 2, 1, 3, 4, 3, 2, 4, 2, 4, 4, 4, 4, 1, 0,
+	4, 2, 1, 0, 7, 8, 3, 7, 0, 8, 8, 7, 1, 7, 2, 8, 1, 0, 7, 8,
+	7, 7, 8, 7, 2, 1, 0, 8, 7, 2, 1, 2, 2, 1, 0, 8, 7, 8, 2, 8,
+	1, 4, 0, 8, 2, 1, 0, 2, 1, 8, 8, 8, 8, 8, 6, 6, 6, 6, 4, 4,
+	4, 1, 4, 4, 6, 8, 1, 6, 8, 8, 8, 8, 8, 8, 8, 8, 8, 4, 8, 4,
+	3, 8, 8, 0, 4, 8, 8, 4, 4, 4, 8, 4, 4, 8, 2, 1, 2, 2, 1, 8,
+	8, 8, 3, 8, 8, 3, 8, 3, 0, 8, 8, 8, 8, 0, 1, 4, 4, 4, 4, 1,
+	0, 8, 4, 2, 3, 4, 3, 1, 4, 4, 2, 2, 1, 0, 4, 1, 4, 4, 1, 4,
+	4, 8, 1, 3, 1, 8, 0, 2, 8, 1, 0, 8, 8, 0, 8, 1, 1, 3, 3, 2,
+	2, 8, 8, 0, 8, 1, 1, 6, 6, 4, 4, 3, 3, 3, 4, 8, 4, 4, 3, 8,
+	3, 1, 8, 8, 8, 1, 3, 3, 8, 4, 8, 8, 7, 4, 7, 7, 4, 7, 5, 7,
+	7, 7, 5, 7, 7, 7, 7, 7, 7, 7, 4, 4, 7, 7, 7, 4, 3, 4, 4, 4,
+	1, 7, 1, 3, 4, 4, 4, 4, 3, 3, 3, 4, 1, 4, 4, 4, 4, 4, 3, 3,
+	7, 7, 1, 7, 3, 3, 1, 7, 7, 1, 4, 3, 4, 4, 1, 4, 4, 4, 4, 3,
+	1, 1, 3, 4, 5, 4, 4,
+};
@@ -6,127 +6,471 @@
  */
 
 #include "PmodBLE_Interface.h"
+#include "Timebase.h"
+#include "Latency.h"
+
+// *********** Logging *********** //
+#if PMODBLE_LOG_LEVEL >= PMODBLE_LOG_ERROR
+#define PBLE_ERROR(...) xil_printf(__VA_ARGS__)
+#else
+#define PBLE_ERROR(...) do {} while (0)
+#endif
+
+#if PMODBLE_LOG_LEVEL >= PMODBLE_LOG_INFO
+#define PBLE_INFO(...) xil_printf(__VA_ARGS__)
+#else
+#define PBLE_INFO(...) do {} while (0)
+#endif
+
+#if PMODBLE_LOG_LEVEL >= PMODBLE_LOG_DEBUG
+#define PBLE_DEBUG(...) xil_printf(__VA_ARGS__)
+#else
+#define PBLE_DEBUG(...) do {} while (0)
+#endif
+
+// *********** Trace Ring *********** //
+// Fixed-size records written from thread context only (not the receive
+// interrupt); the oldest records are overwritten when the ring is full.
+#if PMODBLE_TRACE_RECORDS > 0
+static void PmodBLE_Trace(PmodBLE_Interface_t *ble, u8 event, u8 byte, u16 arg)
+{
+	PmodBLE_TraceRecord *rec = &ble->trace_ring[ble->trace_next % PMODBLE_TRACE_RECORDS];
 
-// *********** PmodBLE Variables *********** //
-static PmodBLE bleDevice;
+	rec->timestamp = Timebase_Ticks();
+	rec->event = event;
+	rec->byte = byte;
+	rec->arg = arg;
+	ble->trace_next++;
+}
+#define PBLE_TRACE(ble, event, byte, arg) PmodBLE_Trace((ble), (event), (byte), (arg))
+#else
+#define PBLE_TRACE(ble, event, byte, arg) do {} while (0)
+#endif
+
+// *********** Default Instance *********** //
+// The one the functions without a handle use.
+static PmodBLE_Interface_t bleInterface;
+
+// *********** Receive Ring *********** //
+// Single producer (PmodBLE_RxInterruptHandler), single consumer (everything
+// else). The indices run freely and each side only writes its own, so no
+// locking is needed.
+#define RX_RING_MASK (PMODBLE_RX_RING_BYTES - 1)
+#define RX_RING_BARRIER() __asm__ __volatile__("" ::: "memory")
 
 // *********** Static Functions (should be utility functions) *********** //
-static void PmodBLE_Read(u8 *buf, int num_bytes);
-static void PmodBLE_ReadUntilEOL(u8 *buf, char EOL);
-static int PmodBLE_EnterCommandMode();
-static int PmodBLE_ExitCommandMode();
-static int PmodBLE_SendCommand(u8 *command);
-static int PmodBLE_SendCommandRead(u8 *command, u8 *response, int response_bytes);
-static int PmodBLE_SendCommandReadEOL(u8 *command, u8 *response, u8 EOL);
+static void PmodBLE_WaitGuardTime(PmodBLE_Interface_t *ble);
+static int PmodBLE_EnterCommandMode(PmodBLE_Interface_t *ble);
+static int PmodBLE_ExitCommandMode(PmodBLE_Interface_t *ble);
+static int PmodBLE_SendCommand(PmodBLE_Interface_t *ble, u8 *command);
+static int PmodBLE_ExecCommand(PmodBLE_Interface_t *ble, PmodBLE_Command *cmd);
+static int PmodBLE_RingRead(PmodBLE_Interface_t *ble, u8 *buf, int size);
+static int PmodBLE_Recv(PmodBLE_Interface_t *ble, u8 *buf, int size);
+static int PmodBLE_RecordWait(PmodBLE_Interface_t *ble, u32 start, int status);
+static int PmodBLE_NextToken(PmodBLE_Interface_t *ble);
+static int PmodBLE_WaitToken(PmodBLE_Interface_t *ble, u32 deadline);
+static void PmodBLE_TokenizeData(PmodBLE_Interface_t *ble, u8 byte);
 
 /*
  * Flushes the PmodBLE receiver buffers.
  */
-void PmodBLE_Flush()
+void PmodBLE_Interface_Flush(PmodBLE_Interface_t *ble)
 {
-	// DEBUG
-	xil_printf("PBLE_F: Flushed receive buffers\r\n");
+	PBLE_DEBUG("PBLE_F: Flushed receive buffers\r\n");
+
+	PmodBLE_TokenizerReset(&ble->rx_tok, ble->rx_tok.data_mode);
+	ble->tok_pending_len = 0;
+	ble->tok_pending_pos = 0;
+
+	if (ble->rx_interrupt_enabled)
+	{
+		ble->rx_tail = ble->rx_head;
+		return;
+	}
 
 	u8 flush_buf[128] = {0};
-	BLE_RecvData(&bleDevice, flush_buf, 128);
+	BLE_RecvData(&ble->device, flush_buf, 128);
 }
 
 /*
- * Reads a specific number of bytes from PmodBLE.
+ * Copies up to size bytes out of the receive ring.
+ *
+ * Output:
+ * 		Number of bytes copied.
+ */
+static int PmodBLE_RingRead(PmodBLE_Interface_t *ble, u8 *buf, int size)
+{
+	u32 tail = ble->rx_tail;
+	u32 count = ble->rx_head - tail;
+	RX_RING_BARRIER();	// Read the bytes only after seeing the head that covers them.
+
+	if (count > (u32) size)
+	{
+		count = size;
+	}
+
+	// The available bytes may wrap around the end of the ring.
+	u32 idx = tail & RX_RING_MASK;
+	u32 first = PMODBLE_RX_RING_BYTES - idx;
+	if (first > count)
+	{
+		first = count;
+	}
+	memcpy(buf, &ble->rx_ring[idx], first);
+	memcpy(buf + first, ble->rx_ring, count - first);
+
+	RX_RING_BARRIER();
+	ble->rx_tail = tail + count;
+	return count;
+}
+
+/*
+ * Receives whatever bytes are available, from the ring if the receive
+ * interrupt is on and straight from the UART otherwise.
+ */
+static int PmodBLE_Recv(PmodBLE_Interface_t *ble, u8 *buf, int size)
+{
+	if (ble->rx_interrupt_enabled)
+	{
+		return PmodBLE_RingRead(ble, buf, size);
+	}
+	return BLE_RecvData(&ble->device, buf, size);
+}
+
+/*
+ * Same as PmodBLE_Recv, but bytes read for the tokenizer and not yet fed to
+ * it (e.g. what followed the last reply) come first.
+ */
+static int PmodBLE_RecvPending(PmodBLE_Interface_t *ble, u8 *buf, int size)
+{
+	int pending = ble->tok_pending_len - ble->tok_pending_pos;
+
+	if (pending == 0)
+	{
+		return PmodBLE_Recv(ble, buf, size);
+	}
+	if (pending > size)
+	{
+		pending = size;
+	}
+	memcpy(buf, &ble->tok_pending[ble->tok_pending_pos], pending);
+	ble->tok_pending_pos += pending;
+	return pending;
+}
+
+/*
+ * Updates the response wait statistics at the end of a deadline read.
+ */
+static int PmodBLE_RecordWait(PmodBLE_Interface_t *ble, u32 start, int status)
+{
+	u32 waited = Timebase_Ticks() - start;
+
+	if (waited > ble->worst_wait_ticks)
+	{
+		ble->worst_wait_ticks = waited;
+	}
+	if (status == PMODBLE_STATUS_TIMEOUT)
+	{
+		ble->timeout_count++;
+	}
+	return status;
+}
+
+/*
+ * Reads a specific number of bytes from PmodBLE, giving up at a deadline.
+ *
  * Input:
  *		buf - Buffer to store bytes in; must be initialized to 0.
- *		nBytes - Number of bytes to read.
+ *		num_bytes - Number of bytes to read.
+ *		deadline - Timebase tick count at which to stop waiting.
+ *		bytes_read - Set to the number of bytes read; may be NULL.
+ * Output:
+ * 		PMODBLE_STATUS_SUCCESS - Got all num_bytes bytes.
+ * 		PMODBLE_STATUS_TIMEOUT - Deadline passed; buf holds the partial data.
  */
-static void PmodBLE_Read(u8 *buf, int num_bytes)
+int PmodBLE_Interface_ReadDeadline(PmodBLE_Interface_t *ble, u8 *buf, int num_bytes, u32 deadline, int *bytes_read)
 {
+	u32 start = Timebase_Ticks();
+	int status = PMODBLE_STATUS_SUCCESS;
+	int idx = 0;	// Increment upon success.
 	int n = 0;
-	int bytes_read = 0;
-	int idx = 0;
-	u8 recv_byte = 0;
 
-	// While bytes_read < num_bytes requested.
-	while (bytes_read < num_bytes)
+	while (idx < num_bytes)
 	{
-		n = BLE_RecvData(&bleDevice, &recv_byte, 1);
+		n = PmodBLE_RecvPending(ble, &buf[idx], num_bytes - idx);
 
-		if (n != 0)
+		for (int i = idx; i < idx + n; i++)
 		{
-			// DEBUG
-			xil_printf("PBLE_R: Read %c (decimal %d)\r\n", recv_byte, recv_byte);
+			PBLE_DEBUG("PBLE_R: Read %c (decimal %d)\r\n", buf[i], buf[i]);
+			PBLE_TRACE(ble, PMODBLE_TRACE_RX, buf[i], 0);
+		}
+		idx += n;
 
-			buf[idx] = recv_byte;
-			idx++;
-			bytes_read++;
+		if (n == 0 && Timebase_Expired(deadline))
+		{
+			PBLE_ERROR("PBLE_R: Timed out after %d of %d bytes\r\n", idx, num_bytes);
+			PBLE_TRACE(ble, PMODBLE_TRACE_TIMEOUT, 0, idx);
+			status = PMODBLE_STATUS_TIMEOUT;
+			break;
 		}
 	}
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = idx;
+	}
+	return PmodBLE_RecordWait(ble, start, status);
 }
 
 /*
- * Reads until the specified EOL character appears.
+ * Reads until the specified EOL character appears or a deadline passes.
  *
- * NOTE: The returned string DOES NOT include the EOL.
- * WARNING: Could get stuck in an infinite loop if characters do not show up.
+ * NOTE: The returned string DOES NOT include the EOL. Characters that do not
+ *       fit in buf are dropped, but the line is still read up to its EOL.
  *
  * Input:
- * 		buf - Buffer to store bytes in; must be initialized to 0; should be properly sized.
+ * 		buf - Buffer to store bytes in; always '\0' terminated unless size is 0.
+ * 		size - Size of buf in bytes.
+ * 		EOL - EOL character to look for.
+ *		deadline - Timebase tick count at which to stop waiting.
+ *		bytes_read - Set to the number of bytes stored in buf; may be NULL.
+ * Output:
+ * 		PMODBLE_STATUS_SUCCESS - Got a full line.
+ * 		PMODBLE_STATUS_TIMEOUT - Deadline passed; buf holds the partial line.
  */
-static void PmodBLE_ReadUntilEOL(u8 *buf, char EOL)
+int PmodBLE_Interface_ReadUntilEOLDeadline(PmodBLE_Interface_t *ble, u8 *buf, int size, char EOL, u32 deadline, int *bytes_read)
 {
-	int n = 0;
+	u32 start = Timebase_Ticks();
+	int status = PMODBLE_STATUS_SUCCESS;
 	int idx = 0;	// Increment upon success.
+	int n = 0;
 	u8 recv_byte = 0;
 
-	while (recv_byte != EOL)
+	while (1)
 	{
-		n = BLE_RecvData(&bleDevice, &recv_byte, 1);
+		n = PmodBLE_RecvPending(ble, &recv_byte, 1);
+
+		if (n == 0)
+		{
+			if (Timebase_Expired(deadline))
+			{
+				PBLE_ERROR("PBLE_RUE: Timed out after %d bytes\r\n", idx);
+				PBLE_TRACE(ble, PMODBLE_TRACE_TIMEOUT, 0, idx);
+				status = PMODBLE_STATUS_TIMEOUT;
+				break;
+			}
+			continue;
+		}
 
-		if (n != 0 && recv_byte != EOL)
+		if (recv_byte == EOL)
+		{
+			break;
+		}
+
+		PBLE_DEBUG("PBLE_RUE: Read %c (decimal %d)\r\n", recv_byte, recv_byte);
+		PBLE_TRACE(ble, PMODBLE_TRACE_RX, recv_byte, 0);
+		if (idx < size - 1)
 		{
-			// DEBUG
-			xil_printf("PBLE_RUE: Read %c (decimal %d)\r\n", recv_byte, recv_byte);
 			buf[idx] = recv_byte;
 			idx++;
 		}
 	}
+
+	if (size > 0)
+	{
+		buf[idx] = '\0';
+	}
+	if (bytes_read != NULL)
+	{
+		*bytes_read = idx;
+	}
+	return PmodBLE_RecordWait(ble, start, status);
+}
+
+/*
+ * Feeds the bytes that have arrived to the tokenizer, stopping at the first
+ * one that finishes a token.
+ *
+ * Output:
+ * 		The token, or PMODBLE_TOKEN_NONE once no more bytes are waiting.
+ */
+static int PmodBLE_NextToken(PmodBLE_Interface_t *ble)
+{
+	while (1)
+	{
+		if (ble->tok_pending_pos == ble->tok_pending_len)
+		{
+			ble->tok_pending_pos = 0;
+			ble->tok_pending_len = PmodBLE_Recv(ble, ble->tok_pending, sizeof(ble->tok_pending));
+			if (ble->tok_pending_len == 0)
+			{
+				return PMODBLE_TOKEN_NONE;
+			}
+		}
+
+		u8 byte = ble->tok_pending[ble->tok_pending_pos++];
+		PBLE_TRACE(ble, PMODBLE_TRACE_RX, byte, 0);
+
+		// Logged per token rather than per byte; printing every byte takes
+		// longer than the bytes take to arrive.
+		int token = PmodBLE_Tokenize(&ble->rx_tok, byte);
+		if (token != PMODBLE_TOKEN_NONE)
+		{
+			PBLE_DEBUG("PBLE_NT: Token %d: %s\r\n", token, PMODBLE_TOKEN_IS_LINE(token) ? ble->rx_tok.line : ble->rx_tok.status);
+			return token;
+		}
+	}
+}
+
+/*
+ * Waits for the next token, giving up at a deadline.
+ *
+ * Input:
+ *		deadline - Timebase tick count at which to stop waiting.
+ * Output:
+ * 		The token, or PMODBLE_TOKEN_NONE if the deadline passed first.
+ */
+static int PmodBLE_WaitToken(PmodBLE_Interface_t *ble, u32 deadline)
+{
+	u32 start = Timebase_Ticks();
+
+	while (1)
+	{
+		int token = PmodBLE_NextToken(ble);
+		if (token != PMODBLE_TOKEN_NONE)
+		{
+			PmodBLE_RecordWait(ble, start, PMODBLE_STATUS_SUCCESS);
+			return token;
+		}
+		if (Timebase_Expired(deadline))
+		{
+			PBLE_ERROR("PBLE_WT: Timed out\r\n");
+			PBLE_TRACE(ble, PMODBLE_TRACE_TIMEOUT, 0, ble->rx_tok.line_len);
+			PmodBLE_RecordWait(ble, start, PMODBLE_STATUS_TIMEOUT);
+			return PMODBLE_TOKEN_NONE;
+		}
+	}
+}
+
+/*
+ * Waits out whatever is left of the silence the module needs on its UART
+ * before it accepts "$$$", counted from when the last byte we sent left
+ * the wire.
+ */
+static void PmodBLE_WaitGuardTime(PmodBLE_Interface_t *ble)
+{
+	if (!ble->tx_any_sent)
+	{
+		return;	// Nothing sent since reset, so the line has been quiet.
+	}
+
+	u32 guard_end = ble->tx_done_ticks + ENTER_CMD_MODE_GUARD_US * TIMEBASE_TICKS_PER_US;
+	s32 remaining = (s32) (guard_end - Timebase_Ticks());
+
+	if (remaining > 0)
+	{
+		usleep(Timebase_TicksToUs(remaining) + 1);
+	}
 }
 
 /*
  * Enters Command Mode
  *
+ * Skips the "$$$" sequence if the module is known to be in command mode
+ * already. Otherwise it waits only for the rest of the guard time, sends
+ * "$$$" and waits for the prompt: "CMD> " when commands are enabled or a bare
+ * "CMD" when they are disabled (detected by the prompt going quiet).
+ *
  * Output:
  * 		PMODBLE_STATUS_SUCCESS - Was able to get into command mode!
+ * 		PMODBLE_STATUS_CMD_DISABLED - Module answered "CMD"; it has been sent back to data mode.
  * 		PMODBLE_STATUS_ERR - Was not able to get into command mode...
  */
-static int PmodBLE_EnterCommandMode()
+static int PmodBLE_EnterCommandMode(PmodBLE_Interface_t *ble)
 {
-	// Response Buffer
-	u8 response[ENTER_CMD_MODE_MAX_RESPONSE_BYTES + 1] = {0};
+	if (ble->cmd_mode_known)
+	{
+		PBLE_DEBUG("PBLE_ECM: Already in command mode\r\n");
+		return PMODBLE_STATUS_SUCCESS;
+	}
 
-	// Put device to sleep for 100 ms (100,000 us)
-	usleep(100000);
+	// Only sleep for the part of the guard time that has not passed yet.
+	LATENCY_MARK(LATENCY_MARK_CMD_ENTER);
+	PmodBLE_WaitGuardTime(ble);
 
-	// Flush receiver buffers
-	PmodBLE_Flush();
+	// Flush receiver buffers; the reply is command mode text.
+	PmodBLE_Interface_Flush(ble);
+	PmodBLE_TokenizerReset(&ble->rx_tok, 0);
 
 	// Send the command mode characters
-	BLE_SendData(&bleDevice, ENTER_CMD_MODE_CMD, ENTER_CMD_MODE_CMD_NUM_BYTES);
+	PmodBLE_Interface_SendBuffer(ble, (const u8 *) ENTER_CMD_MODE_CMD, ENTER_CMD_MODE_CMD_NUM_BYTES);
+
+	// Wait for the prompt
+	// NOTE: The prompt (i.e. "CMD> " or "CMD") does not end with a CR; a line
+	//       that stays "CMD" for the prompt gap means commands are disabled.
+	u32 start = Timebase_Ticks();
+	u32 deadline = Timebase_Deadline(ENTER_CMD_MODE_TIMEOUT_US);
+	u32 gap_deadline = 0;
+	int gap_armed = 0;
+	int status = PMODBLE_STATUS_ERR;
+
+	while (1)
+	{
+		int token = PmodBLE_NextToken(ble);
+		if (token == PMODBLE_TOKEN_CMD_PROMPT)
+		{
+			status = PMODBLE_STATUS_SUCCESS;
+			break;
+		}
 
-	// Receive the response
-	PmodBLE_Read(response, 4);
+		if (token == PMODBLE_TOKEN_NONE && strcmp(ble->rx_tok.line, ENTER_CMD_MODE_DISABLED_RESPONSE) == 0)
+		{
+			if (!gap_armed)
+			{
+				gap_deadline = Timebase_Deadline(ENTER_CMD_MODE_PROMPT_GAP_US);
+				gap_armed = 1;
+			}
+			else if (Timebase_Expired(gap_deadline))
+			{
+				status = PMODBLE_STATUS_CMD_DISABLED;
+				break;
+			}
+		}
+		else
+		{
+			gap_armed = 0;
+		}
+
+		if (Timebase_Expired(deadline))
+		{
+			PBLE_TRACE(ble, PMODBLE_TRACE_TIMEOUT, 0, ble->rx_tok.line_len);
+			break;
+		}
+	}
+	PmodBLE_RecordWait(ble, start, status == PMODBLE_STATUS_ERR ? PMODBLE_STATUS_TIMEOUT : PMODBLE_STATUS_SUCCESS);
+	LATENCY_SPAN(LATENCY_CMD_ENTER, LATENCY_MARK_CMD_ENTER);
 
 	// Check output
-	// ISSUE: Apparently when the device enters command mode, the
-	//        characters it sends to state that it is in command mode
-	//		  (i.e. "CMD>" or "CMD") does not end with a CR.
-	// SOLUTION: Look for "CMD>" and "CMD" as a substring.
-	if (strstr(response, ENTER_CMD_MODE_ENABLED_RESPONSE) != NULL)
+	if (status == PMODBLE_STATUS_SUCCESS)
 	{
-		xil_printf("PBLE_ECM: CMD Enabled\r\n");
+		ble->cmd_mode_known = 1;
+		PBLE_INFO("PBLE_ECM: CMD Enabled\r\n");
+		PBLE_TRACE(ble, PMODBLE_TRACE_CMD_ENTER, 0, PMODBLE_STATUS_SUCCESS);
 		return PMODBLE_STATUS_SUCCESS;
 	}
+	else if (status == PMODBLE_STATUS_CMD_DISABLED)
+	{
+		// In command mode, but cannot execute commands; go back to data mode.
+		PBLE_ERROR("PBLE_ECM: CMD Disabled\r\n");
+		PBLE_TRACE(ble, PMODBLE_TRACE_CMD_ENTER, 0, PMODBLE_STATUS_CMD_DISABLED);
+		PmodBLE_ExitCommandMode(ble);
+		return PMODBLE_STATUS_CMD_DISABLED;
+	}
 	else
 	{
-		xil_printf("PBLE_ECM: ERR\r\n");
+		PBLE_ERROR("PBLE_ECM: ERR\r\n");
+		PBLE_TRACE(ble, PMODBLE_TRACE_CMD_ENTER, 0, PMODBLE_STATUS_ERR);
+		PmodBLE_TokenizerReset(&ble->rx_tok, 1);
 		return PMODBLE_STATUS_ERR;
 	}
 }
@@ -138,27 +482,42 @@ static int PmodBLE_EnterCommandMode()
  * 		PMODBLE_STATUS_SUCCESS - Was able to exit command mode!
  * 		PMODBLE_STATUS_ERR - Was not able to exit command mode...
  */
-static int PmodBLE_ExitCommandMode()
+static int PmodBLE_ExitCommandMode(PmodBLE_Interface_t *ble)
 {
-	u8 response[EXIT_CMD_MODE_MAX_RESPONSE_BYTES + 1] = {0};
+	// Whatever the outcome, we no longer know that we are in command mode.
+	ble->cmd_mode_known = 0;
+	LATENCY_MARK(LATENCY_MARK_CMD_EXIT);
 
 	// Flush receiver buffers
-	PmodBLE_Flush();
+	PmodBLE_Interface_Flush(ble);
 
 	// Send the characters to exit command mode
-	BLE_SendData(&bleDevice, EXIT_CMD_MODE_CMD, EXIT_CMD_MODE_CMD_NUM_BYTES);
+	PmodBLE_Interface_SendBuffer(ble, (const u8 *) EXIT_CMD_MODE_CMD, EXIT_CMD_MODE_CMD_NUM_BYTES);
+
+	// Wait for "END"
+	// NOTE: The tail of the previous reply (e.g. the "\r\n" after "AOK") may
+	//       still have been on the wire during the flush, so skip other tokens.
+	u32 deadline = Timebase_Deadline(EXIT_CMD_MODE_TIMEOUT_US);
+	int token = PMODBLE_TOKEN_NONE;
+	do
+	{
+		token = PmodBLE_WaitToken(ble, deadline);
+	} while (token != PMODBLE_TOKEN_NONE && token != PMODBLE_TOKEN_END);
+	LATENCY_SPAN(LATENCY_CMD_EXIT, LATENCY_MARK_CMD_EXIT);
 
-	// Receive the response
-	PmodBLE_ReadUntilEOL(response, '\r');
+	// The module is back in data mode either way.
+	PmodBLE_TokenizerReset(&ble->rx_tok, 1);
 
 	// Check output
-	if (strcmp(response, EXIT_CMD_MODE_RESPONSE) == 0)
+	if (token == PMODBLE_TOKEN_END)
 	{
-		xil_printf("PBLE_ExCM: Exited command mode\r\n");
+		PBLE_INFO("PBLE_ExCM: Exited command mode\r\n");
+		PBLE_TRACE(ble, PMODBLE_TRACE_CMD_EXIT, 0, PMODBLE_STATUS_CMD_EXITED);
 		return PMODBLE_STATUS_CMD_EXITED;
 	}
 	else
 	{
+		PBLE_TRACE(ble, PMODBLE_TRACE_CMD_EXIT, 0, PMODBLE_STATUS_ERR);
 		return PMODBLE_STATUS_ERR;
 	}
 }
@@ -170,146 +529,218 @@ static int PmodBLE_ExitCommandMode()
  * 		command - Buffer with command to send; make sure it ends with a '\r' in order for it to be executed; still end with '\0'
  * 				  That is, command is a C-String as follows: "<COMMAND>\r\0"
  */
-static int PmodBLE_SendCommand(u8 *command)
+static int PmodBLE_SendCommand(PmodBLE_Interface_t *ble, u8 *command)
 {
-	int status = 0;		// Keeps track of process status.
-
-	// DEBUG
-	xil_printf("PBLE_SC: Sending %s\r\n", command);
+	PBLE_DEBUG("PBLE_SC: Sending %s\r\n", command);
 
 	// Send the command.
-	int idx = 0;			// Increment upon success
-	int n = 0;
-	u8 byte_to_send = 0;
-	while(command[idx] != '\0')
-	{
-		byte_to_send = command[idx];
-		n = BLE_SendData(&bleDevice, &byte_to_send, 1);
-
-		if (n == 1)
-		{
-			// DEBUG
-			xil_printf("PMOD_SC: Sent %c (decimal %d)\r\n");
-
-			idx++;
-		}
-	}
+	PmodBLE_Interface_SendBuffer(ble, command, strlen((char *) command));
 
 	// Return success.
 	return PMODBLE_STATUS_SUCCESS;
 }
 
 /*
- * Sends a command to PmodBLE, retrieves a response, and exits command mode; good for one-time commands.
+ * Opens a command session: enters command mode once so that the commands
+ * that follow share a single $$$ / --- round trip. Does nothing if a session
+ * is already open.
  *
- * Input:
- * 		command - Buffer with command to send; make sure it ends with a '\r' in order for it to be executed; still end with '\0'
- * 				  That is, command is a C-String as follows: "<COMMAND>\r\0"
- * 		response - Buffer to store response in; must be initialized to 0; should be sized accordingly.
- * 		response_bytes - Number of bytes to get from response.
+ * Output:
+ * 		PMODBLE_STATUS_SUCCESS - In command mode.
+ * 		PMODBLE_STATUS_ERR - Was not able to get into command mode...
  */
-static int PmodBLE_SendCommandRead(u8 *command, u8 *response, int response_bytes)
+int PmodBLE_Interface_BeginCommands(PmodBLE_Interface_t *ble)
 {
-	int status = 0;		// Keeps track of process status.
+	if (ble->cmd_session_open)
+	{
+		return PMODBLE_STATUS_SUCCESS;
+	}
 
-	// DEBUG
-	xil_printf("PBLE_SCR: Sending %s\r\n", command);
+	int status = PmodBLE_EnterCommandMode(ble);
+	ble->cmd_session_open = (status == PMODBLE_STATUS_SUCCESS);
+	return status;
+}
 
-	// 1. Enter command mode to send the command.
-	status = PmodBLE_EnterCommandMode();
-	if (status == PMODBLE_STATUS_ERR)
+/*
+ * Closes the command session and leaves command mode.
+ *
+ * Output:
+ * 		PMODBLE_STATUS_CMD_EXITED - Left command mode (or no session was open).
+ * 		PMODBLE_STATUS_ERR - Was not able to exit command mode...
+ */
+int PmodBLE_Interface_EndCommands(PmodBLE_Interface_t *ble)
+{
+	if (!ble->cmd_session_open)
 	{
-		xil_printf("PBLE_SCR: Error sending command\r\n");
-		return PMODBLE_STATUS_ERR;
+		return PMODBLE_STATUS_CMD_EXITED;
 	}
 
-	// 2. Flush the receiver buffers.
-	PmodBLE_Flush();
+	ble->cmd_session_open = 0;
+	return PmodBLE_ExitCommandMode(ble);
+}
 
-	// 3. Send the command.
-	PmodBLE_SendCommand(command);
+/*
+ * Sends one command inside the open session and reads reply lines until one
+ * contains the expected text, "ERR", or the response deadline passes.
+ *
+ * Input:
+ * 		cmd - Command to run; cmd->status is set to the result.
+ * Output:
+ * 		PMODBLE_STATUS_SUCCESS - Got the expected reply.
+ * 		PMODBLE_STATUS_ERR - Module answered with an error.
+ * 		PMODBLE_STATUS_TIMEOUT - No matching reply in time.
+ */
+static int PmodBLE_ExecCommand(PmodBLE_Interface_t *ble, PmodBLE_Command *cmd)
+{
+	u32 deadline = Timebase_Deadline(CMD_RESPONSE_TIMEOUT_US);
+	int status = PMODBLE_STATUS_SUCCESS;
 
-	// 4. Retrieve the response.
-	PmodBLE_Read(response, response_bytes);
+	PmodBLE_Interface_Flush(ble);
+	PmodBLE_SendCommand(ble, (u8 *) cmd->command);
 
-	// 5. Exit command mode.
-	status = PmodBLE_ExitCommandMode();
-	if (status == PMODBLE_STATUS_ERR)
+	while (1)
 	{
-		xil_printf("PBLE_SCR: Error exiting command mode\r\n");
-		return PMODBLE_STATUS_ERR;
+		int token = PmodBLE_WaitToken(ble, deadline);
+		if (token == PMODBLE_TOKEN_NONE)
+		{
+			status = PMODBLE_STATUS_TIMEOUT;
+			break;
+		}
+		if (token == PMODBLE_TOKEN_ERR)
+		{
+			status = PMODBLE_STATUS_ERR;
+			break;
+		}
+		if (PMODBLE_TOKEN_IS_LINE(token) && (cmd->expect == NULL || strstr(ble->rx_tok.line, cmd->expect) != NULL))
+		{
+			status = PMODBLE_STATUS_SUCCESS;
+			break;
+		}
 	}
 
-	// 6. Return success.
-	return PMODBLE_STATUS_SUCCESS;
+	if (cmd->response != NULL && cmd->response_size > 0)
+	{
+		strncpy(cmd->response, ble->rx_tok.line, cmd->response_size - 1);
+		cmd->response[cmd->response_size - 1] = '\0';
+	}
 
+	cmd->status = status;
+	return status;
 }
 
 /*
- * Sends a command to PmodBLE, retrieves a response that ends with EOL, and exits command mode; good for one-time
- * commands.
+ * Runs a list of commands in one command session. If no session is open,
+ * one is opened for the list and closed afterwards. Every command runs
+ * even if an earlier one fails; check each command's status.
  *
  * Input:
- * 		command - Buffer with command to send; make sure it ends with a '\r' in order for it to be executed; still end with '\0'
- * 				  That is, command is a C-String as follows: "<COMMAND>\r\0"
- * 		response - Buffer to store response in; must be initialized to 0; should be sized accordingly.
- * 		EOL - EOL character to look for in response.
+ * 		cmds - Commands to run, in order.
+ * 		num_cmds - Number of commands.
+ * Output:
+ * 		PMODBLE_STATUS_SUCCESS - Every command got its expected reply.
+ * 		Otherwise the status of the first command that failed, or
+ * 		PMODBLE_STATUS_ERR if command mode could not be entered or exited.
  */
-static int PmodBLE_SendCommandReadEOL(u8 *command, u8 *response, u8 EOL)
+int PmodBLE_Interface_RunCommands(PmodBLE_Interface_t *ble, PmodBLE_Command *cmds, int num_cmds)
 {
-	int status = 0;		// Keeps track of process status.
-
-	// DEBUG
-	xil_printf("PBLE_SCRE: Sending %s\r\n", command);
+	int own_session = !ble->cmd_session_open;
+	int result = PMODBLE_STATUS_SUCCESS;
 
-	// 1. Enter command mode to send the command.
-	status = PmodBLE_EnterCommandMode();
-	if (status == PMODBLE_STATUS_ERR)
+	if (PmodBLE_Interface_BeginCommands(ble) != PMODBLE_STATUS_SUCCESS)
 	{
-		xil_printf("PBLE_SCRE: Error sending command\r\n");
+		PBLE_ERROR("PBLE_RC: Error entering command mode\r\n");
 		return PMODBLE_STATUS_ERR;
 	}
 
-	// 2. Flush the receiver buffers.
-	PmodBLE_Flush();
-
-	// 3. Send the command.
-	PmodBLE_SendCommand(command);
-
-	// 4. Retrieve the response.
-	PmodBLE_ReadUntilEOL(response, EOL);
+	for (int i = 0; i < num_cmds; i++)
+	{
+		int status = PmodBLE_ExecCommand(ble, &cmds[i]);
+		PBLE_DEBUG("PBLE_RC: %s -> %d\r\n", cmds[i].command, status);
+		if (status != PMODBLE_STATUS_SUCCESS && result == PMODBLE_STATUS_SUCCESS)
+		{
+			result = status;
+		}
+	}
 
-	// 5. Exit command mode.
-	status = PmodBLE_ExitCommandMode();
-	if (status == PMODBLE_STATUS_ERR)
+	if (own_session && PmodBLE_Interface_EndCommands(ble) == PMODBLE_STATUS_ERR)
 	{
-		xil_printf("PBLE_SCRE: Error exiting command mode\r\n");
+		PBLE_ERROR("PBLE_RC: Error exiting command mode\r\n");
 		return PMODBLE_STATUS_ERR;
 	}
 
-	// 6. Return success.
-	return PMODBLE_STATUS_SUCCESS;
+	return result;
+}
 
+/*
+ * Finds the address in a "BTA=<address>" reply line.
+ *
+ * Output:
+ * 		The 12 address characters (not NUL-terminated), or NULL if the line has
+ * 		no prefix or fewer than 12 characters after it.
+ */
+static const char *PmodBLE_ParseAddress(const char *line)
+{
+	const char *address = strstr(line, GET_DEVICE_ADDRESS_PREFIX);
+
+	if (address == NULL)
+	{
+		return NULL;
+	}
+	address += strlen(GET_DEVICE_ADDRESS_PREFIX);
+	if (strnlen(address, 12) < 12)
+	{
+		return NULL;
+	}
+	return address;
 }
 
 /*
  * Initializes the PmodBLE device.
+ *
+ * Input:
+ * 		gpio_base, uart_base - Base addresses of the PmodBLE IP's GPIO and UART.
  */
-void PmodBLE_Initialize()
+void PmodBLE_Interface_Initialize(PmodBLE_Interface_t *ble, u32 gpio_base, u32 uart_base)
 {
+	// BLE_Begin resets the UART, which turns the receive interrupt off.
+	ble->rx_interrupt_enabled = 0;
+	ble->cmd_session_open = 0;
+	ble->cmd_mode_known = 0;
+	ble->tx_any_sent = 0;
+	PmodBLE_TokenizerReset(&ble->rx_tok, 1);
+	ble->status_token = PMODBLE_TOKEN_NONE;
+
 	BLE_Begin(
-	        &bleDevice,
-	        XPAR_PMODBLE_0_S_AXI_GPIO_BASEADDR,
-	        XPAR_PMODBLE_0_S_AXI_UART_BASEADDR,
+	        &ble->device,
+	        gpio_base,
+	        uart_base,
 			XPAR_CPU_M_AXI_DP_FREQ_HZ,
 	        115200
 	);
 
-	// Set the device into advertisement mode.
-	u8 response[3] = {0}; 	// Response is "AOK"
-	u8 cmd[] = "A\r";
-	PmodBLE_SendCommandRead(cmd, response, 3);
-	xil_printf("PBLE_Init: Advertisement Mode -> %s\r\n", response);
+	// Set the device into advertisement mode, and read our own address in the
+	// same session for picking a role later (see PmodBLE_ConnectPeer).
+	char response[CMD_RESPONSE_MAX_LINE_BYTES] = {0}; 	// Response is "AOK"
+	char bta[CMD_RESPONSE_MAX_LINE_BYTES] = {0};		// Response is "BTA=<address>"
+	PmodBLE_Command cmds[] = {
+		{ "A\r", CMD_SUCCESS_RESPONSE, response, sizeof(response), 0 },
+		{ GET_DEVICE_ADDRESS_CMD, GET_DEVICE_ADDRESS_PREFIX, bta, sizeof(bta), 0 },
+	};
+	PmodBLE_Interface_RunCommands(ble, cmds, 2);
+	PBLE_INFO("PBLE_Init: Advertisement Mode -> %s\r\n", response);
+
+	const char *address = cmds[1].status == PMODBLE_STATUS_SUCCESS ? PmodBLE_ParseAddress(bta) : NULL;
+	if (address == NULL)
+	{
+		PBLE_ERROR("PBLE_Init: No device address in \"%s\"\r\n", bta);
+		return;
+	}
+	if (memcmp(ble->peer.own_address, address, 12) != 0)
+	{
+		ble->peer.role = PMODBLE_ROLE_UNKNOWN;		// Another module; pick again.
+	}
+	memcpy(ble->peer.own_address, address, 12);
+	ble->peer.own_address[12] = '\0';
 }
 
 /*
@@ -317,24 +748,30 @@ void PmodBLE_Initialize()
  *
  *	Input:
  *		address - Buffer of 12-bytes to store the device address.
+ *	Output:
+ *		PMODBLE_STATUS_SUCCESS, or PMODBLE_STATUS_ERR if no address came back.
  */
-int PmodBLE_GetDeviceAddress(u8 *address)
+int PmodBLE_Interface_GetDeviceAddress(PmodBLE_Interface_t *ble, u8 *address)
 {
-	u8 response[16] = {0};
+	char response[CMD_RESPONSE_MAX_LINE_BYTES] = {0};
+	PmodBLE_Command cmd = { GET_DEVICE_ADDRESS_CMD, GET_DEVICE_ADDRESS_PREFIX, response, sizeof(response), 0 };
 
-	// 1. Send command to get device address.
-	PmodBLE_SendCommandRead(GET_DEVICE_ADDRESS_CMD, response, 16);
+	// 1. Send command to get device address; the reply line is "BTA=<address>".
+	if (PmodBLE_Interface_RunCommands(ble, &cmd, 1) != PMODBLE_STATUS_SUCCESS)
+	{
+		return PMODBLE_STATUS_ERR;
+	}
 
-	// DEBUG
-	xil_printf("PBLE_GDA: %s\r\n", response);
+	PBLE_DEBUG("PBLE_GDA: %s\r\n", response);
 
 	// 2. Copy address portion (i.e. char after "BTA=") into address.
-	int idx = 4;
-	while (idx < 16)
+	const char *bta = PmodBLE_ParseAddress(response);
+	if (bta == NULL)
 	{
-		address[idx - 4] = response[idx];
-		idx++;
+		PBLE_ERROR("PBLE_GDA: No device address in \"%s\"\r\n", response);
+		return PMODBLE_STATUS_ERR;
 	}
+	memcpy(address, bta, 12);
 
 	// 3. Return success.
 	return PMODBLE_STATUS_SUCCESS;
@@ -343,17 +780,14 @@ int PmodBLE_GetDeviceAddress(u8 *address)
 /*
  * Attempt connection to BLE device.
  */
-int PmodBLE_ConnectTo(u8 *address)
+int PmodBLE_Interface_ConnectTo(PmodBLE_Interface_t *ble, u8 *address)
 {
-	// NOTE: It appears that the STATUS messages from PmodBLE ends with a LF character; that is a '\n'.
-	//       We can write a new read function that will continue reading until a certain EOL character
-	//		 is received.
-
-	// NOTE: For the ConnectTo function, we may need to be a bit more involved in the sending/recieving of commands.
+	// NOTE: The status messages from PmodBLE (e.g. "%CONNECT,0,<address>%") have no
+	//       line ending; the tokenizer reports them at their closing '%'.
 
 	int status = 0;		// Use for status messages.
-	u8 response[32] = {0};
 
+	LATENCY_MARK(LATENCY_MARK_CONNECT);
 
 	// 1. Concatenate address to connection command:
 	//		Base CMD: 4 bytes
@@ -362,115 +796,635 @@ int PmodBLE_ConnectTo(u8 *address)
 	//		NULL: 1 byte
 	//		Need 18 bytes for command.
 	u8 cmd[18] = CONN_TO_DEVICE_CMD;
-	strcat(cmd, address);
-	strcat(cmd, "\r");
+	strcat((char *) cmd, (char *) address);
+	strcat((char *) cmd, "\r");
 
-	// 2. Enter command mode.
-	status = PmodBLE_EnterCommandMode();
+	// 2. Enter command mode, unless a session already did.
+	status = PmodBLE_Interface_BeginCommands(ble);
 	if (status != PMODBLE_STATUS_SUCCESS)
 	{
 		return PMODBLE_STATUS_ERR;
 	}
 
 	// 3. Send the command; make sure to flush buffers beforehand.
-	PmodBLE_Flush();
-	PmodBLE_SendCommand(cmd);
-
-	// 4. Retrieve the response.
-	PmodBLE_ReadUntilEOL(response, '\n');
-
-	// 5. Loop until we get %CONNECT%, ERR, or %ERR_CONN%.
-	if (strstr(response, CONN_TO_DEVICE_STARTING_RESPONSE) != NULL)
+	PmodBLE_Interface_Flush(ble);
+	PmodBLE_SendCommand(ble, cmd);
+
+	// 4. Wait for "Trying", then for %CONNECT%, ERR, or %ERR_CONN%, or give up.
+	u32 deadline = Timebase_Deadline(CMD_RESPONSE_TIMEOUT_US);
+	int trying = 0;
+	int token = PMODBLE_TOKEN_NONE;
+	do
 	{
-		memset(response, '\0', sizeof(response));	// Clear response.
-		PmodBLE_Read(response, CONN_TO_DEVICE_MAX_RESPONSE_BYTES);
-	}
-	else
-	{
-		return PMODBLE_STATUS_ERR;
-	}
+		token = PmodBLE_WaitToken(ble, deadline);
+		if (token == PMODBLE_TOKEN_TRYING)
+		{
+			trying = 1;
+			deadline = Timebase_Deadline(CONN_TO_DEVICE_TIMEOUT_US);
+		}
+	} while (token != PMODBLE_TOKEN_NONE && token != PMODBLE_TOKEN_CONNECT
+			&& token != PMODBLE_TOKEN_ERR && token != PMODBLE_TOKEN_ERR_CONN);
 
-	// 6. Once we get a new status message, return status.
+	// 5. Return status.
 	//    It appears that upon successful connection, the device leaves
 	//    command mode automatically. Thus, no need to do a exit command mode thing.
-	if (strstr(response, CONN_TO_DEVICE_CONNECTED_RESPONSE) != NULL)			// %CONNECT%
+	if (token == PMODBLE_TOKEN_CONNECT)						// %CONNECT,0,<address>%
 	{
+		ble->cmd_session_open = 0;
+		ble->cmd_mode_known = 0;		// Module left command mode on connecting.
+		PmodBLE_TokenizerReset(&ble->rx_tok, 1);
+
+		PBLE_TRACE(ble, PMODBLE_TRACE_CONNECT, 0, PMODBLE_STATUS_CONNECTED);
+		LATENCY_SPAN(LATENCY_CONNECT, LATENCY_MARK_CONNECT);
 		return PMODBLE_STATUS_CONNECTED;
 	}
-	else if (strstr(response, CONN_TO_DEVICE_SYNTAX_ERROR_RESPONSE) != NULL)	// ERR
+	else if (token == PMODBLE_TOKEN_ERR_CONN)				// %ERR_CONN%
+	{
+		// Error occurred, so probabily will have to do an exit command mode.
+		PBLE_ERROR("PBLE_CT: Connection Error\r\n");
+		PBLE_TRACE(ble, PMODBLE_TRACE_CONNECT, 0, PMODBLE_STATUS_CONNECTION_ERR);
+		PmodBLE_Interface_EndCommands(ble);
+		return PMODBLE_STATUS_CONNECTION_ERR;
+	}
+	else if (token == PMODBLE_TOKEN_ERR)					// ERR
 	{
 		// Error occurred, so probably will have to do an exit command mode.
-		xil_printf("PBLE_CT: Syntax Error\r\n");
-		PmodBLE_ExitCommandMode();
+		PBLE_ERROR("PBLE_CT: Syntax Error\r\n");
+		PmodBLE_Interface_EndCommands(ble);
 		return PMODBLE_STATUS_ERR;
 	}
-	else if (strstr(response, CONN_TO_DEVICE_CONNECT_ERROR_RESPONSE) != NULL)	// %ERR_CONN%
+	else if (trying)
 	{
-		// Error occurred, so probabily will have to do an exit command mode.
-		xil_printf("PBLE_CT: Connection Error\r\n");
-		PmodBLE_ExitCommandMode();
-		return PMODBLE_STATUS_CONNECTION_ERR;
+		PBLE_ERROR("PBLE_CT: Timed out\r\n");
+		PBLE_TRACE(ble, PMODBLE_TRACE_CONNECT, 0, PMODBLE_STATUS_TIMEOUT);
+		PmodBLE_Interface_EndCommands(ble);
+		return PMODBLE_STATUS_TIMEOUT;
 	}
 	else
 	{
 		// Error occurred, so probabily will have to do an exit command mode.
-		xil_printf("PBLE_CT: Other Error\r\n");
-		PmodBLE_ExitCommandMode();
+		PBLE_ERROR("PBLE_CT: Other Error\r\n");
+		PmodBLE_Interface_EndCommands(ble);
 		return PMODBLE_STATUS_ERR;
 	}
 }
 
-void PmodBLE_Disconnect()
+/*
+ * Connects to the other board in the role the address ordering gives us. The
+ * role is picked once per peer and kept in the peer cache with the peer's
+ * address, so a reconnect needs neither the address query nor, for the
+ * peripheral, command mode at all. The RN4871 advertises again by itself
+ * after a disconnection, so the peripheral has nothing to send.
+ *
+ * Input:
+ * 		address - The other board's address (12 characters, no NUL needed).
+ * Output:
+ * 		PMODBLE_STATUS_CONNECTED - Connected.
+ * 		PMODBLE_STATUS_CONNECTING - Peripheral; the other board is to dial.
+ * 		Otherwise the PmodBLE_ConnectTo error, or PMODBLE_STATUS_ERR if our
+ * 		own address could not be read.
+ */
+int PmodBLE_Interface_ConnectPeer(PmodBLE_Interface_t *ble, const u8 *address)
+{
+	// 1. New peer: pick the role. Our address normally came with PmodBLE_Initialize.
+	if (ble->peer.role == PMODBLE_ROLE_UNKNOWN || memcmp(ble->peer.address, address, 12) != 0)
+	{
+		if (ble->peer.own_address[0] == '\0'
+				&& PmodBLE_Interface_GetDeviceAddress(ble, ble->peer.own_address) != PMODBLE_STATUS_SUCCESS)
+		{
+			return PMODBLE_STATUS_ERR;
+		}
+		memcpy(ble->peer.address, address, 12);
+		ble->peer.address[12] = '\0';
+		ble->peer.role = memcmp(ble->peer.own_address, address, 12) < 0
+				? PMODBLE_ROLE_CENTRAL : PMODBLE_ROLE_PERIPHERAL;
+		PBLE_INFO("PBLE_CP: %s\r\n", ble->peer.role == PMODBLE_ROLE_CENTRAL ? "Central" : "Peripheral");
+	}
+
+	// 2. The peripheral only waits; the central dials.
+	if (PmodBLE_Interface_IsConnected(ble))
+	{
+		return PMODBLE_STATUS_CONNECTED;
+	}
+	if (ble->peer.role == PMODBLE_ROLE_PERIPHERAL)
+	{
+		return PMODBLE_STATUS_CONNECTING;
+	}
+	return PmodBLE_Interface_ConnectTo(ble, ble->peer.address);
+}
+
+void PmodBLE_Interface_GetPeer(PmodBLE_Interface_t *ble, PmodBLE_Peer *peer)
+{
+	*peer = ble->peer;
+}
+
+void PmodBLE_Interface_SetPeer(PmodBLE_Interface_t *ble, const PmodBLE_Peer *peer)
+{
+	ble->peer = *peer;
+}
+
+int PmodBLE_Interface_Disconnect(PmodBLE_Interface_t *ble)
 {
-	int status = 0;
-	u8 response[4] = {0};
+	PmodBLE_Command cmd = { DISCONNECT_CMD, DISCONNECT_SUCCESS_RESPONSE, NULL, 0, 0 };
 
-	xil_printf("PBLE_D: Executing Disconnect\r\n");
+	PBLE_INFO("PBLE_D: Executing Disconnect\r\n");
 
-	// 1. Send the Disconnect Command.
-	PmodBLE_SendCommandRead(DISCONNECT_CMD, response, 3);
+	// 1. Send the Disconnect Command; "%DISCONNECT%" follows later in data mode.
+	PmodBLE_Interface_RunCommands(ble, &cmd, 1);
 
 	// 2. Check response type.
-	if (strstr(response, DISCONNECT_SUCCESS_RESPONSE) != NULL)
+	if (cmd.status == PMODBLE_STATUS_SUCCESS)
 	{
-		xil_printf("PBLE_D: Disconnected\r\n");
+		PBLE_INFO("PBLE_D: Disconnected\r\n");
 		return PMODBLE_STATUS_SUCCESS;
 	}
 	else
 	{
-		xil_printf("PBLE_D: ERROR\r\n");
+		PBLE_ERROR("PBLE_D: ERROR\r\n");
 		return PMODBLE_STATUS_ERR;
 	}
 }
 
-void PmodBLE_SendMessage(u8 *msg)
+void PmodBLE_Interface_SendMessage(PmodBLE_Interface_t *ble, u8 *msg)
 {
-	int msg_size = strlen(msg);
+	PmodBLE_Interface_SendBuffer(ble, msg, strlen((char *) msg));
+
+	PBLE_DEBUG("PBLE_SM: Sent message\r\n");
+}
+
+/*
+ * Sends a buffer to the other PmodBLE device.
+ *
+ * Each BLE_SendData call hands the UART as much of the remaining buffer as
+ * its TX FIFO has room for. The FIFO drains one character time per byte, so
+ * while it is full we sleep until half of it is free instead of polling it,
+ * then check the room again rather than assume the sleep made it. If the
+ * UART takes fewer bytes than estimated, the estimate is moved to a full
+ * FIFO so the next pass sleeps; only bytes it did not take are retried.
+ *
+ * Input:
+ * 		buf - Bytes to send; may contain '\0'.
+ * 		size - Number of bytes to send.
+ * Output:
+ * 		Number of bytes sent.
+ */
+int PmodBLE_Interface_SendBuffer(PmodBLE_Interface_t *ble, const u8 *buf, int size)
+{
+	u32 char_ticks = PMODBLE_UART_CHAR_US * TIMEBASE_TICKS_PER_US;
 	int bytes_sent = 0; // Increment upon success.
-	int idx = 0;		// Increment upon success.
-	int n = 0;			// Number of bytes sent.
-	u8 byte_to_send = 0;
 
-	while(bytes_sent != msg_size)
+	while (bytes_sent < size)
 	{
-		byte_to_send = msg[idx];
-		n = BLE_SendData(&bleDevice, &byte_to_send, 1);
-		if (n != 0)
+		// Refilling at half empty keeps the wire busy while we sleep.
+		int want = size - bytes_sent < PMODBLE_UART_FIFO_BYTES / 2 ? size - bytes_sent : PMODBLE_UART_FIFO_BYTES / 2;
+		int room = PmodBLE_Interface_TxFree(ble);
+		if (room < want)
 		{
-			bytes_sent++;
-			idx++;
+			// Sleep until the FIFO has drained enough for want bytes.
+			s32 drain = (s32) (ble->tx_done_ticks - Timebase_Ticks()) - (s32) ((PMODBLE_UART_FIFO_BYTES - want) * char_ticks);
+			usleep(drain > 0 ? Timebase_TicksToUs(drain) + 1 : PMODBLE_UART_CHAR_US);
+			continue;
+		}
+
+		int offer = room < size - bytes_sent ? room : size - bytes_sent;
+		int n = BLE_SendData(&ble->device, (u8 *) buf + bytes_sent, offer);
+		bytes_sent += n;
+
+		// The bytes just queued leave after those already in the FIFO.
+		u32 now = Timebase_Ticks();
+		if (!ble->tx_any_sent || (s32) (ble->tx_done_ticks - now) < 0)
+		{
+			ble->tx_done_ticks = now;
+		}
+		ble->tx_done_ticks += n * char_ticks;
+		ble->tx_any_sent = 1;
+
+		// A short write means the FIFO is full whatever the estimate said.
+		if (n < offer)
+		{
+			ble->tx_done_ticks = now + PMODBLE_UART_FIFO_BYTES * char_ticks;
 		}
 	}
 
-	xil_printf("PBLE_SM: Sent message\r\n");
+	PBLE_TRACE(ble, PMODBLE_TRACE_TX, size > 0 ? buf[0] : 0, size);
+	return bytes_sent;
+}
+
+/*
+ * Sends a list of segments back to back, e.g. a frame header followed by a
+ * payload that lives elsewhere, without copying them into one buffer.
+ *
+ * Input:
+ * 		segs - Segments to send, in order.
+ * 		num_segs - Number of segments.
+ * Output:
+ * 		Number of bytes sent.
+ */
+int PmodBLE_Interface_SendSegments(PmodBLE_Interface_t *ble, const PmodBLE_Segment *segs, int num_segs)
+{
+	int bytes_sent = 0;
+
+	for (int i = 0; i < num_segs; i++)
+	{
+		bytes_sent += PmodBLE_Interface_SendBuffer(ble, segs[i].buf, segs[i].size);
+	}
+
+	return bytes_sent;
+}
+
+/*
+ * Estimates the room in the TX FIFO from when the last byte sent leaves the
+ * wire; the FIFO drains one character time per byte.
+ *
+ * Output:
+ * 		Bytes that can be sent without waiting, 0..PMODBLE_UART_FIFO_BYTES.
+ */
+int PmodBLE_Interface_TxFree(PmodBLE_Interface_t *ble)
+{
+	s32 remaining = (s32) (ble->tx_done_ticks - Timebase_Ticks());
+	u32 char_ticks = PMODBLE_UART_CHAR_US * TIMEBASE_TICKS_PER_US;
+
+	if (!ble->tx_any_sent || remaining <= 0)
+	{
+		return PMODBLE_UART_FIFO_BYTES;
+	}
+	u32 queued = (remaining + char_ticks - 1) / char_ticks;
+	return queued >= PMODBLE_UART_FIFO_BYTES ? 0 : PMODBLE_UART_FIFO_BYTES - queued;
+}
+
+/*
+ * Feeds a data mode byte to the tokenizer; a status message it finishes is
+ * kept for PmodBLE_TakeStatusToken.
+ */
+static void PmodBLE_TokenizeData(PmodBLE_Interface_t *ble, u8 byte)
+{
+	int token = PmodBLE_Tokenize(&ble->rx_tok, byte);
+	if (token != PMODBLE_TOKEN_NONE)
+	{
+		PBLE_INFO("PBLE_RM: Status %s\r\n", ble->rx_tok.status);
+		ble->status_token = token;
+	}
+}
+
+/*
+ * Receives data from the other device. Status messages from the module that
+ * arrive between the data bytes are taken out and kept for
+ * PmodBLE_TakeStatusToken; a '%' that may start one is held back until it
+ * is clear whether it does, or until PMODBLE_STATUS_GAP_US pass without
+ * another byte (a frame may well end in 0x25).
+ *
+ * Input:
+ * 		buf - Buffer for the data.
+ * 		size - Size of buf in bytes.
+ * Output:
+ * 		Number of data bytes copied.
+ */
+int PmodBLE_Interface_ReceiveMessage(PmodBLE_Interface_t *ble, u8 *buf, int size)
+{
+	// Read in chunks that leave the tokenizer room for a released status message.
+	u8 raw[PMODBLE_TOKEN_DATA_BYTES - PMODBLE_TOKEN_STATUS_BYTES];
+
+	u32 dropped = ble->rx_tok.dropped;
+
+	// Bytes left over from the last reply (e.g. data right after %CONNECT%)
+	// come first. They are taken out as they are fed, and stay pending once
+	// buf is full, so the tokenizer's data never overflows here.
+	int idx = PmodBLE_TokenizerTakeData(&ble->rx_tok, buf, size);
+	if (idx < size && ble->tok_pending_pos < ble->tok_pending_len)
+	{
+		ble->rx_data_ticks = Timebase_Ticks();
+	}
+	while (idx < size && ble->tok_pending_pos < ble->tok_pending_len)
+	{
+		PmodBLE_TokenizeData(ble, ble->tok_pending[ble->tok_pending_pos++]);
+		idx += PmodBLE_TokenizerTakeData(&ble->rx_tok, &buf[idx], size - idx);
+	}
+
+	while (idx < size)
+	{
+		int chunk = size - idx < (int) sizeof(raw) ? size - idx : (int) sizeof(raw);
+		int n = PmodBLE_Recv(ble, raw, chunk);
+		if (n == 0)
+		{
+			break;
+		}
+
+		ble->rx_data_ticks = Timebase_Ticks();
+		for (int i = 0; i < n; i++)
+		{
+			PmodBLE_TokenizeData(ble, raw[i]);
+		}
+		idx += PmodBLE_TokenizerTakeData(&ble->rx_tok, &buf[idx], size - idx);
+	}
+
+	// Nothing more came after a held '%'; it was data.
+	if (idx < size && Timebase_Expired(ble->rx_data_ticks + PMODBLE_STATUS_GAP_US * TIMEBASE_TICKS_PER_US))
+	{
+		PmodBLE_TokenizerRelease(&ble->rx_tok);
+		idx += PmodBLE_TokenizerTakeData(&ble->rx_tok, &buf[idx], size - idx);
+	}
+
+	if (ble->rx_tok.dropped != dropped)
+	{
+		PBLE_ERROR("PBLE_RM: Dropped %d data bytes\r\n", (int) (ble->rx_tok.dropped - dropped));
+	}
+	return idx;
+}
+
+int PmodBLE_Interface_TakeStatusToken(PmodBLE_Interface_t *ble)
+{
+	int token = ble->status_token;
+	ble->status_token = PMODBLE_TOKEN_NONE;
+	return token;
+}
+
+/*
+ * Turns on the UART receive interrupt so that received bytes are moved into
+ * the ring as they arrive, instead of waiting in the UART FIFO until the
+ * next read.
+ *
+ * NOTE: Connect PmodBLE_RxInterruptHandler to the PmodBLE UART interrupt and
+ *       enable it on the interrupt controller before calling this.
+ */
+void PmodBLE_Interface_EnableRxInterrupt(PmodBLE_Interface_t *ble)
+{
+	PmodBLE_Interface_Flush(ble);
+	ble->rx_head = 0;
+	ble->rx_tail = 0;
+	ble->rx_dropped = 0;
+	ble->rx_interrupt_enabled = 1;
+
+	u16 options = XUartNs550_GetOptions(&ble->device.BLEUart);
+	XUartNs550_SetOptions(&ble->device.BLEUart, options | XUN_OPTION_DATA_INTR | XUN_OPTION_FIFOS_ENABLE);
+}
+
+/*
+ * Drains the UART receive FIFO into the ring. Bytes that do not fit are
+ * read anyway, so the interrupt clears, and counted as dropped.
+ *
+ * Input:
+ * 		CallbackRef - The instance, or NULL for the default one.
+ */
+void PmodBLE_RxInterruptHandler(void *CallbackRef)
+{
+	PmodBLE_Interface_t *ble = CallbackRef != NULL ? CallbackRef : &bleInterface;
+	u32 head = ble->rx_head;
+	int n = 0;
+
+	do
+	{
+		u32 space = PMODBLE_RX_RING_BYTES - (head - ble->rx_tail);
+
+		if (space == 0)
+		{
+			u8 discard[16];
+			n = BLE_RecvData(&ble->device, discard, sizeof(discard));
+			ble->rx_dropped += n;
+		}
+		else
+		{
+			// Receive straight into the ring, up to its end.
+			u32 idx = head & RX_RING_MASK;
+			u32 chunk = PMODBLE_RX_RING_BYTES - idx;
+			if (chunk > space)
+			{
+				chunk = space;
+			}
+			n = BLE_RecvData(&ble->device, &ble->rx_ring[idx], chunk);
+			head += n;
+
+			RX_RING_BARRIER();	// Publish the bytes before the new head.
+			ble->rx_head = head;
+		}
+	} while (n > 0);
+}
+
+int PmodBLE_Interface_RxAvailable(PmodBLE_Interface_t *ble)
+{
+	return ble->rx_head - ble->rx_tail;
+}
+
+int PmodBLE_Interface_RxDropped(PmodBLE_Interface_t *ble)
+{
+	return ble->rx_dropped;
+}
+
+int PmodBLE_Interface_DataDropped(PmodBLE_Interface_t *ble)
+{
+	return ble->rx_tok.dropped;
+}
+
+/*
+ * Longest time any response wait has taken so far, in microseconds.
+ */
+u32 PmodBLE_Interface_WorstWaitUs(PmodBLE_Interface_t *ble)
+{
+	return Timebase_TicksToUs(ble->worst_wait_ticks);
+}
+
+int PmodBLE_Interface_TimeoutCount(PmodBLE_Interface_t *ble)
+{
+	return ble->timeout_count;
+}
+
+/*
+ * Copies trace records out, oldest first, and empties the trace ring.
+ *
+ * Input:
+ * 		records - Buffer for up to max records.
+ * 		max - Size of records.
+ * Output:
+ * 		Number of records copied.
+ */
+int PmodBLE_Interface_TraceRead(PmodBLE_Interface_t *ble, PmodBLE_TraceRecord *records, int max)
+{
+#if PMODBLE_TRACE_RECORDS > 0
+	u32 count = ble->trace_next < PMODBLE_TRACE_RECORDS ? ble->trace_next : PMODBLE_TRACE_RECORDS;
+	u32 first = ble->trace_next - count;
+	int n = 0;
+
+	for (u32 i = first; i < ble->trace_next && n < max; i++)
+	{
+		records[n++] = ble->trace_ring[i % PMODBLE_TRACE_RECORDS];
+	}
+
+	ble->trace_next = 0;
+	return n;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Prints the trace ring over the console, one record per line:
+ * timestamp in ticks, event, byte, arg.
+ */
+void PmodBLE_Interface_TraceDump(PmodBLE_Interface_t *ble)
+{
+#if PMODBLE_TRACE_RECORDS > 0
+	PmodBLE_TraceRecord rec;
+
+	xil_printf("PBLE_T: %d records\r\n", ble->trace_next < PMODBLE_TRACE_RECORDS ? ble->trace_next : PMODBLE_TRACE_RECORDS);
+
+	// Print oldest first, one record at a time so no second buffer is needed.
+	u32 count = ble->trace_next < PMODBLE_TRACE_RECORDS ? ble->trace_next : PMODBLE_TRACE_RECORDS;
+	for (u32 i = ble->trace_next - count; i < ble->trace_next; i++)
+	{
+		rec = ble->trace_ring[i % PMODBLE_TRACE_RECORDS];
+		xil_printf("PBLE_T: %d %d %d %d\r\n", rec.timestamp, rec.event, rec.byte, rec.arg);
+	}
+
+	ble->trace_next = 0;
+#endif
+}
+
+int PmodBLE_Interface_IsConnected(PmodBLE_Interface_t *ble)
+{
+	return BLE_IsConnected(&ble->device);
+}
+
+// *********** Default Instance Wrappers *********** //
+PmodBLE_Interface_t *PmodBLE_DefaultInterface()
+{
+	return &bleInterface;
+}
+
+void PmodBLE_Initialize()
+{
+	PmodBLE_Interface_Initialize(&bleInterface, XPAR_PMODBLE_0_S_AXI_GPIO_BASEADDR, XPAR_PMODBLE_0_S_AXI_UART_BASEADDR);
+}
+
+int PmodBLE_GetDeviceAddress(u8 *address)
+{
+	return PmodBLE_Interface_GetDeviceAddress(&bleInterface, address);
+}
+
+int PmodBLE_ConnectTo(u8 *address)
+{
+	return PmodBLE_Interface_ConnectTo(&bleInterface, address);
+}
+
+int PmodBLE_ConnectPeer(const u8 *address)
+{
+	return PmodBLE_Interface_ConnectPeer(&bleInterface, address);
+}
+
+void PmodBLE_GetPeer(PmodBLE_Peer *peer)
+{
+	PmodBLE_Interface_GetPeer(&bleInterface, peer);
+}
+
+void PmodBLE_SetPeer(const PmodBLE_Peer *peer)
+{
+	PmodBLE_Interface_SetPeer(&bleInterface, peer);
+}
+
+int PmodBLE_Disconnect()
+{
+	return PmodBLE_Interface_Disconnect(&bleInterface);
+}
+
+void PmodBLE_SendMessage(u8 *msg)
+{
+	PmodBLE_Interface_SendMessage(&bleInterface, msg);
+}
+
+int PmodBLE_SendBuffer(const u8 *buf, int size)
+{
+	return PmodBLE_Interface_SendBuffer(&bleInterface, buf, size);
+}
+
+int PmodBLE_SendSegments(const PmodBLE_Segment *segs, int num_segs)
+{
+	return PmodBLE_Interface_SendSegments(&bleInterface, segs, num_segs);
+}
+
+int PmodBLE_TxFree()
+{
+	return PmodBLE_Interface_TxFree(&bleInterface);
 }
 
 int PmodBLE_ReceiveMessage(u8 *buf, int size)
 {
-	return BLE_RecvData(&bleDevice, buf, size);
+	return PmodBLE_Interface_ReceiveMessage(&bleInterface, buf, size);
+}
+
+void PmodBLE_EnableRxInterrupt()
+{
+	PmodBLE_Interface_EnableRxInterrupt(&bleInterface);
+}
+
+int PmodBLE_RxAvailable()
+{
+	return PmodBLE_Interface_RxAvailable(&bleInterface);
+}
+
+int PmodBLE_RxDropped()
+{
+	return PmodBLE_Interface_RxDropped(&bleInterface);
+}
+
+int PmodBLE_DataDropped()
+{
+	return PmodBLE_Interface_DataDropped(&bleInterface);
+}
+
+int PmodBLE_TakeStatusToken()
+{
+	return PmodBLE_Interface_TakeStatusToken(&bleInterface);
 }
 
 int PmodBLE_IsConnected()
 {
-	return BLE_IsConnected(&bleDevice);
+	return PmodBLE_Interface_IsConnected(&bleInterface);
+}
+
+int PmodBLE_BeginCommands()
+{
+	return PmodBLE_Interface_BeginCommands(&bleInterface);
+}
+
+int PmodBLE_EndCommands()
+{
+	return PmodBLE_Interface_EndCommands(&bleInterface);
+}
+
+int PmodBLE_RunCommands(PmodBLE_Command *cmds, int num_cmds)
+{
+	return PmodBLE_Interface_RunCommands(&bleInterface, cmds, num_cmds);
+}
+
+int PmodBLE_ReadDeadline(u8 *buf, int num_bytes, u32 deadline, int *bytes_read)
+{
+	return PmodBLE_Interface_ReadDeadline(&bleInterface, buf, num_bytes, deadline, bytes_read);
+}
+
+int PmodBLE_ReadUntilEOLDeadline(u8 *buf, int size, char EOL, u32 deadline, int *bytes_read)
+{
+	return PmodBLE_Interface_ReadUntilEOLDeadline(&bleInterface, buf, size, EOL, deadline, bytes_read);
+}
+
+u32 PmodBLE_WorstWaitUs()
+{
+	return PmodBLE_Interface_WorstWaitUs(&bleInterface);
+}
+
+int PmodBLE_TimeoutCount()
+{
+	return PmodBLE_Interface_TimeoutCount(&bleInterface);
+}
+
+int PmodBLE_TraceRead(PmodBLE_TraceRecord *records, int max)
+{
+	return PmodBLE_Interface_TraceRead(&bleInterface, records, max);
+}
+
+void PmodBLE_TraceDump()
+{
+	PmodBLE_Interface_TraceDump(&bleInterface);
+}
+
+void PmodBLE_Flush()
+{
+	PmodBLE_Interface_Flush(&bleInterface);
 }
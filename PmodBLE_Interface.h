@@ -14,6 +14,33 @@
 #include "sleep.h"
 #include <string.h>
 #include "xil_printf.h"
+#include "PmodBLE_Tokenizer.h"
+
+// Log Levels
+// Console messages above PMODBLE_LOG_LEVEL are compiled out. DEBUG logs every
+// byte on the link and costs far more console time than the link traffic, so
+// it has to be asked for (e.g. -DPMODBLE_LOG_LEVEL=3).
+#define PMODBLE_LOG_NONE 0
+#define PMODBLE_LOG_ERROR 1
+#define PMODBLE_LOG_INFO 2
+#define PMODBLE_LOG_DEBUG 3
+#ifndef PMODBLE_LOG_LEVEL
+#define PMODBLE_LOG_LEVEL PMODBLE_LOG_ERROR
+#endif
+
+// Trace Ring
+// Number of trace records kept in RAM; 0 compiles tracing out.
+#ifndef PMODBLE_TRACE_RECORDS
+#define PMODBLE_TRACE_RECORDS 0
+#endif
+
+// Trace Events
+#define PMODBLE_TRACE_RX 1				// byte: byte read
+#define PMODBLE_TRACE_TX 2				// byte: first byte sent, arg: bytes sent
+#define PMODBLE_TRACE_CMD_ENTER 3		// arg: status
+#define PMODBLE_TRACE_CMD_EXIT 4		// arg: status
+#define PMODBLE_TRACE_TIMEOUT 5			// arg: bytes read before the deadline
+#define PMODBLE_TRACE_CONNECT 6			// arg: status
 
 // Status Codes
 #define PMODBLE_STATUS_ERR -1				// General Error
@@ -25,6 +52,23 @@
 #define PMODBLE_STATUS_CONNECTED 4			// Connected to a BLE device
 #define PMODBLE_STATUS_CONNECTION_ERR 5		// Connection error occurred
 #define PMODBLE_STATUS_DISCONNECTED 7		// Disconnected from BLE device
+#define PMODBLE_STATUS_TIMEOUT 8			// Response did not arrive in time
+
+// UART
+#define PMODBLE_UART_FIFO_BYTES 16
+#define PMODBLE_UART_CHAR_US 87				// One character at 115200 baud (10 bits)
+
+// A status message comes from the module in one piece; a '%' held back in
+// data mode that is not followed by more bytes for this long is data.
+#define PMODBLE_STATUS_GAP_US (20 * PMODBLE_UART_CHAR_US)
+
+// Response Timeouts
+#define CMD_RESPONSE_TIMEOUT_US 250000		// Reply to an ordinary command
+
+// Command Replies
+#define CMD_RESPONSE_MAX_LINE_BYTES PMODBLE_TOKEN_LINE_BYTES	// Longest reply line kept by PmodBLE_RunCommands
+#define CMD_SUCCESS_RESPONSE "AOK"
+#define CMD_ERROR_RESPONSE "ERR"
 
 // Enter Command Mode
 #define ENTER_CMD_MODE_CMD "$$$"
@@ -32,12 +76,17 @@
 #define ENTER_CMD_MODE_MAX_RESPONSE_BYTES 4
 #define ENTER_CMD_MODE_ENABLED_RESPONSE "CMD>"	// What we want to see
 #define ENTER_CMD_MODE_DISABLED_RESPONSE "CMD"
+#define ENTER_CMD_MODE_DISABLED_NUM_BYTES 3
+#define ENTER_CMD_MODE_TIMEOUT_US 250000
+#define ENTER_CMD_MODE_GUARD_US 100000		// UART silence required before "$$$"
+#define ENTER_CMD_MODE_PROMPT_GAP_US 2000	// Quiet after "CMD" that means no '>' is coming
 
 // Exit Command Mode
 #define EXIT_CMD_MODE_CMD "---\r"
 #define EXIT_CMD_MODE_CMD_NUM_BYTES 4
 #define EXIT_CMD_MODE_MAX_RESPONSE_BYTES 3
 #define EXIT_CMD_MODE_RESPONSE "END"
+#define EXIT_CMD_MODE_TIMEOUT_US 250000
 
 // Get Device Address
 #define GET_DEVICE_ADDRESS_CMD "D\r"
@@ -52,6 +101,7 @@
 #define CONN_TO_DEVICE_CONNECTED_RESPONSE "CONNECT"
 #define CONN_TO_DEVICE_SYNTAX_ERROR_RESPONSE "ERR"
 #define CONN_TO_DEVICE_CONNECT_ERROR_RESPONSE "ERR_CONN"
+#define CONN_TO_DEVICE_TIMEOUT_US 5000000	// From "Trying" to the connection status
 
 // Disconnect from Device
 #define DISCONNECT_CMD "K,1\r"
@@ -59,8 +109,145 @@
 #define DISCONNECT_CMD_MAX_RESPONSE_BYTES 12
 #define DISCONNECT_SUCCESS_RESPONSE "AOK"
 #define DISCONNECT_STATUS_RESPONSE "%DISCONNECT%"
+#define DISCONNECT_STATUS_NAME "DISCONNECT"		// Without the '%' delimiters, for the tokenizer
 #define DISCONNECT_ERR_RESPONSE "ERR"
 
+// Peer Roles
+// Of two boards, the one with the lower address dials (central) and the other
+// only advertises (peripheral), so they never dial each other at once.
+#define PMODBLE_ROLE_UNKNOWN 0
+#define PMODBLE_ROLE_CENTRAL 1
+#define PMODBLE_ROLE_PERIPHERAL 2
+
+// Other Status Messages
+// Status message names here and above, except DISCONNECT_STATUS_RESPONSE,
+// are given without their '%' delimiters.
+#define STREAM_OPEN_STATUS_RESPONSE "STREAM_OPEN"
+
+// Receive Ring
+// Size of the interrupt-fed receive ring in bytes; must be a power of two.
+#ifndef PMODBLE_RX_RING_BYTES
+#define PMODBLE_RX_RING_BYTES 256
+#endif
+
+// One piece of a scatter/gather send; the bytes are handed to the UART in
+// place, so buf must stay valid until the send call returns.
+typedef struct PmodBLE_Segment {
+	const u8 *buf;
+	int size;
+} PmodBLE_Segment;
+
+// One trace record; timestamp is in Timebase ticks.
+typedef struct PmodBLE_TraceRecord {
+	u32 timestamp;
+	u8 event;
+	u8 byte;
+	u16 arg;
+} PmodBLE_TraceRecord;
+
+// One command of a command session.
+typedef struct PmodBLE_Command {
+	const char *command;	// "<COMMAND>\r"
+	const char *expect;		// Text in the reply line that means success, e.g. "AOK"; NULL accepts any line.
+	char *response;			// Gets the matching reply line; may be NULL.
+	int response_size;
+	int status;				// Set by PmodBLE_RunCommands.
+} PmodBLE_Command;
+
+// What connecting to a peer takes, kept from one connection to the next so a
+// reconnect goes straight to the peer.
+typedef struct PmodBLE_Peer {
+	u8 address[12 + 1];			// Peer address, NUL-terminated; empty if none yet
+	u8 own_address[12 + 1];		// This module's address, read by PmodBLE_Initialize
+	u8 role;					// PMODBLE_ROLE_*
+} PmodBLE_Peer;
+
+// One PmodBLE module and everything the interface keeps for it: receive
+// ring, reply tokenizer, command mode state, peer cache and statistics. Zero
+// it (static storage does) before its first PmodBLE_Interface_Initialize.
+typedef struct PmodBLE_Interface_t {
+	PmodBLE device;
+
+	// Receive ring, fed by PmodBLE_RxInterruptHandler
+	u8 rx_ring[PMODBLE_RX_RING_BYTES];
+	volatile u32 rx_head;		// Written by the interrupt handler.
+	volatile u32 rx_tail;		// Written by the reader.
+	volatile u32 rx_dropped;
+	int rx_interrupt_enabled;
+
+	// Every byte read for a reply or as data goes through rx_tok; it is in
+	// data mode whenever the module is. Bytes read from the UART but not yet
+	// fed to it wait in tok_pending; the tokenizer stops at each token.
+	PmodBLE_Tokenizer rx_tok;
+	u8 tok_pending[PMODBLE_UART_FIFO_BYTES];
+	int tok_pending_len;
+	int tok_pending_pos;
+	int status_token;			// Last status message seen between data bytes.
+	u32 rx_data_ticks;			// When ReceiveMessage last got a byte.
+
+	// Set while a session opened by PmodBLE_BeginCommands holds command mode;
+	// the one-shot command helpers then skip their own enter/exit.
+	int cmd_session_open;
+
+	// Set while the module is known to be in command mode, so "$$$" can be
+	// skipped; cleared whenever that is no longer certain.
+	int cmd_mode_known;
+
+	// Estimated time the last byte we sent left the UART, for the guard time.
+	u32 tx_done_ticks;
+	int tx_any_sent;
+
+	// Kept in RAM; survives link losses and re-initializing, but not a power
+	// cycle unless the application saves it (PmodBLE_GetPeer / PmodBLE_SetPeer).
+	PmodBLE_Peer peer;
+
+	// Response wait statistics
+	u32 worst_wait_ticks;		// Longest time spent in a deadline read.
+	int timeout_count;
+
+#if PMODBLE_TRACE_RECORDS > 0
+	PmodBLE_TraceRecord trace_ring[PMODBLE_TRACE_RECORDS];
+	u32 trace_next;				// Total records written.
+#endif
+} PmodBLE_Interface_t;
+
+// *********** Instances *********** //
+// Each function further down has a PmodBLE_Interface_ form that takes the
+// instance first and does the same for that module; the forms without a
+// handle are thin wrappers that drive the default instance, the module
+// behind XPAR_PMODBLE_0.
+PmodBLE_Interface_t *PmodBLE_DefaultInterface();
+
+// Initializes the module behind the given PmodBLE IP base addresses.
+void PmodBLE_Interface_Initialize(PmodBLE_Interface_t *ble, u32 gpio_base, u32 uart_base);
+int PmodBLE_Interface_GetDeviceAddress(PmodBLE_Interface_t *ble, u8 *address);
+int PmodBLE_Interface_ConnectTo(PmodBLE_Interface_t *ble, u8 *address);
+int PmodBLE_Interface_ConnectPeer(PmodBLE_Interface_t *ble, const u8 *address);
+void PmodBLE_Interface_GetPeer(PmodBLE_Interface_t *ble, PmodBLE_Peer *peer);
+void PmodBLE_Interface_SetPeer(PmodBLE_Interface_t *ble, const PmodBLE_Peer *peer);
+int PmodBLE_Interface_Disconnect(PmodBLE_Interface_t *ble);
+void PmodBLE_Interface_SendMessage(PmodBLE_Interface_t *ble, u8 *msg);
+int PmodBLE_Interface_SendBuffer(PmodBLE_Interface_t *ble, const u8 *buf, int size);
+int PmodBLE_Interface_SendSegments(PmodBLE_Interface_t *ble, const PmodBLE_Segment *segs, int num_segs);
+int PmodBLE_Interface_TxFree(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_ReceiveMessage(PmodBLE_Interface_t *ble, u8 *buf, int size);
+void PmodBLE_Interface_EnableRxInterrupt(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_RxAvailable(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_RxDropped(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_DataDropped(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_TakeStatusToken(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_IsConnected(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_BeginCommands(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_EndCommands(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_RunCommands(PmodBLE_Interface_t *ble, PmodBLE_Command *cmds, int num_cmds);
+int PmodBLE_Interface_ReadDeadline(PmodBLE_Interface_t *ble, u8 *buf, int num_bytes, u32 deadline, int *bytes_read);
+int PmodBLE_Interface_ReadUntilEOLDeadline(PmodBLE_Interface_t *ble, u8 *buf, int size, char EOL, u32 deadline, int *bytes_read);
+u32 PmodBLE_Interface_WorstWaitUs(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_TimeoutCount(PmodBLE_Interface_t *ble);
+int PmodBLE_Interface_TraceRead(PmodBLE_Interface_t *ble, PmodBLE_TraceRecord *records, int max);
+void PmodBLE_Interface_TraceDump(PmodBLE_Interface_t *ble);
+void PmodBLE_Interface_Flush(PmodBLE_Interface_t *ble);
+
 // Initializes the PmodBLE
 void PmodBLE_Initialize();
 
@@ -70,21 +257,102 @@ int PmodBLE_GetDeviceAddress(u8 *address);
 // Connect PmodBLE to another Bluetooth Device
 int PmodBLE_ConnectTo(u8 *address);
 
+// Connect PmodBLE to the other board in the role the address ordering gives
+// it: the central dials address, the peripheral keeps advertising and waits.
+// Return:
+//		PMODBLE_STATUS_CONNECTED if connected
+//		PMODBLE_STATUS_CONNECTING if the other board is to dial; poll PmodBLE_IsConnected
+//		otherwise the PmodBLE_ConnectTo error
+int PmodBLE_ConnectPeer(const u8 *address);
+
+// Copy the peer cache out, or back in (e.g. from storage kept over a power
+// cycle) before the first PmodBLE_ConnectPeer.
+void PmodBLE_GetPeer(PmodBLE_Peer *peer);
+void PmodBLE_SetPeer(const PmodBLE_Peer *peer);
+
 // Disconnect PmodBLE from connected device.
-void PmodBLE_Disconnect();
+// Return: PMODBLE_STATUS_SUCCESS, or PMODBLE_STATUS_ERR if the module refused.
+int PmodBLE_Disconnect();
 
 // Send a message to the other PmodBLE device.
 void PmodBLE_SendMessage(u8 *msg);
 
-// Receive a message from PmodBLE device.
+// Send size bytes (may contain 0x00) to the other PmodBLE device.
+// Return: number of bytes sent.
+int PmodBLE_SendBuffer(const u8 *buf, int size);
+
+// Send num_segs segments back to back, e.g. a header and a payload, without
+// copying them together first.
+// Return: number of bytes sent.
+int PmodBLE_SendSegments(const PmodBLE_Segment *segs, int num_segs);
+
+// Bytes the UART TX FIFO should take right now without a send having to wait,
+// from when the bytes sent so far leave the wire.
+int PmodBLE_TxFree();
+
+// Receive a message from PmodBLE device; copies out whatever has arrived, up to size bytes.
+// Status messages from the module are taken out (see PmodBLE_TakeStatusToken).
 int PmodBLE_ReceiveMessage(u8 *buf, int size);
 
+// Switches receiving over to the interrupt-fed ring. PmodBLE_RxInterruptHandler
+// must already be connected to the PmodBLE UART interrupt.
+void PmodBLE_EnableRxInterrupt();
+
+// PmodBLE UART interrupt handler; moves received bytes into the ring of the
+// instance given as CallbackRef (NULL for the default instance).
+void PmodBLE_RxInterruptHandler(void *CallbackRef);
+
+// Number of received bytes waiting in the ring.
+int PmodBLE_RxAvailable();
+
+// Number of received bytes dropped because the ring was full.
+int PmodBLE_RxDropped();
+
+// Number of data bytes dropped because they were not taken out of the
+// tokenizer in time (e.g. data that arrived while waiting for a reply).
+int PmodBLE_DataDropped();
+
+// Takes the last status message (e.g. PMODBLE_TOKEN_DISCONNECT) that arrived
+// between received data bytes.
+// Return: the status token, or PMODBLE_TOKEN_NONE if none arrived since the last call.
+int PmodBLE_TakeStatusToken();
+
 // Checks if the PmodBLE device is connected to another device.
 // Return:
 //		1 if connected
 //		0 if not connected
 int PmodBLE_IsConnected();
 
+// Enter command mode once for several commands. While a session is open, the
+// other PmodBLE calls that use command mode do not enter or leave it themselves.
+int PmodBLE_BeginCommands();
+
+// Leave command mode and close the session.
+int PmodBLE_EndCommands();
+
+// Run a list of commands in one session (opening one if needed); sets each command's status.
+// Return: PMODBLE_STATUS_SUCCESS if every command got its expected reply.
+int PmodBLE_RunCommands(PmodBLE_Command *cmds, int num_cmds);
+
+// Read num_bytes bytes, or whatever arrives before the Timebase deadline.
+// Return: PMODBLE_STATUS_SUCCESS or PMODBLE_STATUS_TIMEOUT; *bytes_read is set either way.
+int PmodBLE_ReadDeadline(u8 *buf, int num_bytes, u32 deadline, int *bytes_read);
+
+// Read a line ending in EOL (not stored), or whatever arrives before the Timebase deadline.
+// Return: PMODBLE_STATUS_SUCCESS or PMODBLE_STATUS_TIMEOUT; *bytes_read is set either way.
+int PmodBLE_ReadUntilEOLDeadline(u8 *buf, int size, char EOL, u32 deadline, int *bytes_read);
+
+// Longest response wait so far in microseconds, and number of waits that timed out.
+u32 PmodBLE_WorstWaitUs();
+int PmodBLE_TimeoutCount();
+
+// Copies out up to max trace records, oldest first, and empties the ring.
+// Return: number of records copied (always 0 when tracing is compiled out).
+int PmodBLE_TraceRead(PmodBLE_TraceRecord *records, int max);
+
+// Prints the trace ring over the console and empties it.
+void PmodBLE_TraceDump();
+
 // Flushes recieve buffers
 void PmodBLE_Flush();
 
@@ -0,0 +1,301 @@
+/*
+ * PmodBLE_Tokenizer.c
+ *
+ *  Byte-at-a-time matcher for the replies and status messages of the RN4871.
+ */
+
+#include <string.h>
+#include "PmodBLE_Tokenizer.h"
+#include "PmodBLE_Interface.h"
+
+// *********** Token Tables *********** //
+// Built from the response macros; matched against a whole reply line or a
+// whole status message name, never a substring of one.
+typedef struct PmodBLE_TokenEntry {
+	const char *text;
+	u8 token;
+} PmodBLE_TokenEntry;
+
+static const PmodBLE_TokenEntry line_tokens[] = {
+	{ CMD_SUCCESS_RESPONSE, PMODBLE_TOKEN_AOK },
+	{ CMD_ERROR_RESPONSE, PMODBLE_TOKEN_ERR },
+	{ CONN_TO_DEVICE_STARTING_RESPONSE, PMODBLE_TOKEN_TRYING },
+	{ EXIT_CMD_MODE_RESPONSE, PMODBLE_TOKEN_END },
+	{ ENTER_CMD_MODE_ENABLED_RESPONSE, PMODBLE_TOKEN_CMD_PROMPT },
+};
+
+static const PmodBLE_TokenEntry status_tokens[] = {
+	{ CONN_TO_DEVICE_CONNECTED_RESPONSE, PMODBLE_TOKEN_CONNECT },
+	{ DISCONNECT_STATUS_NAME, PMODBLE_TOKEN_DISCONNECT },
+	{ CONN_TO_DEVICE_CONNECT_ERROR_RESPONSE, PMODBLE_TOKEN_ERR_CONN },
+	{ STREAM_OPEN_STATUS_RESPONSE, PMODBLE_TOKEN_STREAM_OPEN },
+};
+
+#define NUM_ENTRIES(table) ((int) (sizeof(table) / sizeof(table[0])))
+
+// *********** Automaton *********** //
+// A trie of both tables, built once: the line and the status name each move
+// one state per byte, so a byte costs two table loads whatever the tables
+// hold, and a token is known the moment its text ends. Bytes are mapped to
+// columns first; only the characters of the entries get one.
+#define TRIE_DEAD 0			// No entry starts with the bytes so far
+#define TRIE_LINE 1			// Start of a reply line
+#define TRIE_STATUS 2		// Start of a status message name, after its '%'
+#define TRIE_STATES 64		// At least 3 plus the characters of all entries
+#define TRIE_COLUMNS 32		// At least 1 plus the distinct characters
+
+static u8 trie_column[128];
+static u8 trie_next[TRIE_STATES][TRIE_COLUMNS];
+static u8 trie_token[TRIE_STATES];		// Token of the entry ending in each state
+static int trie_states;					// States in use; 0 until built
+static int trie_columns;
+
+static void PmodBLE_TrieAdd(u8 root, const PmodBLE_TokenEntry *entry);
+static void PmodBLE_TrieBuild();
+static u8 PmodBLE_TrieStep(u8 state, u8 byte);
+static int PmodBLE_TokenizeLine(PmodBLE_Tokenizer *tok, u8 byte);
+static int PmodBLE_TokenizeStatus(PmodBLE_Tokenizer *tok, u8 byte);
+static void PmodBLE_TokenizerData(PmodBLE_Tokenizer *tok, const u8 *buf, int size);
+
+/*
+ * Adds the states for an entry's text under root. An entry that does not
+ * fit in the table is left out and never matches.
+ */
+static void PmodBLE_TrieAdd(u8 root, const PmodBLE_TokenEntry *entry)
+{
+	u8 state = root;
+
+	for (const char *c = entry->text; *c != '\0'; c++)
+	{
+		u8 *column = &trie_column[*c & 0x7F];
+		if (*column == 0)
+		{
+			if (trie_columns == TRIE_COLUMNS)
+			{
+				return;
+			}
+			*column = trie_columns++;
+		}
+
+		u8 *next = &trie_next[state][*column];
+		if (*next == TRIE_DEAD)
+		{
+			if (trie_states == TRIE_STATES)
+			{
+				return;
+			}
+			*next = trie_states++;
+		}
+		state = *next;
+	}
+	trie_token[state] = entry->token;
+}
+
+static void PmodBLE_TrieBuild()
+{
+	// Column 0 is for bytes in no entry; every state leads to TRIE_DEAD on it.
+	trie_columns = 1;
+	trie_states = TRIE_STATUS + 1;
+
+	for (int i = 0; i < NUM_ENTRIES(line_tokens); i++)
+	{
+		PmodBLE_TrieAdd(TRIE_LINE, &line_tokens[i]);
+	}
+	for (int i = 0; i < NUM_ENTRIES(status_tokens); i++)
+	{
+		PmodBLE_TrieAdd(TRIE_STATUS, &status_tokens[i]);
+	}
+}
+
+static u8 PmodBLE_TrieStep(u8 state, u8 byte)
+{
+	return byte < 0x80 ? trie_next[state][trie_column[byte]] : TRIE_DEAD;
+}
+
+/*
+ * Appends bytes to the data waiting for the caller; bytes that do not fit
+ * are dropped and counted (the caller keeps room for one status message).
+ */
+static void PmodBLE_TokenizerData(PmodBLE_Tokenizer *tok, const u8 *buf, int size)
+{
+	int space = PMODBLE_TOKEN_DATA_BYTES - tok->data_len;
+	if (size > space)
+	{
+		tok->dropped += size - space;
+		size = space;
+	}
+	memcpy(&tok->data[tok->data_len], buf, size);
+	tok->data_len += size;
+}
+
+void PmodBLE_TokenizerReset(PmodBLE_Tokenizer *tok, int data_mode)
+{
+	if (trie_states == 0)
+	{
+		PmodBLE_TrieBuild();
+	}
+
+	tok->data_mode = data_mode;
+	tok->line[0] = '\0';
+	tok->line_len = 0;
+	tok->line_state = TRIE_LINE;
+	tok->line_done = 0;
+	tok->status[0] = '\0';
+	tok->status_len = 0;
+	tok->name_len = 0;
+	tok->data_len = 0;
+}
+
+/*
+ * Adds a byte to the reply line. A line token is reported at the CR or LF
+ * that ends the line, the prompt as soon as its '>' arrives.
+ */
+static int PmodBLE_TokenizeLine(PmodBLE_Tokenizer *tok, u8 byte)
+{
+	if (tok->line_done)
+	{
+		tok->line[0] = '\0';
+		tok->line_len = 0;
+		tok->line_state = TRIE_LINE;
+		tok->line_done = 0;
+	}
+
+	if (byte == '\r' || byte == '\n')
+	{
+		if (tok->line_len == 0)
+		{
+			return PMODBLE_TOKEN_NONE;	// The LF of a CR LF, or a blank line.
+		}
+		tok->line_done = 1;
+
+		int token = trie_token[tok->line_state];
+		return token != PMODBLE_TOKEN_NONE ? token : PMODBLE_TOKEN_LINE;
+	}
+
+	if (byte == ' ' && tok->line_len == 0)
+	{
+		return PMODBLE_TOKEN_NONE;	// The space after "CMD>".
+	}
+
+	if (tok->line_len < PMODBLE_TOKEN_LINE_BYTES - 1)
+	{
+		tok->line[tok->line_len++] = byte;
+		tok->line[tok->line_len] = '\0';
+	}
+
+	tok->line_state = PmodBLE_TrieStep(tok->line_state, byte);
+	if (trie_token[tok->line_state] == PMODBLE_TOKEN_CMD_PROMPT)
+	{
+		tok->line_done = 1;
+		return PMODBLE_TOKEN_CMD_PROMPT;
+	}
+	return PMODBLE_TOKEN_NONE;
+}
+
+/*
+ * Adds a byte to the status message that a '%' started. In data mode the
+ * held bytes go back to the data as soon as they cannot be a known status
+ * message; the byte that showed it is then fed again on its own, since it
+ * may start the next one.
+ */
+static int PmodBLE_TokenizeStatus(PmodBLE_Tokenizer *tok, u8 byte)
+{
+	int ends_name = tok->name_len == 0 && (byte == '%' || byte == ',');
+	int token = PMODBLE_TOKEN_NONE;
+	int known = 1;
+
+	if (ends_name)
+	{
+		// name_state stays on the name's last byte for the closing '%'.
+		tok->name_len = tok->status_len - 1;
+		token = trie_token[tok->name_state];
+		known = token != PMODBLE_TOKEN_NONE;
+	}
+	else if (tok->name_len == 0)
+	{
+		tok->name_state = PmodBLE_TrieStep(tok->name_state, byte);
+		known = tok->name_state != TRIE_DEAD;
+	}
+
+	if (tok->data_mode && (!known || (tok->status_len == PMODBLE_TOKEN_STATUS_BYTES - 1 && byte != '%')))
+	{
+		PmodBLE_TokenizerData(tok, (u8 *) tok->status, tok->status_len);
+		tok->status_len = 0;
+		return PmodBLE_Tokenize(tok, byte);
+	}
+
+	tok->status[tok->status_len++] = byte;
+	tok->status[tok->status_len] = '\0';
+
+	if (byte == '%')
+	{
+		// Finished; status keeps the message until the next one starts.
+		tok->status_len = 0;
+		if (!ends_name)
+		{
+			token = trie_token[tok->name_state];
+		}
+		return token != PMODBLE_TOKEN_NONE ? token : PMODBLE_TOKEN_STATUS;
+	}
+
+	if (tok->status_len == PMODBLE_TOKEN_STATUS_BYTES)
+	{
+		tok->status_len = 0;	// Too long to be a status message; drop it.
+	}
+	return PMODBLE_TOKEN_NONE;
+}
+
+/*
+ * Feeds one byte.
+ *
+ * Input:
+ * 		tok - Tokenizer state.
+ * 		byte - Next byte from the module.
+ * Output:
+ * 		The token this byte finished, or PMODBLE_TOKEN_NONE. For
+ * 		PMODBLE_TOKEN_LINE the text is in tok->line, for the status tokens
+ * 		the whole message is in tok->status.
+ */
+int PmodBLE_Tokenize(PmodBLE_Tokenizer *tok, u8 byte)
+{
+	if (tok->status_len > 0)
+	{
+		return PmodBLE_TokenizeStatus(tok, byte);
+	}
+
+	if (byte == '%')
+	{
+		tok->status[0] = '%';
+		tok->status[1] = '\0';
+		tok->status_len = 1;
+		tok->name_len = 0;
+		tok->name_state = TRIE_STATUS;
+		return PMODBLE_TOKEN_NONE;
+	}
+
+	if (tok->data_mode)
+	{
+		PmodBLE_TokenizerData(tok, &byte, 1);
+		return PMODBLE_TOKEN_NONE;
+	}
+	return PmodBLE_TokenizeLine(tok, byte);
+}
+
+void PmodBLE_TokenizerRelease(PmodBLE_Tokenizer *tok)
+{
+	if (tok->data_mode && tok->status_len > 0)
+	{
+		PmodBLE_TokenizerData(tok, (u8 *) tok->status, tok->status_len);
+		tok->status_len = 0;
+	}
+}
+
+int PmodBLE_TokenizerTakeData(PmodBLE_Tokenizer *tok, u8 *buf, int size)
+{
+	int n = tok->data_len < size ? tok->data_len : size;
+
+	memcpy(buf, tok->data, n);
+	memmove(tok->data, &tok->data[n], tok->data_len - n);
+	tok->data_len -= n;
+	return n;
+}
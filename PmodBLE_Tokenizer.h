@@ -0,0 +1,86 @@
+/*
+ * PmodBLE_Tokenizer.h
+ *
+ *  Byte-at-a-time matcher for the replies and status messages of the RN4871.
+ *
+ *  The module sends two kinds of text:
+ *
+ *		reply lines		"AOK\r\n", "ERR\r\n", "Trying\r\n", "END\r\n", "BTA=...\r\n"
+ *		status messages	"%CONNECT,0,801F12B6BB36%", "%ERR_CONN%", "%DISCONNECT%"
+ *
+ *  plus the "CMD> " prompt, which has no line ending. Every byte is fed to
+ *  PmodBLE_Tokenize, which reports a token the moment its last byte arrives:
+ *  a line at its CR/LF, a status message at its closing '%' and the prompt at
+ *  its '>'. Lines and status messages are matched as whole words, so "ERR"
+ *  never matches inside "%ERR_CONN%". The match is one step of a transition
+ *  table per byte, built from the response macros on the first reset.
+ *
+ *  In data mode everything that is not a known status message is data for the
+ *  caller; a '%' that could start one is held back until it either completes
+ *  or stops matching, and is then handed over as data after all.
+ */
+
+#ifndef SRC_PMODBLE_TOKENIZER_H_
+#define SRC_PMODBLE_TOKENIZER_H_
+
+#include "xil_types.h"
+
+// Tokens
+#define PMODBLE_TOKEN_NONE 0			// Nothing finished yet
+#define PMODBLE_TOKEN_LINE 1			// Some other reply line; see line
+#define PMODBLE_TOKEN_AOK 2
+#define PMODBLE_TOKEN_ERR 3
+#define PMODBLE_TOKEN_TRYING 4
+#define PMODBLE_TOKEN_END 5
+#define PMODBLE_TOKEN_CMD_PROMPT 6		// "CMD>"
+#define PMODBLE_TOKEN_STATUS 7			// Some other "%...%" status message; see status
+#define PMODBLE_TOKEN_CONNECT 8			// "%CONNECT,...%"
+#define PMODBLE_TOKEN_DISCONNECT 9		// "%DISCONNECT%"
+#define PMODBLE_TOKEN_ERR_CONN 10		// "%ERR_CONN%"
+#define PMODBLE_TOKEN_STREAM_OPEN 11	// "%STREAM_OPEN%"
+
+// Tokens that end a reply line; the line is in the tokenizer's line.
+#define PMODBLE_TOKEN_IS_LINE(token) ((token) >= PMODBLE_TOKEN_LINE && (token) <= PMODBLE_TOKEN_END)
+
+// Sizes
+#define PMODBLE_TOKEN_LINE_BYTES 64		// Longest reply line kept; longer lines are cut
+#define PMODBLE_TOKEN_STATUS_BYTES 32	// Longest status message, both '%' included
+#define PMODBLE_TOKEN_DATA_BYTES (2 * PMODBLE_TOKEN_STATUS_BYTES)
+
+typedef struct PmodBLE_Tokenizer {
+	u8 data_mode;		// Non-zero: bytes outside status messages are data.
+
+	// Reply line; '\0' terminated, valid until the next byte after a line token.
+	char line[PMODBLE_TOKEN_LINE_BYTES];
+	int line_len;
+	u8 line_state;		// Matcher state after the line so far
+	u8 line_done;
+
+	// Status message being matched, starting with its '%'; '\0' terminated.
+	char status[PMODBLE_TOKEN_STATUS_BYTES + 1];
+	int status_len;
+	int name_len;		// Length of the name (after '%', before ',' or '%'); 0 while still in it.
+	u8 name_state;		// Matcher state after the name so far
+
+	// Data-mode bytes waiting for the caller (see PmodBLE_TokenizerTakeData).
+	u8 data[PMODBLE_TOKEN_DATA_BYTES];
+	int data_len;
+	u32 dropped;		// Data bytes lost because data was full; kept over resets.
+} PmodBLE_Tokenizer;
+
+// Resets the tokenizer and selects command mode (data_mode 0) or data mode.
+void PmodBLE_TokenizerReset(PmodBLE_Tokenizer *tok, int data_mode);
+
+// Feeds one byte.
+// Return: the token that this byte finished, or PMODBLE_TOKEN_NONE.
+int PmodBLE_Tokenize(PmodBLE_Tokenizer *tok, u8 byte);
+
+// In data mode, hands the bytes of a status message still being matched
+// over as data; for a '%' that nothing followed.
+void PmodBLE_TokenizerRelease(PmodBLE_Tokenizer *tok);
+
+// Moves up to size data bytes out of the tokenizer, oldest first.
+// Return: number of bytes moved.
+int PmodBLE_TokenizerTakeData(PmodBLE_Tokenizer *tok, u8 *buf, int size);
+
+#endif /* SRC_PMODBLE_TOKENIZER_H_ */
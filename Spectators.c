@@ -0,0 +1,201 @@
+/*
+ * Spectators.c
+ *
+ *  Live game broadcast to boards that only watch.
+ */
+
+#include <string.h>
+#include "Spectators.h"
+
+#define RING_MASK (SPECTATORS_RING_FRAMES - 1)
+
+static void Spectators_EncodeSnapshot(const Spectators *sp, u8 *frame);
+
+void Spectators_Initialize(Spectators *sp)
+{
+	memset(sp, 0, sizeof(*sp));
+	sp->to_move = BOARD_X;
+}
+
+int Spectators_AddSeat(Spectators *sp, PmodBLE_Interface_t *ble)
+{
+	if (sp->num_seats == SPECTATORS_SEATS)
+	{
+		return 0;
+	}
+	Spectators_Seat *seat = &sp->seats[sp->num_seats++];
+	seat->ble = ble;
+	seat->next = sp->head;
+	seat->watching = 0;
+	seat->snapshot_due = 0;
+	return 1;
+}
+
+// *********** Publishing *********** //
+static void Spectators_EncodeSnapshot(const Spectators *sp, u8 *frame)
+{
+	u16 x = sp->board.tiles[0];
+	u16 o = sp->board.tiles[1];
+
+	MoveLink_Encode(frame, SPECTATORS_TYPE_SNAPSHOT, x & 0xFF, o & 0xFF,
+			((x >> 8) & 1) << 3 | ((o >> 8) & 1) << 2, sp->to_move);
+}
+
+void Spectators_NewGame(Spectators *sp, u8 first_tile)
+{
+	Board_Clear(&sp->board);
+	sp->to_move = first_tile;
+	sp->moves = 0;
+	Spectators_EncodeSnapshot(sp, sp->ring[sp->head & RING_MASK]);
+	sp->head++;
+	sp->published++;
+}
+
+void Spectators_Publish(Spectators *sp, u8 cell, u8 tile)
+{
+	Board_Place(&sp->board, tile, cell);
+	sp->to_move = tile == BOARD_X ? BOARD_O : BOARD_X;
+	sp->moves++;
+	MoveLink_Encode(sp->ring[sp->head & RING_MASK], SPECTATORS_TYPE_MOVE, sp->moves, 0, cell, tile);
+	sp->head++;
+	sp->published++;
+}
+
+// *********** Fan-out *********** //
+/*
+ * A seat that connects, or whose next frame has been overwritten, is sent a
+ * snapshot of the game so far and continues from the newest frame.
+ */
+void Spectators_Run(Spectators *sp)
+{
+	u8 frame[MOVELINK_FRAME_BYTES];
+
+	for (int i = 0; i < sp->num_seats; i++)
+	{
+		Spectators_Seat *seat = &sp->seats[i];
+
+		if (!PmodBLE_Interface_IsConnected(seat->ble))
+		{
+			seat->watching = 0;
+			continue;
+		}
+		if (!seat->watching)
+		{
+			seat->watching = 1;
+			seat->snapshot_due = 1;
+			sp->joins++;
+		}
+		if (sp->head - seat->next > SPECTATORS_RING_FRAMES)
+		{
+			seat->snapshot_due = 1;
+		}
+
+		int room = PmodBLE_Interface_TxFree(seat->ble) / MOVELINK_FRAME_BYTES;
+		if (seat->snapshot_due && room > 0)
+		{
+			Spectators_EncodeSnapshot(sp, frame);
+			PmodBLE_Interface_SendBuffer(seat->ble, frame, MOVELINK_FRAME_BYTES);
+			seat->next = sp->head;
+			seat->snapshot_due = 0;
+			sp->snapshots_sent++;
+			sp->frames_sent++;
+			room--;
+		}
+		while (!seat->snapshot_due && room > 0 && seat->next != sp->head)
+		{
+			PmodBLE_Interface_SendBuffer(seat->ble, sp->ring[seat->next & RING_MASK], MOVELINK_FRAME_BYTES);
+			seat->next++;
+			sp->frames_sent++;
+			room--;
+		}
+	}
+}
+
+// *********** Watching *********** //
+void Spectators_ViewInitialize(Spectators_View *view, PmodBLE_Interface_t *ble)
+{
+	memset(view, 0, sizeof(*view));
+	view->ble = ble;
+}
+
+/*
+ * Frames are decoded where they sit in the receive buffer, as in
+ * MoveLink_Poll; a move that does not follow the last one is dropped and
+ * counted as a gap. The contents come off the air, so a frame with a cell
+ * or tile out of range, or a snapshot with a cell taken by both tiles, is
+ * dropped before anything is copied out.
+ */
+int Spectators_Watch(Spectators_View *view, Spectators_Event *events, int max)
+{
+	int count = 0;
+	int idx = 0;
+
+	view->rx_len += PmodBLE_Interface_ReceiveMessage(view->ble, &view->rx_buf[view->rx_len], MOVELINK_RX_BYTES - view->rx_len);
+
+	while (view->rx_len - idx >= MOVELINK_FRAME_BYTES && count < max)
+	{
+		const u8 *frame = &view->rx_buf[idx];
+
+		if (frame[0] != MOVELINK_SYNC)
+		{
+			idx++;
+			continue;
+		}
+		if (MoveLink_Crc8(&frame[1], 4) != frame[5])
+		{
+			view->crc_errors++;
+			idx++;
+			continue;
+		}
+		idx += MOVELINK_FRAME_BYTES;
+		view->frames_received++;
+
+		Spectators_Event *event = &events[count];
+		if (frame[1] == SPECTATORS_TYPE_SNAPSHOT)
+		{
+			u16 x = frame[2] | ((frame[4] >> 7) & 1) << 8;
+			u16 o = frame[3] | ((frame[4] >> 6) & 1) << 8;
+			u8 to_move = frame[4] & 0x0F;
+			if ((x & o) != 0 || (to_move != BOARD_X && to_move != BOARD_O))
+			{
+				view->rejected++;
+				continue;
+			}
+			event->kind = SPECTATORS_EVENT_SNAPSHOT;
+			event->board.tiles[0] = x;
+			event->board.tiles[1] = o;
+			event->to_move = to_move;
+			view->moves = 0;
+			for (int cell = 0; cell < BOARD_CELLS; cell++)
+			{
+				view->moves += Board_TileAt(&event->board, cell) != BOARD_EMPTY;
+			}
+			count++;
+		}
+		else if (frame[1] == SPECTATORS_TYPE_MOVE)
+		{
+			u8 cell = frame[4] >> 4;
+			u8 tile = frame[4] & 0x0F;
+			if (cell >= BOARD_CELLS || (tile != BOARD_X && tile != BOARD_O))
+			{
+				view->rejected++;
+				continue;
+			}
+			if (frame[2] != (u8) (view->moves + 1))
+			{
+				view->gaps += frame[2] > view->moves;
+				continue;
+			}
+			event->kind = SPECTATORS_EVENT_MOVE;
+			event->cell = cell;
+			event->tile = tile;
+			view->moves++;
+			count++;
+		}
+	}
+
+	// Keep the unparsed tail for the next poll.
+	memmove(view->rx_buf, &view->rx_buf[idx], view->rx_len - idx);
+	view->rx_len -= idx;
+	return count;
+}
@@ -0,0 +1,119 @@
+/*
+ * Spectators.h
+ *
+ *  Live game broadcast to boards that only watch.
+ *
+ *  The playing board has spare PmodBLE modules ("seats") that spectator
+ *  boards connect to. Each accepted move is encoded once, with the MoveLink
+ *  frame layout, into a ring shared by every seat; each seat only keeps its
+ *  place in that ring. Spectators_Publish does no I/O, so the players' path
+ *  costs one frame encode however many boards watch; Spectators_Run hands
+ *  the frames out from the main loop, only as much per seat as its UART FIFO
+ *  takes without waiting.
+ *
+ *  Frames:
+ *
+ *		SPECTATORS_TYPE_SNAPSHOT	[2] X cells 0..7, [3] O cells 0..7,
+ *									[4] X cell 8 << 7 | O cell 8 << 6 | tile to move
+ *		SPECTATORS_TYPE_MOVE		[2] move number in the game (1 for the first),
+ *									[4] cell << 4 | tile
+ *
+ *  A new game is an empty snapshot. A board that connects late, or falls
+ *  more than SPECTATORS_RING_FRAMES behind, gets one snapshot of the game so
+ *  far and then the live moves. Only the 3x3 game is broadcast.
+ */
+
+#ifndef SRC_SPECTATORS_H_
+#define SRC_SPECTATORS_H_
+
+#include "xil_types.h"
+#include "Board.h"
+#include "MoveLink.h"
+#include "PmodBLE_Interface.h"
+
+// Seats
+#define SPECTATORS_SEATS 4
+
+// Frames kept for seats that are behind; must be a power of two.
+#define SPECTATORS_RING_FRAMES 16
+
+// Frame Types; apart from the MoveLink ones
+#define SPECTATORS_TYPE_SNAPSHOT 0x10
+#define SPECTATORS_TYPE_MOVE 0x11
+
+typedef struct Spectators_Seat {
+	PmodBLE_Interface_t *ble;
+	u32 next;				// Next frame to send, counted like head
+	u8 watching;			// Connected and being sent frames
+	u8 snapshot_due;
+} Spectators_Seat;
+
+typedef struct Spectators {
+	u8 ring[SPECTATORS_RING_FRAMES][MOVELINK_FRAME_BYTES];	// Encoded once for every seat
+	u32 head;				// Frames published, free running
+	Spectators_Seat seats[SPECTATORS_SEATS];
+	int num_seats;
+
+	// The game so far, for snapshots
+	Board board;
+	u8 to_move;
+	u8 moves;
+
+	// Statistics
+	u32 published;
+	u32 frames_sent;		// Summed over the seats
+	u32 snapshots_sent;
+	u32 joins;
+} Spectators;
+
+// The watching side: frames read from one PmodBLE instance.
+typedef struct Spectators_View {
+	PmodBLE_Interface_t *ble;
+	u8 rx_buf[MOVELINK_RX_BYTES];
+	int rx_len;
+	u8 moves;				// Moves of the watched game seen so far
+
+	// Statistics
+	u32 frames_received;
+	u32 crc_errors;
+	u32 rejected;			// Frames with a cell, tile or board no game can have
+	u32 gaps;				// Moves that went missing; the next snapshot mends them
+} Spectators_View;
+
+// What a view got from the watched game.
+#define SPECTATORS_EVENT_SNAPSHOT 1		// board and to_move replace the game
+#define SPECTATORS_EVENT_MOVE 2			// cell and tile are the next move
+
+typedef struct Spectators_Event {
+	u8 kind;
+	u8 cell;
+	u8 tile;
+	u8 to_move;
+	Board board;
+} Spectators_Event;
+
+// No seats, no game.
+void Spectators_Initialize(Spectators *sp);
+
+// Adds a PmodBLE instance spectators connect to; it should be advertising.
+// Return: 1 if added, 0 if every seat is taken.
+int Spectators_AddSeat(Spectators *sp, PmodBLE_Interface_t *ble);
+
+// Starts a new game with first_tile to move.
+void Spectators_NewGame(Spectators *sp, u8 first_tile);
+
+// Queues a move for every watching seat; encodes one frame, no I/O.
+void Spectators_Publish(Spectators *sp, u8 cell, u8 tile);
+
+// Event handler: notices boards connecting and leaving, and sends each
+// watching seat what it is missing, as far as its UART FIFO has room.
+void Spectators_Run(Spectators *sp);
+
+// Starts watching over ble.
+void Spectators_ViewInitialize(Spectators_View *view, PmodBLE_Interface_t *ble);
+
+// Reads what arrived and copies out up to max events, in order.
+// Return: number of events copied.
+int Spectators_Watch(Spectators_View *view, Spectators_Event *events, int max);
+
+#endif /* SRC_SPECTATORS_H_ */
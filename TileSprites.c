@@ -0,0 +1,48 @@
+/*
+ * TileSprites.c
+ *
+ *  Generated by sim/gen_sprites.c (make -C sim sprites); do not edit.
+ */
+
+#include "TileSprites.h"
+
+static const u32 TileSprite_X_rows[14] = {
+	0x00100001,
+	0x000C0006,
+	0x00020008,
+	0x00018030,
+	0x00004040,
+	0x00003180,
+	0x00000E00,
+	0x00000E00,
+	0x00003180,
+	0x00004040,
+	0x00018030,
+	0x00020008,
+	0x000C0006,
+	0x00100001,
+};
+
+const OledFb_Sprite TileSprite_X = { 6, 4, 21, 14, TileSprite_X_rows };
+
+static const u32 TileSprite_O_rows[17] = {
+	0x000007C0,
+	0x00001830,
+	0x00002008,
+	0x00004004,
+	0x00008002,
+	0x00008002,
+	0x00010001,
+	0x00010001,
+	0x00010001,
+	0x00010001,
+	0x00010001,
+	0x00008002,
+	0x00008002,
+	0x00004004,
+	0x00002008,
+	0x00001830,
+	0x000007C0,
+};
+
+const OledFb_Sprite TileSprite_O = { 8, 2, 17, 17, TileSprite_O_rows };
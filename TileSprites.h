@@ -0,0 +1,25 @@
+/*
+ * TileSprites.h
+ *
+ *  X and O glyphs for one 32x21 board cell.
+ *
+ *  The glyphs are rasterised once on the host by sim/gen_sprites.c
+ *  (make -C sim sprites), which writes TileSprites.c. Drawing a tile is then
+ *  a bitmap copy into the framebuffer and one window write; no line or
+ *  circle is computed on the target.
+ */
+
+#ifndef SRC_TILESPRITES_H_
+#define SRC_TILESPRITES_H_
+
+#include "OledFb.h"
+
+// Board cell size in pixels; cell (row, col) starts at (col * 32, row * 21).
+#define TILESPRITE_CELL_WIDTH 32
+#define TILESPRITE_CELL_HEIGHT 21
+
+// Offsets are relative to the cell's top left corner.
+extern const OledFb_Sprite TileSprite_X;
+extern const OledFb_Sprite TileSprite_O;
+
+#endif /* SRC_TILESPRITES_H_ */
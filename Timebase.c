@@ -0,0 +1,54 @@
+/*
+ * Timebase.c
+ *
+ *  Free-running tick counter used for timeouts and latency measurements.
+ */
+
+#include "Timebase.h"
+
+#ifdef XPAR_TMRCTR_0_BASEADDR
+#include "xtmrctr_l.h"
+#define TIMEBASE_TIMER 0
+#else
+static u32 sw_ticks = 0;
+#endif
+
+/*
+ * Starts timer 0 counting up from 0 and reloading on overflow.
+ */
+void Timebase_Initialize()
+{
+#ifdef XPAR_TMRCTR_0_BASEADDR
+	XTmrCtr_SetLoadReg(XPAR_TMRCTR_0_BASEADDR, TIMEBASE_TIMER, 0);
+	XTmrCtr_LoadTimerCounterReg(XPAR_TMRCTR_0_BASEADDR, TIMEBASE_TIMER);
+	XTmrCtr_SetControlStatusReg(XPAR_TMRCTR_0_BASEADDR, TIMEBASE_TIMER,
+			XTC_CSR_ENABLE_TMR_MASK | XTC_CSR_AUTO_RELOAD_MASK);
+#else
+	sw_ticks = 0;
+#endif
+}
+
+u32 Timebase_Ticks()
+{
+#ifdef XPAR_TMRCTR_0_BASEADDR
+	return XTmrCtr_GetTimerCounterReg(XPAR_TMRCTR_0_BASEADDR, TIMEBASE_TIMER);
+#else
+	sw_ticks += TIMEBASE_SW_TICKS_PER_CALL;
+	return sw_ticks;
+#endif
+}
+
+u32 Timebase_Deadline(u32 us)
+{
+	return Timebase_Ticks() + us * TIMEBASE_TICKS_PER_US;
+}
+
+int Timebase_Expired(u32 deadline)
+{
+	return (s32) (Timebase_Ticks() - deadline) >= 0;
+}
+
+u32 Timebase_TicksToUs(u32 ticks)
+{
+	return ticks / TIMEBASE_TICKS_PER_US;
+}
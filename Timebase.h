@@ -0,0 +1,41 @@
+/*
+ * Timebase.h
+ *
+ *  Free-running tick counter used for timeouts and latency measurements.
+ *  Backed by timer 0 of the AXI Timer when the design has one.
+ */
+
+#ifndef SRC_TIMEBASE_H_
+#define SRC_TIMEBASE_H_
+
+#include "xparameters.h"
+#include "xil_types.h"
+
+#ifdef XPAR_TMRCTR_0_BASEADDR
+#define TIMEBASE_TICKS_PER_US (XPAR_TMRCTR_0_CLOCK_FREQ_HZ / 1000000)
+#else
+// Without a timer every Timebase_Ticks() call counts as this many ticks, so
+// deadlines still expire, just not at an exact time.
+#define TIMEBASE_TICKS_PER_US 1
+#define TIMEBASE_SW_TICKS_PER_CALL 2
+#endif
+
+// Starts the free-running counter.
+void Timebase_Initialize();
+
+// Current tick count; wraps around, so only compare differences.
+u32 Timebase_Ticks();
+
+// Tick count us microseconds from now.
+u32 Timebase_Deadline(u32 us);
+
+// Checks if a deadline has passed.
+// Return:
+//		1 if it has passed
+//		0 if not
+int Timebase_Expired(u32 deadline);
+
+// Converts a tick difference to microseconds.
+u32 Timebase_TicksToUs(u32 ticks);
+
+#endif /* SRC_TIMEBASE_H_ */
@@ -0,0 +1,101 @@
+/*
+ * Ultimate.c
+ *
+ *  Ultimate tic-tac-toe: nine 3x3 sub-boards laid out as a 3x3 board.
+ */
+
+#include <string.h>
+#include "Ultimate.h"
+
+void Ultimate_Initialize(Ultimate *game)
+{
+	memset(game, 0, sizeof(*game));
+	game->next = ULTIMATE_ANY_BOARD;
+	game->to_move = BOARD_X;
+	game->result = BOARD_RESULT_PLAYING;
+}
+
+int Ultimate_IsLegal(const Ultimate *game, int move)
+{
+	if (game->result != BOARD_RESULT_PLAYING || move < 0 || move >= ULTIMATE_MOVES)
+	{
+		return 0;
+	}
+
+	int sub = move / BOARD_CELLS;
+	int cell = move % BOARD_CELLS;
+	if ((game->next != ULTIMATE_ANY_BOARD && sub != game->next) || (game->closed & BOARD_CELL_BIT(sub)))
+	{
+		return 0;
+	}
+	return !((game->cells[0][sub] | game->cells[1][sub]) & BOARD_CELL_BIT(cell));
+}
+
+int Ultimate_Moves(const Ultimate *game, u8 *moves)
+{
+	int n = 0;
+
+	if (game->result != BOARD_RESULT_PLAYING)
+	{
+		return 0;
+	}
+
+	int first = game->next == ULTIMATE_ANY_BOARD ? 0 : game->next;
+	int last = game->next == ULTIMATE_ANY_BOARD ? BOARD_CELLS - 1 : game->next;
+	for (int sub = first; sub <= last; sub++)
+	{
+		if (game->closed & BOARD_CELL_BIT(sub))
+		{
+			continue;
+		}
+		u16 empty = ~(game->cells[0][sub] | game->cells[1][sub]) & BOARD_FULL_MASK;
+		while (empty != 0)
+		{
+			int cell = __builtin_ctz(empty);
+			empty &= empty - 1;
+			moves[n++] = sub * BOARD_CELLS + cell;
+		}
+	}
+	return n;
+}
+
+/*
+ * Places the tile, closes the sub-board if it is now won or full, and checks
+ * the big board only when a sub-board was closed.
+ */
+int Ultimate_Play(Ultimate *game, int move)
+{
+	if (!Ultimate_IsLegal(game, move))
+	{
+		return 0;
+	}
+
+	int tile = game->to_move;
+	int sub = move / BOARD_CELLS;
+	int cell = move % BOARD_CELLS;
+	u16 *mine = &game->cells[tile - 1][sub];
+
+	*mine |= BOARD_CELL_BIT(cell);
+	if (BOARD_IS_WIN(*mine))
+	{
+		game->won[tile - 1] |= BOARD_CELL_BIT(sub);
+		game->closed |= BOARD_CELL_BIT(sub);
+		if (BOARD_IS_WIN(game->won[tile - 1]))
+		{
+			game->result = tile;
+		}
+	}
+	else if ((game->cells[0][sub] | game->cells[1][sub]) == BOARD_FULL_MASK)
+	{
+		game->closed |= BOARD_CELL_BIT(sub);
+	}
+
+	if (game->result == BOARD_RESULT_PLAYING && game->closed == BOARD_FULL_MASK)
+	{
+		game->result = BOARD_RESULT_DRAW;
+	}
+
+	game->next = (game->closed & BOARD_CELL_BIT(cell)) ? ULTIMATE_ANY_BOARD : cell;
+	game->to_move = tile == BOARD_X ? BOARD_O : BOARD_X;
+	return 1;
+}
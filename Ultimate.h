@@ -0,0 +1,49 @@
+/*
+ * Ultimate.h
+ *
+ *  Ultimate tic-tac-toe: nine 3x3 sub-boards laid out as a 3x3 board.
+ *
+ *  A move is sub-board * 9 + cell (0..80), both numbered row * 3 + col. The
+ *  cell a player takes sends the opponent to the sub-board in the same
+ *  position; if that sub-board is already won or full, the opponent may play
+ *  in any open one. Winning a sub-board claims its square of the big board,
+ *  and three claimed squares in a line win the game. When every sub-board is
+ *  closed without that, the game is a draw.
+ *
+ *  Each sub-board is a pair of Board masks, and the claimed squares are a
+ *  pair of masks too, so every win check is one Board_WinTable lookup.
+ */
+
+#ifndef SRC_ULTIMATE_H_
+#define SRC_ULTIMATE_H_
+
+#include "xil_types.h"
+#include "Board.h"
+
+#define ULTIMATE_MOVES 81
+#define ULTIMATE_ANY_BOARD 0xFF		// next when any open sub-board may be played
+
+typedef struct Ultimate {
+	u16 cells[2][BOARD_CELLS];	// Occupancy of each sub-board, per tile
+	u16 won[2];					// Sub-boards claimed, per tile
+	u16 closed;					// Sub-boards won or full
+	u8 next;					// Sub-board to play in, or ULTIMATE_ANY_BOARD
+	u8 to_move;					// BOARD_X or BOARD_O
+	s8 result;					// BOARD_RESULT_PLAYING, BOARD_RESULT_DRAW or the winner
+} Ultimate;
+
+// Empty boards, X to move anywhere.
+void Ultimate_Initialize(Ultimate *game);
+
+// Lists the legal moves.
+// Return: number of moves written to moves (at most ULTIMATE_MOVES).
+int Ultimate_Moves(const Ultimate *game, u8 *moves);
+
+// Checks whether move is legal for the side to move.
+int Ultimate_IsLegal(const Ultimate *game, int move);
+
+// Plays move for the side to move and updates the result.
+// Return: 1 if played, 0 if the move is not legal.
+int Ultimate_Play(Ultimate *game, int move);
+
+#endif /* SRC_ULTIMATE_H_ */
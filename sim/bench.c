@@ -0,0 +1,2379 @@
+/*
+ * bench.c
+ *
+ *  Latency and throughput benchmarks for the firmware, run on the host
+ *  against the simulated PmodBLE, PmodKYPD and PmodOLEDrgb.
+ *
+ *  Usage: bench [name-prefix]
+ *
+ *  Every result is one line: benchmark, metric, value, unit. Times are
+ *  virtual and follow from the costs configured in sim.h, except those in
+ *  "host ns", which time pure computation on the host.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/sysinfo.h>
+#include "sleep.h"
+#include "sim.h"
+#include "PmodBLE_Interface.h"
+#include "Timebase.h"
+#include "PmodOLEDrgb.h"
+#include "MoveLink.h"
+#include "LinkSupervisor.h"
+#include "MoveLog.h"
+#include "Spectators.h"
+#include "Latency.h"
+#include "KeypadScan.h"
+#include "OledFb.h"
+#include "Board.h"
+#include "Engine.h"
+#include "PerfectPlay.h"
+#include "Ultimate.h"
+#include "Mcts.h"
+
+#define PEER_ADDRESS "801F12B6BB36"
+
+// Game functions and state from tictactoe.c
+extern PmodOLEDrgb oledrgb;
+extern OledFb oledFb;
+extern Board board;
+void KYPDInitialize();
+char KYPDGetKey();
+void OledInitialize();
+void BoardInit();
+void ResetGame();
+int updateBoard(int tile, int row, int col);
+void OledDrain();
+void KYPDRun();
+void BleRun();
+void OledRun();
+void MoveLogBegin();
+extern int textShown;
+extern MoveLink moveLink;
+extern LinkSupervisor linkSupervisor;
+extern int curTile;
+extern int displayCount;
+extern int gameState;
+extern int singlePlayer;
+void AiRun();
+extern int ultimateMode;
+extern Ultimate ultimate;
+extern Mcts mcts;
+extern Mcts_Node mctsPool[];
+extern MoveLog moveLog;
+void ReplayGame();
+void UltimateMove(int move);
+
+typedef struct Bench {
+	const char *name;
+	void (*run)(const char *name);
+} Bench;
+
+static void report(const char *bench, const char *metric, double value, const char *unit)
+{
+	printf("%-20s %-26s %14.3f %s\n", bench, metric, value, unit);
+}
+
+// Host time, for benchmarks of pure computation that the virtual clock does
+// not charge.
+static u64 host_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * SIM_NS_PER_S + ts.tv_nsec;
+}
+
+// Deterministic pseudo-random numbers (LCG), so runs are comparable.
+static u32 bench_rand_state = 1;
+
+static u32 bench_rand()
+{
+	bench_rand_state = bench_rand_state * 1103515245 + 12345;
+	return bench_rand_state >> 8;
+}
+
+static double ms_since(u64 start_ns)
+{
+	return (double) (sim_now_ns() - start_ns) / SIM_NS_PER_MS;
+}
+
+static SimBle *connect_peer()
+{
+	PmodBLE_Initialize();
+	PmodBLE_ConnectTo((u8 *) PEER_ADDRESS);
+	return sim_ble_find(XPAR_PMODBLE_0_S_AXI_UART_BASEADDR);
+}
+
+// *********** BLE *********** //
+static void bench_ble_connect(const char *name)
+{
+	u64 start = sim_now_ns();
+	PmodBLE_Initialize();
+	report(name, "initialize", ms_since(start), "ms");
+
+	start = sim_now_ns();
+	int status = PmodBLE_ConnectTo((u8 *) PEER_ADDRESS);
+	report(name, "connect", ms_since(start), "ms");
+	report(name, "connected", status == PMODBLE_STATUS_CONNECTED, "bool");
+	report(name, "console_chars", sim_console_stats.chars, "chars");
+	report(name, "worst_wait", PmodBLE_WorstWaitUs() / 1000.0, "ms");
+
+	// Zero unless built with TRACE_RECORDS.
+	static PmodBLE_TraceRecord trace[1024];
+	report(name, "trace_records", PmodBLE_TraceRead(trace, 1024), "records");
+}
+
+// A module whose "BTA=" line is cut short: the address kept from before must
+// stay, and GetDeviceAddress must fail instead of copying past the line.
+static void bench_ble_short_address(const char *name)
+{
+	PmodBLE_Peer peer = { "", "801F12B7A000", PMODBLE_ROLE_CENTRAL };
+	u8 address[12];
+
+	strcpy(sim_ble_default_config.address, "801F12");
+	PmodBLE_SetPeer(&peer);
+	PmodBLE_Initialize();
+	PmodBLE_GetPeer(&peer);
+	report(name, "address_kept", strcmp((char *) peer.own_address, "801F12B7A000") == 0
+		&& peer.role == PMODBLE_ROLE_CENTRAL, "bool");
+	report(name, "get_address_err", PmodBLE_GetDeviceAddress(address) == PMODBLE_STATUS_ERR, "bool");
+}
+
+// The peer never answers the connect request; ConnectTo must give up.
+static void bench_ble_connect_timeout(const char *name)
+{
+	sim_ble_default_config.connect_delay_us = 60000000;
+	PmodBLE_Initialize();
+
+	u64 start = sim_now_ns();
+	int status = PmodBLE_ConnectTo((u8 *) PEER_ADDRESS);
+	report(name, "connect", ms_since(start), "ms");
+	report(name, "timed_out", status == PMODBLE_STATUS_TIMEOUT, "bool");
+	report(name, "timeouts", PmodBLE_TimeoutCount(), "count");
+	report(name, "worst_wait", PmodBLE_WorstWaitUs() / 1000.0, "ms");
+}
+
+// The peer refuses the connection ("%ERR_CONN%"); this must not be taken for
+// the "ERR" of a syntax error.
+static void bench_ble_connect_refused(const char *name)
+{
+	sim_ble_default_config.connect_fail = 1;
+	PmodBLE_Initialize();
+
+	u64 start = sim_now_ns();
+	int status = PmodBLE_ConnectTo((u8 *) PEER_ADDRESS);
+	report(name, "connect", ms_since(start), "ms");
+	report(name, "connection_err", status == PMODBLE_STATUS_CONNECTION_ERR, "bool");
+}
+
+/*
+ * Reads the device address and restarts advertising (Y, A): once with each
+ * command in its own command mode round trip, once in a single session.
+ */
+static void bench_ble_cmd_session(const char *name)
+{
+	u8 address[16] = {0};
+	char bta[CMD_RESPONSE_MAX_LINE_BYTES];
+	PmodBLE_Command stop = { "Y\r", "AOK", NULL, 0, 0 };
+	PmodBLE_Command start_adv = { "A\r", "AOK", NULL, 0, 0 };
+
+	PmodBLE_Initialize();
+
+	u64 start = sim_now_ns();
+	PmodBLE_GetDeviceAddress(address);
+	PmodBLE_RunCommands(&stop, 1);
+	PmodBLE_RunCommands(&start_adv, 1);
+	report(name, "separate", ms_since(start), "ms");
+
+	PmodBLE_Command cmds[3] = {
+		{ GET_DEVICE_ADDRESS_CMD, GET_DEVICE_ADDRESS_PREFIX, bta, sizeof(bta), 0 },
+		{ "Y\r", "AOK", NULL, 0, 0 },
+		{ "A\r", "AOK", NULL, 0, 0 },
+	};
+	start = sim_now_ns();
+	int status = PmodBLE_RunCommands(cmds, 3);
+	report(name, "session", ms_since(start), "ms");
+	report(name, "session_ok", status == PMODBLE_STATUS_SUCCESS && strstr(bta, sim_ble_default_config.address) != NULL, "bool");
+}
+
+// A module with commands disabled answers "CMD" without the '>'; entering
+// command mode must report that instead of waiting for a fourth byte.
+static void bench_ble_cmd_disabled(const char *name)
+{
+	sim_ble_default_config.cmd_prompt_disabled = 1;
+
+	u64 start = sim_now_ns();
+	PmodBLE_Initialize();
+	int status = PmodBLE_BeginCommands();
+	report(name, "elapsed", ms_since(start), "ms");
+	report(name, "disabled", status == PMODBLE_STATUS_CMD_DISABLED, "bool");
+	report(name, "back_in_data_mode", !sim_ble_in_command_mode(sim_ble_find(XPAR_PMODBLE_0_S_AXI_UART_BASEADDR)), "bool");
+}
+
+static int tx_idle(void *arg)
+{
+	return sim_ble_tx_idle(arg);
+}
+
+static void bench_ble_tx(const char *name)
+{
+	static u8 msg[1025];
+	SimBle *ble = connect_peer();
+	SimBleStats before = *sim_ble_stats(ble);
+
+	memset(msg, 'm', sizeof(msg) - 1);
+	u64 start = sim_now_ns();
+	PmodBLE_SendMessage(msg);
+	double cpu_ms = ms_since(start);
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	double wire_ms = (double) (sim_ble_stats(ble)->last_tx_done_ns - start) / SIM_NS_PER_MS;
+
+	report(name, "bytes", sizeof(msg) - 1, "B");
+	report(name, "cpu_time", cpu_ms, "ms");
+	report(name, "wire_time", wire_ms, "ms");
+	report(name, "throughput", (sizeof(msg) - 1) / (wire_ms / 1000.0), "B/s");
+	report(name, "send_calls", sim_ble_stats(ble)->send_calls - before.send_calls, "calls");
+
+	// Fill the UART FIFO behind the interface's back so its estimate says
+	// empty: SendBuffer must notice the short write and sleep, not spin.
+	static u8 seen[sizeof(msg)];
+	u8 filler[64];
+	memset(filler, 'f', sizeof(filler));
+	sim_ble_peer_take(ble, seen, sizeof(seen));
+	PmodBLE_Interface_t *iface = PmodBLE_DefaultInterface();
+	int queued = BLE_SendData(&iface->device, filler, sizeof(filler));
+	before = *sim_ble_stats(ble);
+	int sent = PmodBLE_SendBuffer(msg, 256);
+	u64 calls = sim_ble_stats(ble)->send_calls - before.send_calls;
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	int got = sim_ble_peer_take(ble, seen, sizeof(seen));
+	report(name, "stale_estimate_calls", calls, "calls");
+	report(name, "stale_estimate_intact", sent == 256 && got == queued + 256
+		&& memcmp(seen + queued, msg, 256) == 0 && calls <= 2 * 256 / 8, "bool");
+}
+
+// A binary frame (header plus payload, both containing 0x00) sent as two
+// segments; the peer must see every byte in order.
+static void bench_ble_tx_segments(const char *name)
+{
+	static u8 payload[1020];
+	static u8 seen[1024];
+	u8 header[4] = { 0xA5, 0x00, 0x03, 0xFC };
+	SimBle *ble = connect_peer();
+	SimBleStats before = *sim_ble_stats(ble);
+
+	for (int i = 0; i < (int) sizeof(payload); i++)
+	{
+		payload[i] = i;
+	}
+	PmodBLE_Segment segs[2] = { { header, sizeof(header) }, { payload, sizeof(payload) } };
+
+	u64 start = sim_now_ns();
+	int sent = PmodBLE_SendSegments(segs, 2);
+	double cpu_ms = ms_since(start);
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	double wire_ms = (double) (sim_ble_stats(ble)->last_tx_done_ns - start) / SIM_NS_PER_MS;
+
+	int got = sim_ble_peer_take(ble, seen, sizeof(seen));
+	int intact = got == sent && memcmp(seen, header, sizeof(header)) == 0
+			&& memcmp(seen + sizeof(header), payload, sizeof(payload)) == 0;
+
+	report(name, "bytes", sent, "B");
+	report(name, "cpu_time", cpu_ms, "ms");
+	report(name, "throughput", sent / (wire_ms / 1000.0), "B/s");
+	report(name, "send_calls", sim_ble_stats(ble)->send_calls - before.send_calls, "calls");
+	report(name, "intact", intact, "bool");
+}
+
+/*
+ * The peer sends a burst while the CPU alternates between polling the link
+ * and handling a move (console echo plus drawing an O tile), which is what
+ * the game loop does. Run once polled and once with the receive interrupt
+ * feeding the ring.
+ */
+static void rx_burst(const char *name, int use_interrupt)
+{
+	static u8 burst[512];
+	u8 buf[64];
+	int total = 0;
+
+	OledInitialize();
+	SimBle *ble = connect_peer();
+	memset(burst, 'r', sizeof(burst));
+
+	// Let the link settle.
+	usleep(10000);
+	PmodBLE_Flush();
+	if (use_interrupt)
+	{
+		sim_ble_connect_irq(ble, PmodBLE_RxInterruptHandler, NULL);
+		PmodBLE_EnableRxInterrupt();
+	}
+	sim_ble_stats(ble)->rx_overruns = 0;
+
+	u64 start = sim_now_ns();
+	sim_ble_peer_send(ble, burst, sizeof(burst), 0);
+	while (total + sim_ble_stats(ble)->rx_overruns + PmodBLE_RxDropped() < sizeof(burst)
+			&& sim_now_ns() - start < SIM_NS_PER_S)
+	{
+		total += PmodBLE_ReceiveMessage(buf, sizeof(buf));
+		xil_printf("Key pressed: %c\r\n", '1');
+		updateBoard(2, 0, 0);
+		OledDrain();
+		Board_Clear(&board);
+	}
+
+	report(name, "sent", sizeof(burst), "B");
+	report(name, "received", total, "B");
+	report(name, "overruns", sim_ble_stats(ble)->rx_overruns + PmodBLE_RxDropped(), "B");
+	report(name, "elapsed", ms_since(start), "ms");
+}
+
+static void bench_ble_rx_burst(const char *name)
+{
+	rx_burst(name, 0);
+}
+
+static void bench_ble_rx_burst_irq(const char *name)
+{
+	rx_burst(name, 1);
+}
+
+// Polls until count moves arrive or timeout_us of virtual time passes.
+static int move_link_wait(MoveLink *link, MoveLink_Move *moves, int count, u32 timeout_us)
+{
+	int got = 0;
+	u32 deadline = Timebase_Deadline(timeout_us);
+
+	while (got < count && !Timebase_Expired(deadline))
+	{
+		got += MoveLink_Poll(link, &moves[got], count - got);
+		usleep(1000);
+	}
+	return got;
+}
+
+// One move each way, then a lost peer frame: the gap must be answered with a
+// single RESEND and the resent move accepted.
+static void bench_ble_move_link(const char *name)
+{
+	static MoveLink link;
+	MoveLink_Move moves[4];
+	u8 frames[3 * MOVELINK_FRAME_BYTES];
+	u8 sent[64];
+
+	SimBle *ble = connect_peer();
+	MoveLink_Initialize(&link);
+	sim_ble_peer_take(ble, sent, sizeof(sent));
+
+	u64 start = sim_now_ns();
+	MoveLink_SendMove(&link, 4, 1);
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	int n = sim_ble_peer_take(ble, sent, sizeof(sent));
+	int valid = n == MOVELINK_FRAME_BYTES && sent[0] == MOVELINK_SYNC
+		&& MoveLink_Crc8(&sent[1], 4) == sent[5];
+	report(name, "bytes_per_move", n, "B");
+	report(name, "frame_valid", valid, "bool");
+
+	// Peer move 1 acks our move 1.
+	MoveLink_Encode(frames, MOVELINK_TYPE_MOVE, 1, 1, 0, 2);
+	sim_ble_peer_send(ble, frames, MOVELINK_FRAME_BYTES, 0);
+	int got = move_link_wait(&link, moves, 1, 100000);
+	report(name, "move_exchange", ms_since(start), "ms");
+	report(name, "move_received", got == 1 && moves[0].cell == 0 && moves[0].tile == 2, "bool");
+
+	// Peer move 2 is lost; move 3 arrives, then 2 and 3 again after the RESEND,
+	// behind a corrupted copy of move 2.
+	MoveLink_SendMove(&link, 8, 1);
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	sim_ble_peer_take(ble, sent, sizeof(sent));
+	MoveLink_Encode(frames, MOVELINK_TYPE_MOVE, 3, 2, 1, 2);
+	sim_ble_peer_send(ble, frames, MOVELINK_FRAME_BYTES, 0);
+	move_link_wait(&link, moves, 1, 20000);
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	n = sim_ble_peer_take(ble, sent, sizeof(sent));
+	report(name, "resend_requested", n == MOVELINK_FRAME_BYTES && sent[1] == MOVELINK_TYPE_RESEND && sent[3] == 1, "bool");
+
+	MoveLink_Encode(frames, MOVELINK_TYPE_MOVE, 2, 2, 3, 2);
+	frames[4] ^= 0x40;
+	MoveLink_Encode(&frames[MOVELINK_FRAME_BYTES], MOVELINK_TYPE_MOVE, 2, 2, 3, 2);
+	MoveLink_Encode(&frames[2 * MOVELINK_FRAME_BYTES], MOVELINK_TYPE_MOVE, 3, 2, 1, 2);
+	sim_ble_peer_send(ble, frames, sizeof(frames), 0);
+	got = move_link_wait(&link, moves, 2, 100000);
+	report(name, "recovered_moves", got == 2 && moves[0].seq == 2 && moves[1].seq == 3, "bool");
+	report(name, "crc_errors", link.crc_errors, "frames");
+	report(name, "frames_sent", link.frames_sent, "frames");
+}
+
+// A status message in the middle of game data: it must be taken out and
+// reported, and '%' bytes that do not start one must stay in the data.
+static void bench_ble_status_in_data(const char *name)
+{
+	static const char stream[] = "ab%%cd%DISCONNECT%ef%ERRx%gh";
+	static const char expect[] = "ab%%cdef%ERRx%gh";
+	char buf[64] = {0};
+	int total = 0;
+
+	SimBle *ble = connect_peer();
+	PmodBLE_TakeStatusToken();
+
+	sim_ble_peer_send(ble, (const u8 *) stream, strlen(stream), 0);
+	u64 start = sim_now_ns();
+	while (total < (int) strlen(expect) && sim_now_ns() - start < SIM_NS_PER_S)
+	{
+		total += PmodBLE_ReceiveMessage((u8 *) &buf[total], sizeof(buf) - 1 - total);
+		usleep(100);
+	}
+
+	report(name, "data_intact", strcmp(buf, expect) == 0, "bool");
+	report(name, "disconnect_seen", PmodBLE_TakeStatusToken() == PMODBLE_TOKEN_DISCONNECT, "bool");
+}
+
+// A frame whose CRC is 0x25 ('%') and nothing after it, as in a turn-based
+// game: the '%' may not be held back for a status message that never comes.
+static void bench_ble_percent_tail(const char *name)
+{
+	u8 frame[MOVELINK_FRAME_BYTES];
+	MoveLink_Move move;
+	int got = 0;
+
+	SimBle *ble = connect_peer();
+	MoveLink_Initialize(&moveLink);
+	moveLink.rx_expected = 14;
+
+	MoveLink_Encode(frame, MOVELINK_TYPE_MOVE, 14, 14, 4, 2);
+	sim_ble_peer_send(ble, frame, sizeof(frame), 0);
+	u64 start = sim_now_ns();
+	while (!got && sim_now_ns() - start < SIM_NS_PER_S)
+	{
+		got = MoveLink_Poll(&moveLink, &move, 1);
+		usleep(100);
+	}
+
+	report(name, "crc_is_percent", frame[5] == '%', "bool");
+	report(name, "delivered", got == 1 && move.cell == 4 && move.tile == 2, "bool");
+	report(name, "latency", ms_since(start), "ms");
+}
+
+// Bytes read past the end of the last reply wait for the tokenizer; the raw
+// reads must return them before anything newer from the UART. A zero-size
+// line buffer must not be written to.
+static void bench_ble_read_pending(const char *name)
+{
+	u8 line[16];
+	u8 bytes[8] = {0};
+	u8 canary = 0x55;
+	int n = 0;
+
+	SimBle *ble = connect_peer();
+	PmodBLE_Interface_t *iface = PmodBLE_DefaultInterface();
+	memcpy(iface->tok_pending, "OK\nabcd", 7);
+	iface->tok_pending_len = 7;
+	iface->tok_pending_pos = 0;
+
+	sim_ble_peer_send(ble, (const u8 *) "e", 1, 0);
+	int status = PmodBLE_ReadUntilEOLDeadline(line, sizeof(line), '\n', Timebase_Deadline(100000), &n);
+	report(name, "line_first", status == PMODBLE_STATUS_SUCCESS && strcmp((char *) line, "OK") == 0, "bool");
+	status = PmodBLE_ReadDeadline(bytes, 5, Timebase_Deadline(100000), &n);
+	report(name, "bytes_in_order", status == PMODBLE_STATUS_SUCCESS && memcmp(bytes, "abcde", 5) == 0, "bool");
+
+	sim_ble_peer_send(ble, (const u8 *) "x\n", 2, 0);
+	status = PmodBLE_ReadUntilEOLDeadline(&canary, 0, '\n', Timebase_Deadline(100000), &n);
+	report(name, "empty_buffer_untouched", status == PMODBLE_STATUS_SUCCESS && canary == 0x55 && n == 0, "bool");
+
+	// Data already waiting in the tokenizer plus a full pending read: with
+	// room in the caller's buffer, ReceiveMessage must lose none of it.
+	u8 all[2 * PMODBLE_TOKEN_DATA_BYTES];
+	int dropped = PmodBLE_DataDropped();
+	PmodBLE_TokenizerReset(&iface->rx_tok, 1);
+	for (int i = 0; i < PMODBLE_TOKEN_DATA_BYTES - 4; i++)
+	{
+		PmodBLE_Tokenize(&iface->rx_tok, 'a');
+	}
+	memset(iface->tok_pending, 'b', sizeof(iface->tok_pending));
+	iface->tok_pending_len = sizeof(iface->tok_pending);
+	iface->tok_pending_pos = 0;
+	n = PmodBLE_ReceiveMessage(all, sizeof(all));
+	report(name, "pending_not_dropped", n == PMODBLE_TOKEN_DATA_BYTES - 4 + (int) sizeof(iface->tok_pending)
+		&& PmodBLE_DataDropped() == dropped, "bool");
+}
+
+// The tokenizer on its own: a command session's replies and a data stream
+// with status messages in it, the tokens it reports, and its cost per byte.
+static void bench_ble_tokenizer(const char *name)
+{
+	static const char session[] = "CMD> AOK\r\nBTA=801F12B7A000\r\nTrying\r\nERR\r\nEND\r\n";
+	static const u8 want_session[] = {
+		PMODBLE_TOKEN_CMD_PROMPT, PMODBLE_TOKEN_AOK, PMODBLE_TOKEN_LINE,
+		PMODBLE_TOKEN_TRYING, PMODBLE_TOKEN_ERR, PMODBLE_TOKEN_END
+	};
+	static const char stream[] = "ab%CONNECT,0,801F12B7A001%c%5%ERR_CONN%%STREAM_OPEN%d%DISCONNECT%";
+	static const u8 want_stream[] = {
+		PMODBLE_TOKEN_CONNECT, PMODBLE_TOKEN_ERR_CONN, PMODBLE_TOKEN_STREAM_OPEN, PMODBLE_TOKEN_DISCONNECT
+	};
+	PmodBLE_Tokenizer tok = {0};
+	u8 tokens[8];
+	u8 data[16];
+	int n = 0;
+
+	PmodBLE_TokenizerReset(&tok, 0);
+	for (int i = 0; i < (int) sizeof(session) - 1; i++)
+	{
+		int token = PmodBLE_Tokenize(&tok, session[i]);
+		if (token != PMODBLE_TOKEN_NONE && n < 8)
+		{
+			tokens[n++] = token;
+		}
+	}
+	report(name, "session_tokens", n == sizeof(want_session) && memcmp(tokens, want_session, n) == 0, "bool");
+
+	n = 0;
+	PmodBLE_TokenizerReset(&tok, 1);
+	for (int i = 0; i < (int) sizeof(stream) - 1; i++)
+	{
+		int token = PmodBLE_Tokenize(&tok, stream[i]);
+		if (token != PMODBLE_TOKEN_NONE && n < 8)
+		{
+			tokens[n++] = token;
+		}
+	}
+	int len = PmodBLE_TokenizerTakeData(&tok, data, sizeof(data));
+	report(name, "stream_tokens", n == sizeof(want_stream) && memcmp(tokens, want_stream, n) == 0, "bool");
+	report(name, "stream_data", len == 6 && memcmp(data, "abc%5d", 6) == 0, "bool");
+
+	// Host cost per byte over both, taking the data out as ReceiveMessage does.
+	const int rounds = 100000;
+	u64 start = host_ns();
+	for (int r = 0; r < rounds; r++)
+	{
+		PmodBLE_TokenizerReset(&tok, 0);
+		for (int i = 0; i < (int) sizeof(session) - 1; i++)
+		{
+			PmodBLE_Tokenize(&tok, session[i]);
+		}
+		PmodBLE_TokenizerReset(&tok, 1);
+		for (int i = 0; i < (int) sizeof(stream) - 1; i++)
+		{
+			PmodBLE_Tokenize(&tok, stream[i]);
+		}
+		PmodBLE_TokenizerTakeData(&tok, data, sizeof(data));
+	}
+	report(name, "per_byte", (double) (host_ns() - start) / rounds / (sizeof(session) + sizeof(stream) - 2), "host ns");
+
+	// Data that is never taken out fills the buffer; what does not fit is
+	// counted, not lost without a trace.
+	tok.dropped = 0;
+	PmodBLE_TokenizerReset(&tok, 1);
+	for (int i = 0; i < PMODBLE_TOKEN_DATA_BYTES + 36; i++)
+	{
+		PmodBLE_Tokenize(&tok, 'x');
+	}
+	report(name, "overflow_counted", tok.data_len == PMODBLE_TOKEN_DATA_BYTES && tok.dropped == 36, "bool");
+}
+
+// *********** Keypad *********** //
+/*
+ * A fast typist (a key every 30 ms, with contact bounce) while the main loop
+ * is busy for 50 ms at a time, e.g. drawing or a long BLE send. Scanning
+ * from the timer interrupt must catch every key exactly once, in order.
+ */
+static void kypd_burst(const char *name, int use_interrupt)
+{
+	static const char keys[] = "123456789A";
+	int n = sizeof(keys) - 1;
+	char seen[32];
+	int num_seen = 0;
+	KeypadScan_Event event;
+
+	sim_kypd_config.bounce_us = 2000;
+	KYPDInitialize();
+	if (use_interrupt)
+	{
+		sim_timer_connect_irq(KeypadScan_TimerHandler, NULL);
+		KeypadScan_StartTimer();
+	}
+
+	u64 first = sim_now_ns() + 5 * SIM_NS_PER_MS;
+	for (int i = 0; i < n; i++)
+	{
+		sim_kypd_press(keys[i], first + i * 30 * SIM_NS_PER_MS, 20000);
+	}
+
+	u64 end = first + (n + 2) * 30 * SIM_NS_PER_MS;
+	while (sim_now_ns() < end)
+	{
+		usleep(50000);
+		KeypadScan_Service();
+		while (KeypadScan_Poll(&event))
+		{
+			if (event.pressed && num_seen < (int) sizeof(seen))
+			{
+				seen[num_seen++] = event.key;
+			}
+		}
+	}
+
+	report(name, "keys_pressed", n, "keys");
+	report(name, "keys_seen", num_seen, "keys");
+	report(name, "exact", num_seen == n && memcmp(seen, keys, n) == 0, "bool");
+	report(name, "dropped", KeypadScan_Dropped(), "events");
+}
+
+static void bench_kypd_burst(const char *name)
+{
+	kypd_burst(name, 0);
+}
+
+static void bench_kypd_burst_irq(const char *name)
+{
+	kypd_burst(name, 1);
+}
+
+// *********** Keypad to Display *********** //
+// Compares what reached the panel with the framebuffer.
+static int panel_matches_fb()
+{
+	for (int r = 0; r < OLEDFB_HEIGHT; r++)
+	{
+		for (int c = 0; c < OLEDFB_WIDTH; c++)
+		{
+			if (sim_oled_pixel(c, r) != OledFb_GetPixel(&oledFb, c, r))
+			{
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// Eight moves that never complete a line, so gameOver never blocks.
+static const char moves[] = "12358469";
+
+static void bench_key_to_pixels(const char *name)
+{
+	double total_ms = 0, max_ms = 0;
+	u64 txns = sim_oled_stats.transactions;
+	u64 bytes;
+	int tile = 1;
+	int n = sizeof(moves) - 1;
+
+	KYPDInitialize();
+	OledInitialize();
+	BoardInit();
+	OledFb_Flush(&oledFb);
+	txns = sim_oled_stats.transactions;
+	bytes = sim_oled_stats.bytes;
+
+	for (int i = 0; i < n; i++)
+	{
+		u64 press = sim_now_ns() + 5 * SIM_NS_PER_MS;
+		sim_kypd_press(moves[i], press, 30000);
+
+		int pos = KYPDGetKey() - '1';
+		tile = updateBoard(tile, pos / 3, pos % 3);
+		OledDrain();
+
+		double ms = (double) (sim_now_ns() - press) / SIM_NS_PER_MS;
+		total_ms += ms;
+		if (ms > max_ms)
+		{
+			max_ms = ms;
+		}
+
+		// Let the key go before the next press.
+		usleep(40000);
+	}
+
+	report(name, "moves", n, "moves");
+	report(name, "latency_avg", total_ms / n, "ms");
+	report(name, "latency_max", max_ms, "ms");
+	report(name, "spi_txns_per_move", (double) (sim_oled_stats.transactions - txns) / n, "txns");
+	report(name, "spi_bytes_per_move", (double) (sim_oled_stats.bytes - bytes) / n, "bytes");
+	report(name, "panel_matches_fb", panel_matches_fb(), "bool");
+
+	u64 start = sim_now_ns();
+	txns = sim_oled_stats.transactions;
+	ResetGame();
+	OledDrain();
+	report(name, "reset", ms_since(start), "ms");
+	report(name, "reset_spi_txns", sim_oled_stats.transactions - txns, "txns");
+	report(name, "reset_matches_fb", panel_matches_fb(), "bool");
+}
+
+// Presses a key and runs the keypad and display handlers until it is handled.
+static void game_over_key(char key)
+{
+	u64 press = sim_now_ns() + 5 * SIM_NS_PER_MS;
+
+	sim_kypd_press(key, press, 30000);
+	while (sim_now_ns() < press + 60 * SIM_NS_PER_MS)
+	{
+		KYPDRun();
+		OledRun();
+		usleep(1000);
+	}
+	OledDrain();
+}
+
+// X takes the top row; the game-over text then covers the board until the
+// reset, which must bring back the empty grid without blanking the panel.
+static const char winning_moves[] = "14253";
+
+static void bench_game_over_reset(const char *name)
+{
+	int tile = 1;
+
+	OledInitialize();
+	BoardInit();
+	OledFb_Flush(&oledFb);
+	curTile = 1;
+
+	for (int i = 0; winning_moves[i] != '\0'; i++)
+	{
+		int pos = winning_moves[i] - '1';
+		tile = updateBoard(tile, pos / 3, pos % 3);
+		OledDrain();
+	}
+	report(name, "game_over", gameState == 1, "bool");
+
+	u64 start = sim_now_ns();
+	u64 txns = sim_oled_stats.transactions;
+	u64 bytes = sim_oled_stats.bytes;
+	ResetGame();
+	OledDrain();
+	report(name, "reset", ms_since(start), "ms");
+	report(name, "reset_spi_txns", sim_oled_stats.transactions - txns, "txns");
+	report(name, "reset_spi_bytes", sim_oled_stats.bytes - bytes, "bytes");
+	report(name, "panel_matches_fb", panel_matches_fb(), "bool");
+
+	// Only the grid may be left.
+	int empty = 1;
+	for (int r = 0; r < OLEDFB_HEIGHT; r++)
+	{
+		for (int c = 0; c < OLEDFB_WIDTH; c++)
+		{
+			int grid = c == 32 || c == 64 || r == 21 || r == 42;
+			if ((sim_oled_pixel(c, r) != 0) != grid)
+			{
+				empty = 0;
+			}
+		}
+	}
+	report(name, "empty_board", empty, "bool");
+
+	// The keys on the game over screen: a numeric key other than 0 does
+	// nothing, 0 shows the game again with the text back over it, and a
+	// non-numeric key starts a new game.
+	KYPDInitialize();
+	MoveLogBegin();
+	tile = 1;
+	for (int i = 0; winning_moves[i] != '\0'; i++)
+	{
+		int pos = winning_moves[i] - '1';
+		tile = updateBoard(tile, pos / 3, pos % 3);
+	}
+	OledDrain();
+	game_over_key('5');
+	report(name, "digit_ignored", gameState == 1 && Board_TileAt(&board, 0) == BOARD_X, "bool");
+	game_over_key('0');
+	report(name, "review_keeps_text", gameState == 1 && textShown && Board_TileAt(&board, 0) == BOARD_X, "bool");
+	game_over_key('A');
+	report(name, "letter_resets", gameState == 0 && Board_TileAt(&board, 0) == BOARD_EMPTY, "bool");
+}
+
+// *********** Game Logic *********** //
+// Checks every entry of the win table against a scan of the eight lines.
+static void bench_board_win_table(const char *name)
+{
+	static const int lines[8][3] = {
+		{ 0, 1, 2 }, { 3, 4, 5 }, { 6, 7, 8 },
+		{ 0, 3, 6 }, { 1, 4, 7 }, { 2, 5, 8 },
+		{ 0, 4, 8 }, { 2, 4, 6 }
+	};
+	int wins = 0, agree = 1;
+
+	for (int mask = 0; mask <= BOARD_FULL_MASK; mask++)
+	{
+		int win = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			int line = BOARD_CELL_BIT(lines[i][0]) | BOARD_CELL_BIT(lines[i][1]) | BOARD_CELL_BIT(lines[i][2]);
+			win |= (mask & line) == line;
+		}
+		wins += win;
+		agree &= !BOARD_IS_WIN(mask) == !win;
+	}
+
+	report(name, "winning_masks", wins, "masks");
+	report(name, "table_matches_lines", agree, "bool");
+}
+
+// The engine set up as 3x3/3 must agree with the win table: for every X
+// mask, both kernels must find a line exactly when the table does.
+static void bench_engine_cross_check(const char *name)
+{
+	Engine engine;
+	int agree = 1;
+
+	Engine_Initialize(&engine, 3, 3, 3);
+	for (int mask = 0; mask <= BOARD_FULL_MASK; mask++)
+	{
+		int at_any = 0;
+
+		Engine_Clear(&engine);
+		for (int cell = 0; cell < BOARD_CELLS; cell++)
+		{
+			if (mask & BOARD_CELL_BIT(cell))
+			{
+				Engine_Place(&engine, ENGINE_X, Engine_Cell(&engine, cell / 3, cell % 3));
+			}
+		}
+		for (int cell = 0; cell < BOARD_CELLS; cell++)
+		{
+			int at = Engine_Cell(&engine, cell / 3, cell % 3);
+			if (Engine_TileAt(&engine, at) == ENGINE_X)
+			{
+				at_any |= Engine_IsWinAt(&engine, ENGINE_X, at);
+			}
+		}
+		agree &= !Engine_HasLine(&engine, ENGINE_X) == !BOARD_IS_WIN(mask);
+		agree &= !at_any == !BOARD_IS_WIN(mask);
+	}
+	report(name, "matches_win_table", agree, "bool");
+
+	// Only ENGINE_X and ENGINE_O may be placed; anything else would index
+	// past the bitboards.
+	Engine_Clear(&engine);
+	Engine cleared = engine;
+	int placed = Engine_Place(&engine, 0, 4) + Engine_Place(&engine, 3, 4) + Engine_Place(&engine, -1, 4);
+	report(name, "bad_tile_rejected", placed == 0 && memcmp(&engine, &cleared, sizeof(engine)) == 0, "bool");
+}
+
+// Positions from random games, each with the move just made.
+#define ENGINE_POSITIONS 4096
+
+typedef struct EnginePosition {
+	Engine engine;
+	u8 tile;
+	u8 cell;
+} EnginePosition;
+
+static EnginePosition positions[ENGINE_POSITIONS];
+static volatile int engine_sink;	// Keeps the timed loops from being optimised away.
+
+// Host cost of checking a move, per board size. Random games are played up
+// to their first line or a full board and every position is kept; the
+// checks are then timed over all of them.
+static void engine_check_cost(const char *name, const char *label, int width, int height, int k)
+{
+	char metric[32];
+	Engine engine;
+	int n = 0, agree = 1, wins = 0;
+	const int rounds = 64;
+
+	bench_rand_state = 1;
+	while (n < ENGINE_POSITIONS)
+	{
+		int tile = ENGINE_X;
+
+		Engine_Initialize(&engine, width, height, k);
+		while (n < ENGINE_POSITIONS)
+		{
+			int cell;
+			do
+			{
+				cell = Engine_Cell(&engine, bench_rand() % height, bench_rand() % width);
+			} while (Engine_TileAt(&engine, cell) != ENGINE_EMPTY);
+
+			Engine_Place(&engine, tile, cell);
+			positions[n].engine = engine;
+			positions[n].tile = tile;
+			positions[n].cell = cell;
+			n++;
+			if (Engine_Result(&engine, tile, cell) != ENGINE_RESULT_PLAYING)
+			{
+				break;
+			}
+			tile = tile == ENGINE_X ? ENGINE_O : ENGINE_X;
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		int at = Engine_IsWinAt(&positions[i].engine, positions[i].tile, positions[i].cell);
+		agree &= at == Engine_HasLine(&positions[i].engine, positions[i].tile);
+	}
+
+	u64 start = host_ns();
+	for (int r = 0; r < rounds; r++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			wins += Engine_IsWinAt(&positions[i].engine, positions[i].tile, positions[i].cell);
+		}
+	}
+	double at_ns = (double) (host_ns() - start) / (rounds * n);
+
+	start = host_ns();
+	for (int r = 0; r < rounds; r++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			wins += Engine_HasLine(&positions[i].engine, positions[i].tile);
+		}
+	}
+	double line_ns = (double) (host_ns() - start) / (rounds * n);
+	engine_sink = wins;
+
+	snprintf(metric, sizeof(metric), "%s_move_check", label);
+	report(name, metric, at_ns, "host ns");
+	snprintf(metric, sizeof(metric), "%s_board_scan", label);
+	report(name, metric, line_ns, "host ns");
+	snprintf(metric, sizeof(metric), "%s_kernels_agree", label);
+	report(name, metric, agree, "bool");
+}
+
+static void bench_engine_check_cost(const char *name)
+{
+	engine_check_cost(name, "3x3k3", 3, 3, 3);
+	engine_check_cost(name, "7x6k4", 7, 6, 4);
+	engine_check_cost(name, "15x15k5", 15, 15, 5);
+}
+
+// Plays every game in which ai_tile moves from the table and the other tile
+// tries every move; counts the games, the ones the table lost, and positions
+// it had no legal move for.
+typedef struct PerfectPlayTally {
+	int games;
+	int losses;
+	int missing;
+} PerfectPlayTally;
+
+static void perfect_play_explore(PerfectPlayTally *tally, const Board *board, int tile, int ai_tile)
+{
+	int other = tile == BOARD_X ? BOARD_O : BOARD_X;
+
+	for (int cell = 0; cell < BOARD_CELLS; cell++)
+	{
+		if (tile == ai_tile)
+		{
+			cell = PerfectPlay_BestMove(board, tile);
+			if (cell < 0 || Board_TileAt(board, cell) != BOARD_EMPTY)
+			{
+				tally->missing++;
+				return;
+			}
+		}
+		else if (Board_TileAt(board, cell) != BOARD_EMPTY)
+		{
+			continue;
+		}
+
+		Board next = *board;
+		Board_Place(&next, tile, cell);
+		int result = Board_Result(&next, tile);
+		if (result == BOARD_RESULT_PLAYING)
+		{
+			perfect_play_explore(tally, &next, other, ai_tile);
+		}
+		else
+		{
+			tally->games++;
+			tally->losses += result != BOARD_RESULT_DRAW && tile != ai_tile;
+		}
+
+		if (tile == ai_tile)
+		{
+			return;
+		}
+	}
+}
+
+static void bench_perfect_play(const char *name)
+{
+	PerfectPlayTally tally = { 0, 0, 0 };
+	Board board;
+
+	// The table plays either tile, moving first or second.
+	Board_Clear(&board);
+	perfect_play_explore(&tally, &board, BOARD_X, BOARD_X);
+	perfect_play_explore(&tally, &board, BOARD_X, BOARD_O);
+	perfect_play_explore(&tally, &board, BOARD_O, BOARD_O);
+	perfect_play_explore(&tally, &board, BOARD_O, BOARD_X);
+
+	report(name, "table_entries", PerfectPlay_Entries, "positions");
+	report(name, "table_bytes", PerfectPlay_Entries * (sizeof(u16) + sizeof(u8)), "B");
+	report(name, "games_checked", tally.games, "games");
+	report(name, "never_loses", tally.losses == 0 && tally.missing == 0, "bool");
+
+	// Table against itself: a draw.
+	int tile = BOARD_X, result = BOARD_RESULT_PLAYING;
+	while (result == BOARD_RESULT_PLAYING)
+	{
+		Board_Place(&board, tile, PerfectPlay_BestMove(&board, tile));
+		result = Board_Result(&board, tile);
+		tile = tile == BOARD_X ? BOARD_O : BOARD_X;
+	}
+	report(name, "self_play_draw", result == BOARD_RESULT_DRAW, "bool");
+
+	// Lookup cost, over the positions of a game.
+	const int rounds = 100000;
+	int sink = 0;
+	Board_Clear(&board);
+	Board_Place(&board, BOARD_X, 4);
+	Board_Place(&board, BOARD_O, 0);
+	u64 start = host_ns();
+	for (int i = 0; i < rounds; i++)
+	{
+		sink += PerfectPlay_BestMove(&board, BOARD_X);
+	}
+	engine_sink = sink;
+	report(name, "lookup", (double) (host_ns() - start) / rounds, "host ns");
+}
+
+// *********** Move Log *********** //
+static u8 move_log_stream[4096];
+static int move_log_streamed;
+
+static void move_log_capture(const u8 *bytes, int count)
+{
+	for (int i = 0; i < count && move_log_streamed < (int) sizeof(move_log_stream); i++)
+	{
+		move_log_stream[move_log_streamed++] = bytes[i];
+	}
+}
+
+// Plays a random game of the variant and logs it.
+// Return: number of moves.
+static int move_log_random_game(MoveLog *log, int variant, u8 *moves)
+{
+	int n = 0;
+
+	if (variant == MOVELOG_ULTIMATE)
+	{
+		Ultimate game;
+		u8 legal[ULTIMATE_MOVES];
+		Ultimate_Initialize(&game);
+		MoveLog_BeginGame(log, variant, game.to_move);
+		while (game.result == BOARD_RESULT_PLAYING)
+		{
+			int count = Ultimate_Moves(&game, legal);
+			moves[n] = legal[bench_rand() % count];
+			Ultimate_Play(&game, moves[n]);
+			MoveLog_Append(log, moves[n++]);
+		}
+	}
+	else
+	{
+		Board board;
+		int tile = 1 + bench_rand() % 2, result = BOARD_RESULT_PLAYING;
+		Board_Clear(&board);
+		MoveLog_BeginGame(log, variant, tile);
+		while (result == BOARD_RESULT_PLAYING)
+		{
+			int cell = bench_rand() % BOARD_CELLS;
+			if (!Board_Place(&board, tile, cell))
+			{
+				continue;
+			}
+			moves[n++] = cell;
+			MoveLog_Append(log, cell);
+			result = Board_Result(&board, tile);
+			tile = tile == BOARD_X ? BOARD_O : BOARD_X;
+		}
+	}
+	MoveLog_EndGame(log);
+	return n;
+}
+
+// Random games of both variants go through the ring: the latest ones must
+// read back as played, older ones must be reported as overwritten, and the
+// stream must carry exactly the bytes written.
+static void bench_move_log_ring(const char *name)
+{
+	const int games = 200;
+	static MoveLog log;
+	static u8 played[MOVELOG_GAMES][MOVELOG_MAX_MOVES];
+	static int played_moves[MOVELOG_GAMES];
+	u8 moves[MOVELOG_MAX_MOVES];
+	int bytes[2] = { 0, 0 }, counts[2] = { 0, 0 }, total_moves[2] = { 0, 0 };
+	int round_trip = 1;
+
+	MoveLog_Initialize(&log);
+	MoveLog_SetSink(&log, move_log_capture);
+	move_log_streamed = 0;
+	for (int g = 0; g < games; g++)
+	{
+		int variant = g % 4 == 3 ? MOVELOG_ULTIMATE : MOVELOG_PLAIN;
+		int n = move_log_random_game(&log, variant, played[g % MOVELOG_GAMES]);
+		played_moves[g % MOVELOG_GAMES] = n;
+		bytes[variant] += MoveLog_GameBytes(&log);
+		counts[variant]++;
+		total_moves[variant] += n;
+	}
+
+	// Walk back from the latest game until one has been overwritten.
+	int readable = 0;
+	for (int back = 0; back < MOVELOG_GAMES; back++)
+	{
+		MoveLog_Game game;
+		int g = games - 1 - back;
+		int n = MoveLog_Read(&log, back, &game, moves);
+		if (n < 0)
+		{
+			break;
+		}
+		readable++;
+		round_trip &= n == played_moves[g % MOVELOG_GAMES] && game.ended && game.number == (g & 0xFF)
+				&& memcmp(moves, played[g % MOVELOG_GAMES], n) == 0;
+	}
+
+	// The ring's tail is the stream's tail.
+	int tail = log.bit_head / 8 < MOVELOG_RING_BYTES ? log.bit_head / 8 : MOVELOG_RING_BYTES;
+	int stream_matches = move_log_streamed == (int) (log.bit_head / 8);
+	for (int i = 1; i <= tail; i++)
+	{
+		stream_matches &= move_log_stream[move_log_streamed - i]
+				== log.ring[(log.bit_head / 8 - i) & (MOVELOG_RING_BYTES - 1)];
+	}
+
+	report(name, "plain_game_bytes", (double) bytes[MOVELOG_PLAIN] / counts[MOVELOG_PLAIN], "B");
+	report(name, "plain_bits_per_move", 8.0 * bytes[MOVELOG_PLAIN] / total_moves[MOVELOG_PLAIN], "bits");
+	report(name, "ultimate_game_bytes", (double) bytes[MOVELOG_ULTIMATE] / counts[MOVELOG_ULTIMATE], "B");
+	report(name, "ultimate_bits_per_move", 8.0 * bytes[MOVELOG_ULTIMATE] / total_moves[MOVELOG_ULTIMATE], "bits");
+	report(name, "games_in_ring", readable, "games");
+	report(name, "round_trip", readable > 0 && round_trip, "bool");
+	report(name, "stream_matches", stream_matches, "bool");
+}
+
+// A game's state and panel are lost mid-game and rebuilt from the log in one
+// redraw job, against drawing the board and then the same moves one by one.
+static const char replay_moves[] = "1235846";
+
+static void bench_move_log_replay(const char *name)
+{
+	int tile = 1;
+
+	OledInitialize();
+	curTile = 1;
+	ResetGame();
+	OledDrain();
+
+	u64 start = sim_now_ns();
+	u64 txns = sim_oled_stats.transactions;
+	u64 bytes = sim_oled_stats.bytes;
+	BoardInit();
+	OledFb_Flush(&oledFb);
+	for (int i = 0; replay_moves[i] != '\0'; i++)
+	{
+		int pos = replay_moves[i] - '1';
+		tile = updateBoard(tile, pos / 3, pos % 3);
+		OledDrain();
+	}
+	curTile = tile;
+	report(name, "move_by_move", ms_since(start), "ms");
+	report(name, "move_by_move_spi_txns", sim_oled_stats.transactions - txns, "txns");
+	report(name, "move_by_move_spi_bytes", sim_oled_stats.bytes - bytes, "bytes");
+	Board played = board;
+
+	// Lose everything but the log.
+	Board_Clear(&board);
+	curTile = 1;
+	OledInitialize();
+
+	start = sim_now_ns();
+	txns = sim_oled_stats.transactions;
+	bytes = sim_oled_stats.bytes;
+	ReplayGame();
+	OledDrain();
+	report(name, "replay", ms_since(start), "ms");
+	report(name, "replay_spi_txns", sim_oled_stats.transactions - txns, "txns");
+	report(name, "replay_spi_bytes", sim_oled_stats.bytes - bytes, "bytes");
+	report(name, "log_bytes", MoveLog_GameBytes(&moveLog), "B");
+	report(name, "board_restored", memcmp(&board, &played, sizeof(board)) == 0 && curTile == tile
+			&& gameState == 0, "bool");
+	report(name, "panel_matches_fb", panel_matches_fb(), "bool");
+
+	// The same for thirty random moves of ultimate.
+	u8 legal[ULTIMATE_MOVES];
+	ultimateMode = 1;
+	ResetGame();
+	for (int i = 0; i < 30 && ultimate.result == BOARD_RESULT_PLAYING; i++)
+	{
+		UltimateMove(legal[bench_rand() % Ultimate_Moves(&ultimate, legal)]);
+	}
+	OledDrain();
+	Ultimate before = ultimate;
+	Ultimate_Initialize(&ultimate);
+	OledInitialize();
+
+	start = sim_now_ns();
+	ReplayGame();
+	OledDrain();
+	report(name, "ultimate_replay", ms_since(start), "ms");
+	report(name, "ultimate_log_bytes", MoveLog_GameBytes(&moveLog), "B");
+	report(name, "ultimate_restored", memcmp(&ultimate, &before, sizeof(ultimate)) == 0, "bool");
+	report(name, "ultimate_panel_matches_fb", panel_matches_fb(), "bool");
+	ultimateMode = 0;
+}
+
+// *********** Game Tree *********** //
+// Every game of 3x3 tic-tac-toe, played with Board_Place and Board_Result
+// (the checks updateBoard makes), by a pool of threads. The first
+// GAME_TREE_SPLIT_DEPTH plies are tasks on per-thread deques: a thread works
+// on the newest task of its own deque and, when that is empty, steals the
+// oldest of another's. Below that depth a task is searched recursively.
+// Every position visited goes into a lock-free transposition table, which
+// counts the distinct ones.
+#define GAME_TREE_MAX_THREADS 64
+#define GAME_TREE_SPLIT_DEPTH 4
+#define GAME_TREE_DEQUE_LEN 1024		// Holds every task the split depth makes
+#define GAME_TREE_TABLE_BITS 14
+#define GAME_TREE_TABLE_SLOTS (1 << GAME_TREE_TABLE_BITS)
+#define GAME_TREE_RUNS 5
+
+// Known totals
+#define GAME_TREE_GAMES 255168
+#define GAME_TREE_X_WINS 131184
+#define GAME_TREE_O_WINS 77904
+#define GAME_TREE_DRAWS 46080
+#define GAME_TREE_NODES 549946
+#define GAME_TREE_POSITIONS 5478
+
+typedef struct GameTreeTask {
+	Board board;
+	u8 tile;		// Tile to move
+	u8 depth;
+} GameTreeTask;
+
+typedef struct GameTreeWorker {
+	pthread_t thread;
+	int id;
+	pthread_mutex_t lock;
+	GameTreeTask tasks[GAME_TREE_DEQUE_LEN];
+	u32 top, bottom;		// Thieves take at top, the owner at bottom.
+	u64 nodes;
+	u64 games[3];			// Indexed by result: draw, X won, O won
+	u32 steals;
+} GameTreeWorker;
+
+static GameTreeWorker game_tree_workers[GAME_TREE_MAX_THREADS];
+static int game_tree_threads;
+static int game_tree_pending;		// Tasks queued or running
+static u32 game_tree_table[GAME_TREE_TABLE_SLOTS];	// Position key + 1; 0 is empty
+static int game_tree_positions;
+
+// Adds a position to the table unless it is there already. Slots only ever
+// go from empty to a key, so a probe can stop at the first empty slot or at
+// its own key.
+static void game_tree_insert(const Board *board)
+{
+	u32 entry = (board->tiles[0] | board->tiles[1] << BOARD_CELLS) + 1;
+	u32 slot = (entry * 2654435761u) >> (32 - GAME_TREE_TABLE_BITS);
+
+	while (1)
+	{
+		u32 seen = __atomic_load_n(&game_tree_table[slot], __ATOMIC_RELAXED);
+		if (seen == 0)
+		{
+			if (__atomic_compare_exchange_n(&game_tree_table[slot], &seen, entry, 0,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+				__atomic_fetch_add(&game_tree_positions, 1, __ATOMIC_RELAXED);
+				return;
+			}
+			// Another thread filled the slot first; seen is what it wrote.
+		}
+		if (seen == entry)
+		{
+			return;
+		}
+		slot = (slot + 1) & (GAME_TREE_TABLE_SLOTS - 1);
+	}
+}
+
+static void game_tree_push(GameTreeWorker *worker, const Board *board, int tile, int depth)
+{
+	__atomic_fetch_add(&game_tree_pending, 1, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&worker->lock);
+	GameTreeTask *task = &worker->tasks[worker->bottom++ % GAME_TREE_DEQUE_LEN];
+	task->board = *board;
+	task->tile = tile;
+	task->depth = depth;
+	pthread_mutex_unlock(&worker->lock);
+}
+
+// Takes the newest task of the worker's own deque, or with steal set the
+// oldest one.
+static int game_tree_take(GameTreeWorker *worker, GameTreeTask *task, int steal)
+{
+	int taken = 0;
+
+	pthread_mutex_lock(&worker->lock);
+	if (worker->top != worker->bottom)
+	{
+		*task = steal ? worker->tasks[worker->top++ % GAME_TREE_DEQUE_LEN]
+				: worker->tasks[--worker->bottom % GAME_TREE_DEQUE_LEN];
+		taken = 1;
+	}
+	pthread_mutex_unlock(&worker->lock);
+	return taken;
+}
+
+// Visits a position that is still being played and every game below it.
+static void game_tree_visit(GameTreeWorker *worker, const Board *board, int tile, int depth)
+{
+	int other = tile == BOARD_X ? BOARD_O : BOARD_X;
+
+	worker->nodes++;
+	game_tree_insert(board);
+	for (int cell = 0; cell < BOARD_CELLS; cell++)
+	{
+		Board next = *board;
+		if (!Board_Place(&next, tile, cell))
+		{
+			continue;
+		}
+		int result = Board_Result(&next, tile);
+		if (result != BOARD_RESULT_PLAYING)
+		{
+			worker->nodes++;
+			worker->games[result]++;
+			game_tree_insert(&next);
+		}
+		else if (depth + 1 < GAME_TREE_SPLIT_DEPTH)
+		{
+			game_tree_push(worker, &next, other, depth + 1);
+		}
+		else
+		{
+			game_tree_visit(worker, &next, other, depth + 1);
+		}
+	}
+}
+
+static void *game_tree_worker(void *arg)
+{
+	GameTreeWorker *worker = arg;
+	GameTreeTask task;
+
+	// A task's children are pushed before it counts as done, so no task is
+	// left once pending reaches 0.
+	while (__atomic_load_n(&game_tree_pending, __ATOMIC_ACQUIRE) > 0)
+	{
+		int found = game_tree_take(worker, &task, 0);
+		for (int i = 1; !found && i < game_tree_threads; i++)
+		{
+			found = game_tree_take(&game_tree_workers[(worker->id + i) % game_tree_threads], &task, 1);
+			worker->steals += found;
+		}
+		if (!found)
+		{
+			sched_yield();
+			continue;
+		}
+		game_tree_visit(worker, &task.board, task.tile, task.depth);
+		__atomic_fetch_sub(&game_tree_pending, 1, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+typedef struct GameTreeResult {
+	u64 nodes;
+	u64 games[3];
+	u32 steals;
+	int positions;
+	double ns;
+} GameTreeResult;
+
+static GameTreeResult game_tree_solve(int threads)
+{
+	GameTreeResult result = { 0, { 0, 0, 0 }, 0, 0, 0 };
+	Board empty;
+
+	memset(game_tree_table, 0, sizeof(game_tree_table));
+	game_tree_positions = 0;
+	game_tree_pending = 0;
+	game_tree_threads = threads;
+	for (int i = 0; i < threads; i++)
+	{
+		GameTreeWorker *worker = &game_tree_workers[i];
+		worker->id = i;
+		pthread_mutex_init(&worker->lock, NULL);
+		worker->top = worker->bottom = 0;
+		worker->nodes = 0;
+		memset(worker->games, 0, sizeof(worker->games));
+		worker->steals = 0;
+	}
+	Board_Clear(&empty);
+	game_tree_push(&game_tree_workers[0], &empty, BOARD_X, 0);
+
+	u64 start = host_ns();
+	for (int i = 0; i < threads; i++)
+	{
+		pthread_create(&game_tree_workers[i].thread, NULL, game_tree_worker, &game_tree_workers[i]);
+	}
+	for (int i = 0; i < threads; i++)
+	{
+		pthread_join(game_tree_workers[i].thread, NULL);
+	}
+	result.ns = host_ns() - start;
+
+	for (int i = 0; i < threads; i++)
+	{
+		GameTreeWorker *worker = &game_tree_workers[i];
+		result.nodes += worker->nodes;
+		for (int r = 0; r < 3; r++)
+		{
+			result.games[r] += worker->games[r];
+		}
+		result.steals += worker->steals;
+		pthread_mutex_destroy(&worker->lock);
+	}
+	result.positions = game_tree_positions;
+	return result;
+}
+
+// Solves the tree with 1, 2, 4 ... threads up to the host's cores (and with
+// all of them); every run must reproduce the known totals. The fastest of
+// GAME_TREE_RUNS runs is reported.
+static void bench_game_tree(const char *name)
+{
+	int cores = get_nprocs();
+	int max_threads = cores < GAME_TREE_MAX_THREADS ? cores : GAME_TREE_MAX_THREADS;
+	double single = 0;
+	char metric[32];
+	int exact = 1;
+	GameTreeResult result = { 0 };
+	int threads = 1;
+
+	while (threads <= max_threads)
+	{
+		double best_ns = 0;
+		u32 steals = 0;
+		for (int run = 0; run < GAME_TREE_RUNS; run++)
+		{
+			result = game_tree_solve(threads);
+			exact &= result.games[BOARD_RESULT_DRAW] + result.games[BOARD_X] + result.games[BOARD_O] == GAME_TREE_GAMES
+					&& result.games[BOARD_X] == GAME_TREE_X_WINS && result.games[BOARD_O] == GAME_TREE_O_WINS
+					&& result.games[BOARD_RESULT_DRAW] == GAME_TREE_DRAWS
+					&& result.nodes == GAME_TREE_NODES && result.positions == GAME_TREE_POSITIONS;
+			if (run == 0 || result.ns < best_ns)
+			{
+				best_ns = result.ns;
+				steals = result.steals;
+			}
+		}
+
+		double rate = GAME_TREE_NODES / (best_ns / SIM_NS_PER_S);
+		if (threads == 1)
+		{
+			single = rate;
+		}
+		snprintf(metric, sizeof(metric), "positions_%dt", threads);
+		report(name, metric, rate, "host /s");
+		snprintf(metric, sizeof(metric), "scaling_%dt", threads);
+		report(name, metric, rate / single, "x");
+		snprintf(metric, sizeof(metric), "steals_%dt", threads);
+		report(name, metric, steals, "tasks");
+
+		threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2;
+	}
+
+	report(name, "games", result.games[BOARD_RESULT_DRAW] + result.games[BOARD_X] + result.games[BOARD_O], "games");
+	report(name, "x_wins", result.games[BOARD_X], "games");
+	report(name, "o_wins", result.games[BOARD_O], "games");
+	report(name, "draws", result.games[BOARD_RESULT_DRAW], "games");
+	report(name, "distinct_positions", result.positions, "positions");
+	report(name, "totals_exact", exact, "bool");
+}
+
+// *********** Ultimate *********** //
+// Random games: the move list must hold exactly the moves Ultimate_IsLegal
+// accepts, and every game must end.
+static void bench_ultimate_rules(const char *name)
+{
+	const int games = 2000;
+	u8 moves[ULTIMATE_MOVES];
+	int agree = 1, ended = 1, wins = 0, total_moves = 0;
+
+	for (int g = 0; g < games; g++)
+	{
+		Ultimate game;
+		Ultimate_Initialize(&game);
+		int plies = 0;
+
+		while (game.result == BOARD_RESULT_PLAYING && plies <= ULTIMATE_MOVES)
+		{
+			int n = Ultimate_Moves(&game, moves);
+			int legal = 0;
+			for (int m = 0; m < ULTIMATE_MOVES; m++)
+			{
+				legal += Ultimate_IsLegal(&game, m);
+			}
+			agree &= n == legal && n > 0;
+			if (n == 0)
+			{
+				break;
+			}
+			Ultimate_Play(&game, moves[bench_rand() % n]);
+			plies++;
+		}
+		ended &= game.result != BOARD_RESULT_PLAYING;
+		wins += game.result != BOARD_RESULT_DRAW;
+		total_moves += plies;
+	}
+	report(name, "games", games, "games");
+	report(name, "moves_per_game", (double) total_moves / games, "moves");
+	report(name, "decisive", 100.0 * wins / games, "%");
+	report(name, "move_list_agrees", agree, "bool");
+	report(name, "games_end", ended, "bool");
+}
+
+// Host microsecond clock for searches run outside the simulation.
+static u32 host_us(void)
+{
+	return (u32) (host_ns() / 1000);
+}
+
+#define MCTS_BENCH_THREADS 8
+#define MCTS_BENCH_NODES 4096
+#define MCTS_BENCH_MS 200
+
+typedef struct MctsWorker {
+	pthread_t thread;
+	u32 seed;
+	u32 playouts;
+	int move;
+} MctsWorker;
+
+// One search from the opening on its own pool, as a thread would run it in a
+// root-parallel search.
+static void *mcts_worker(void *arg)
+{
+	MctsWorker *worker = arg;
+	Mcts_Node *pool = malloc(MCTS_BENCH_NODES * sizeof(Mcts_Node));
+	Mcts mcts;
+	Ultimate root;
+
+	Ultimate_Initialize(&root);
+	Mcts_Initialize(&mcts, pool, MCTS_BENCH_NODES, worker->seed);
+	Mcts_SetClock(&mcts, host_us, 1);
+	worker->move = Mcts_Search(&mcts, &root, MCTS_BENCH_MS * 1000, 0);
+	worker->playouts = mcts.playouts;
+	free(pool);
+	return NULL;
+}
+
+// Playouts per second of a time-budgeted search, with 1, 2, 4 ... threads
+// searching at once (up to the host's cores).
+static void bench_mcts_throughput(const char *name)
+{
+	int cores = get_nprocs();
+	int max_threads = cores < MCTS_BENCH_THREADS ? cores : MCTS_BENCH_THREADS;
+	MctsWorker workers[MCTS_BENCH_THREADS];
+	double single = 0;
+	char metric[32];
+	int legal = 1;
+
+	for (int threads = 1; threads <= max_threads; threads *= 2)
+	{
+		u32 playouts = 0;
+		for (int i = 0; i < threads; i++)
+		{
+			workers[i].seed = 1 + i;
+			pthread_create(&workers[i].thread, NULL, mcts_worker, &workers[i]);
+		}
+		for (int i = 0; i < threads; i++)
+		{
+			pthread_join(workers[i].thread, NULL);
+			playouts += workers[i].playouts;
+			legal &= workers[i].move >= 0 && workers[i].move < ULTIMATE_MOVES;
+		}
+
+		double rate = playouts * 1000.0 / MCTS_BENCH_MS;
+		if (threads == 1)
+		{
+			single = rate;
+		}
+		snprintf(metric, sizeof(metric), "playouts_%dt", threads);
+		report(name, metric, rate, "host /s");
+		snprintf(metric, sizeof(metric), "scaling_%dt", threads);
+		report(name, metric, rate / single, "x");
+	}
+	report(name, "moves_legal", legal, "bool");
+}
+
+// MCTS with a fixed number of playouts against uniformly random moves,
+// taking each side in turn.
+static void bench_mcts_vs_random(const char *name)
+{
+	const int games = 10;
+	const int playouts = 1000;
+	static Mcts_Node pool[MCTS_BENCH_NODES];
+	u8 moves[ULTIMATE_MOVES];
+	Mcts mcts;
+	int wins = 0, draws = 0;
+
+	Mcts_Initialize(&mcts, pool, MCTS_BENCH_NODES, 12345);
+	Mcts_SetClock(&mcts, host_us, 1);
+	for (int g = 0; g < games; g++)
+	{
+		int ai_tile = g % 2 ? BOARD_O : BOARD_X;
+		Ultimate game;
+		Ultimate_Initialize(&game);
+
+		while (game.result == BOARD_RESULT_PLAYING)
+		{
+			if (game.to_move == ai_tile)
+			{
+				Ultimate_Play(&game, Mcts_Search(&mcts, &game, 0xFFFFFFFF / 2, playouts));
+			}
+			else
+			{
+				int n = Ultimate_Moves(&game, moves);
+				Ultimate_Play(&game, moves[bench_rand() % n]);
+			}
+		}
+		wins += game.result == ai_tile;
+		draws += game.result == BOARD_RESULT_DRAW;
+	}
+	report(name, "games", games, "games");
+	report(name, "wins", wins, "games");
+	report(name, "draws", draws, "games");
+	report(name, "beats_random", wins > games / 2, "bool");
+}
+
+// *********** Spectators *********** //
+#define SPECTATOR_SEATS 3
+
+// Spectator frames from a seat's capture replayed into a view; the board it
+// ends up with.
+static void spectators_replay(Spectators_View *view, SimBle *viewer, const u8 *bytes, int len, Board *out)
+{
+	Spectators_Event events[8];
+
+	sim_ble_peer_send(viewer, bytes, len, 0);
+	for (int ms = 0; ms < 100; ms++)
+	{
+		sim_advance_ns(SIM_NS_PER_MS);
+		int n = Spectators_Watch(view, events, 8);
+		for (int i = 0; i < n; i++)
+		{
+			if (events[i].kind == SPECTATORS_EVENT_SNAPSHOT)
+			{
+				*out = events[i].board;
+			}
+			else
+			{
+				Board_Place(out, events[i].tile, events[i].cell);
+			}
+		}
+	}
+}
+
+static double spectators_run_for(Spectators *sp, int ms)
+{
+	double worst = 0;
+
+	for (int i = 0; i < ms; i++)
+	{
+		u64 start = sim_now_ns();
+		Spectators_Run(sp);
+		double pass = ms_since(start);
+		worst = pass > worst ? pass : worst;
+		sim_advance_ns(SIM_NS_PER_MS);
+	}
+	return worst;
+}
+
+// Two boards watch from the start and a third joins mid-game. The first two
+// must get the same bytes; the late one a snapshot and then the live moves;
+// all must end up with the played board. Publishing is timed on the host.
+static void bench_spectators(const char *name)
+{
+	static const u8 cells[] = { 4, 0, 8, 2, 6, 3, 5 };
+	static PmodBLE_Interface_t seats[SPECTATOR_SEATS + 1];
+	static Spectators sp;
+	static Spectators_View view;
+	static u8 captured[SPECTATOR_SEATS][512];
+	int lengths[SPECTATOR_SEATS];
+	SimBle *sims[SPECTATOR_SEATS + 1];
+
+	// Instance SPECTATOR_SEATS is the watching board's.
+	for (int i = 0; i <= SPECTATOR_SEATS; i++)
+	{
+		SimBleConfig cfg = sim_ble_default_config;
+		snprintf(cfg.address, sizeof(cfg.address), "801F12B7000%d", i);
+		sims[i] = sim_ble_create(0x45000000 + i * 0x10000, &cfg);
+		PmodBLE_Interface_Initialize(&seats[i], 0x46000000 + i * 0x10000, 0x45000000 + i * 0x10000);
+	}
+	Spectators_Initialize(&sp);
+	for (int i = 0; i < SPECTATOR_SEATS; i++)
+	{
+		Spectators_AddSeat(&sp, &seats[i]);
+	}
+
+	sim_ble_peer_connect(sims[0], 0);
+	sim_ble_peer_connect(sims[1], 0);
+	double worst = spectators_run_for(&sp, 50);
+	Spectators_NewGame(&sp, BOARD_X);
+
+	int tile = BOARD_X;
+	int n = sizeof(cells);
+	for (int i = 0; i < n; i++)
+	{
+		if (i == 3)
+		{
+			sim_ble_peer_connect(sims[2], 0);
+		}
+		Spectators_Publish(&sp, cells[i], tile);
+		tile = tile == BOARD_X ? BOARD_O : BOARD_X;
+		double pass = spectators_run_for(&sp, 20);
+		worst = pass > worst ? pass : worst;
+	}
+	spectators_run_for(&sp, 50);
+
+	for (int i = 0; i < SPECTATOR_SEATS; i++)
+	{
+		lengths[i] = sim_ble_peer_take(sims[i], captured[i], sizeof(captured[i]));
+	}
+	report(name, "joins", sp.joins, "boards");
+	report(name, "frames_sent", sp.frames_sent, "frames");
+	report(name, "snapshots_sent", sp.snapshots_sent, "frames");
+	report(name, "seats_identical", lengths[0] == lengths[1]
+			&& memcmp(captured[0], captured[1], lengths[0]) == 0, "bool");
+	report(name, "late_starts_with_snapshot", lengths[2] > 0
+			&& captured[2][1] == SPECTATORS_TYPE_SNAPSHOT, "bool");
+	report(name, "worst_pass", worst, "ms");
+
+	int agree = 1;
+	for (int i = 0; i < SPECTATOR_SEATS; i++)
+	{
+		Board watched;
+		Board_Clear(&watched);
+		Spectators_ViewInitialize(&view, &seats[SPECTATOR_SEATS]);
+		spectators_replay(&view, sims[SPECTATOR_SEATS], captured[i], lengths[i], &watched);
+		agree &= memcmp(&watched, &sp.board, sizeof(Board)) == 0 && view.gaps == 0;
+	}
+	report(name, "views_agree", agree, "bool");
+
+	// A view that misses a move counts the gap and is mended by the next
+	// snapshot.
+	Spectators_ViewInitialize(&view, &seats[SPECTATOR_SEATS]);
+	Board watched;
+	Board_Clear(&watched);
+	int skip = MOVELINK_FRAME_BYTES * 2;		// The snapshot, then move 1
+	memmove(&captured[0][skip], &captured[0][skip + MOVELINK_FRAME_BYTES], lengths[0] - skip - MOVELINK_FRAME_BYTES);
+	spectators_replay(&view, sims[SPECTATOR_SEATS], captured[0], lengths[0] - MOVELINK_FRAME_BYTES, &watched);
+	report(name, "gap_counted", view.gaps > 0, "bool");
+
+	// Frames no game can send: a cell taken by both tiles, no tile to move,
+	// a cell past the board and no tile.
+	u8 bad[4 * MOVELINK_FRAME_BYTES];
+	MoveLink_Encode(&bad[0], SPECTATORS_TYPE_SNAPSHOT, 0x01, 0x01, 0, BOARD_X);
+	MoveLink_Encode(&bad[6], SPECTATORS_TYPE_SNAPSHOT, 0, 0, 0, 3);
+	MoveLink_Encode(&bad[12], SPECTATORS_TYPE_MOVE, 1, 0, 12, BOARD_X);
+	MoveLink_Encode(&bad[18], SPECTATORS_TYPE_MOVE, 1, 0, 4, 0);
+	Spectators_ViewInitialize(&view, &seats[SPECTATOR_SEATS]);
+	Board_Clear(&watched);
+	spectators_replay(&view, sims[SPECTATOR_SEATS], bad, sizeof(bad), &watched);
+	report(name, "bad_frames_rejected", view.rejected == 4 && BOARD_OCCUPIED(&watched) == 0, "bool");
+
+	// A watching board with an address above the seat's dials all the same;
+	// over a real link it starts from a snapshot of the game so far.
+	static PmodBLE_Interface_t late_seat, watcher;
+	static LinkSupervisor watch_sup;
+	Spectators_Event events[4];
+	SimBleConfig cfg = sim_ble_default_config;
+	strcpy(cfg.address, "801F12B70004");
+	SimBle *late_sim = sim_ble_create(0x45040000, &cfg);
+	strcpy(cfg.address, "801F12B80005");
+	SimBle *watcher_sim = sim_ble_create(0x45050000, &cfg);
+	sim_ble_link(late_sim, watcher_sim);
+	PmodBLE_Interface_Initialize(&late_seat, 0x46040000, 0x45040000);
+	PmodBLE_Interface_Initialize(&watcher, 0x46050000, 0x45050000);
+	Spectators_AddSeat(&sp, &late_seat);
+	Spectators_ViewInitialize(&view, &watcher);
+	LinkSupervisor_InitializeDialer(&watch_sup, &watcher, (const u8 *) "801F12B70004");
+
+	int snapshot = 0;
+	u64 start = sim_now_ns();
+	while (!snapshot && sim_now_ns() - start < 5 * SIM_NS_PER_S)
+	{
+		if (LinkSupervisor_Run(&watch_sup))
+		{
+			int got = Spectators_Watch(&view, events, 4);
+			for (int i = 0; i < got; i++)
+			{
+				snapshot |= events[i].kind == SPECTATORS_EVENT_SNAPSHOT
+						&& memcmp(&events[i].board, &sp.board, sizeof(Board)) == 0;
+			}
+		}
+		Spectators_Run(&sp);
+		sim_advance_ns(SIM_NS_PER_MS);
+	}
+	report(name, "watcher_dials", watch_sup.attempts >= 1 && watch_sup.connects == 1, "bool");
+	report(name, "watcher_snapshot", snapshot, "bool");
+
+	// Publishing is all the players' path pays, however many boards watch.
+	const int rounds = 100000;
+	start = host_ns();
+	for (int r = 0; r < rounds; r++)
+	{
+		if (r % BOARD_CELLS == 0)
+		{
+			Spectators_NewGame(&sp, BOARD_X);
+		}
+		Spectators_Publish(&sp, r % BOARD_CELLS, 1 + r % 2);
+	}
+	report(name, "publish", (double) (host_ns() - start) / rounds, "host ns");
+}
+
+// *********** Event Loop *********** //
+// Runs passes of the game's event loop until done(arg) or timeout_ms.
+// Return: longest single pass in ms.
+static double run_game_loop(int (*done)(void *), void *arg, u32 timeout_ms)
+{
+	double worst = 0;
+	u64 start = sim_now_ns();
+
+	while (!done(arg) && sim_now_ns() - start < (u64) timeout_ms * SIM_NS_PER_MS)
+	{
+		u64 pass = sim_now_ns();
+		KYPDRun();
+		BleRun();
+		AiRun();
+		OledRun();
+		if (ms_since(pass) > worst)
+		{
+			worst = ms_since(pass);
+		}
+	}
+	return worst;
+}
+
+static int cell_drawn(void *arg)
+{
+	return Board_TileAt(&board, (long) arg) != BOARD_EMPTY && displayCount == 0;
+}
+
+// A local move from the keypad, then the other player's move arriving while
+// no key is pressed: it must be drawn without waiting for the keypad. Then one
+// sent before our turn is over.
+static void bench_game_loop(const char *name)
+{
+	u8 frame[MOVELINK_FRAME_BYTES];
+
+	KYPDInitialize();
+	OledInitialize();
+	SimBle *ble = connect_peer();
+	BoardInit();
+	ResetGame();
+	OledDrain();
+	MoveLink_Initialize(&moveLink);
+	LinkSupervisor_Initialize(&linkSupervisor, &moveLink, (const u8 *) PEER_ADDRESS);
+	curTile = 1;
+
+	u64 press = sim_now_ns() + 5 * SIM_NS_PER_MS;
+	sim_kypd_press('5', press, 30000);
+	double worst = run_game_loop(cell_drawn, (void *) 4L, 1000);
+	report(name, "key_to_pixels", (double) (sim_now_ns() - press) / SIM_NS_PER_MS, "ms");
+
+	MoveLink_Encode(frame, MOVELINK_TYPE_MOVE, 1, 1, 0, 2);
+	sim_ble_peer_send(ble, frame, sizeof(frame), 0);
+	u64 sent = sim_now_ns();
+	double pass = run_game_loop(cell_drawn, (void *) 0L, 1000);
+	worst = pass > worst ? pass : worst;
+	report(name, "remote_to_pixels", ms_since(sent), "ms");
+	report(name, "remote_drawn", Board_TileAt(&board, 0) == BOARD_O, "bool");
+
+	// The other player's next move sent before ours: it must neither be
+	// drawn nor acked until ours is made, and then drawn.
+	MoveLink_Encode(frame, MOVELINK_TYPE_MOVE, 2, 1, 1, 2);
+	sim_ble_peer_send(ble, frame, sizeof(frame), 0);
+	run_game_loop(cell_drawn, (void *) 1L, 20);
+	report(name, "early_move_held", Board_TileAt(&board, 1) == BOARD_EMPTY && moveLink.rx_expected == 2, "bool");
+	press = sim_now_ns() + 5 * SIM_NS_PER_MS;
+	sim_kypd_press('9', press, 30000);
+	pass = run_game_loop(cell_drawn, (void *) 1L, 1000);
+	worst = pass > worst ? pass : worst;
+	report(name, "early_move_drawn", Board_TileAt(&board, 8) == BOARD_X && Board_TileAt(&board, 1) == BOARD_O, "bool");
+	report(name, "worst_pass", worst, "ms");
+}
+
+static char latency_text[2048];
+static int latency_text_len;
+
+static void latency_capture(const u8 *bytes, int count)
+{
+	memcpy(&latency_text[latency_text_len], bytes, count);
+	latency_text_len += count;
+}
+
+// The probes along one move each way, compared with the same latencies
+// measured on the simulator's clock; then the dump, and the probes' cost.
+static void bench_latency(const char *name)
+{
+	u8 frame[MOVELINK_FRAME_BYTES];
+
+	KYPDInitialize();
+	OledInitialize();
+	Latency_Reset();
+	SimBle *ble = connect_peer();
+	BoardInit();
+	ResetGame();
+	OledDrain();
+	MoveLink_Initialize(&moveLink);
+	LinkSupervisor_Initialize(&linkSupervisor, &moveLink, (const u8 *) PEER_ADDRESS);
+	curTile = 1;
+	singlePlayer = 0;
+
+	u64 press = sim_now_ns() + 5 * SIM_NS_PER_MS;
+	sim_kypd_press('5', press, 30000);
+	run_game_loop(cell_drawn, (void *) 4L, 1000);
+	double key_to_pixels = (double) (sim_now_ns() - press) / SIM_NS_PER_MS;
+
+	MoveLink_Encode(frame, MOVELINK_TYPE_MOVE, 1, 1, 0, 2);
+	sim_ble_peer_send(ble, frame, sizeof(frame), 0);
+	u64 sent = sim_now_ns();
+	run_game_loop(cell_drawn, (void *) 0L, 1000);
+	double remote_to_pixels = ms_since(sent);
+
+	const Latency_Histogram *key_to_tx = Latency_Get(LATENCY_KEY_TO_TX);
+	const Latency_Histogram *key_to_drawn = Latency_Get(LATENCY_KEY_TO_DRAWN);
+	const Latency_Histogram *rx_to_drawn = Latency_Get(LATENCY_RX_TO_DRAWN);
+	report(name, "key_to_tx", key_to_tx->max_us / 1000.0, "ms");
+	report(name, "key_to_drawn", key_to_drawn->max_us / 1000.0, "ms");
+	report(name, "rx_to_drawn", rx_to_drawn->max_us / 1000.0, "ms");
+	report(name, "connect", Latency_Get(LATENCY_CONNECT)->max_us / 1000.0, "ms");
+	report(name, "cmd_enter", Latency_Get(LATENCY_CMD_ENTER)->max_us / 1000.0, "ms");
+	report(name, "one_sample_each", key_to_tx->count == 1 && key_to_drawn->count == 1
+			&& rx_to_drawn->count == 1 && Latency_Get(LATENCY_CONNECT)->count == 1, "bool");
+
+	// The key is stamped when the scanner sees it, within a scan period of
+	// the press; the receive stamp comes after the frame's transfer.
+	double key_error = key_to_pixels - key_to_drawn->max_us / 1000.0;
+	report(name, "key_to_drawn_agrees", key_error >= 0 && key_error <= KEYPADSCAN_PERIOD_US / 1000.0, "bool");
+	report(name, "rx_within_remote", rx_to_drawn->max_us / 1000.0 <= remote_to_pixels, "bool");
+
+	latency_text_len = 0;
+	int bytes = Latency_Dump(latency_capture);
+	int lines = 0;
+	for (int i = 0; i < latency_text_len; i++)
+	{
+		lines += latency_text[i] == '\n';
+	}
+	report(name, "dump_bytes", bytes, "B");
+	report(name, "dump_complete", bytes == latency_text_len && lines == LATENCY_SPANS + 1, "bool");
+
+	// Host cost of a mark and of a span, timer read included.
+	const int rounds = 1000000;
+	u64 start = host_ns();
+	for (int r = 0; r < rounds; r++)
+	{
+		LATENCY_MARK(LATENCY_MARK_KEY);
+	}
+	report(name, "mark", (double) (host_ns() - start) / rounds, "host ns");
+	start = host_ns();
+	for (int r = 0; r < rounds; r++)
+	{
+		LATENCY_SPAN(LATENCY_KEY_TO_TX, LATENCY_MARK_KEY);
+	}
+	report(name, "span", (double) (host_ns() - start) / rounds, "host ns");
+	report(name, "ram", sizeof(Latency_Marks) + LATENCY_SPANS * sizeof(Latency_Histogram), "B");
+}
+
+static int link_down(void *arg)
+{
+	return linkSupervisor.state == LINKSUPERVISOR_DOWN;
+}
+
+static int link_up(void *arg)
+{
+	return linkSupervisor.state == LINKSUPERVISOR_UP;
+}
+
+static int never(void *arg)
+{
+	return 0;
+}
+
+// The link drops mid-game while each side makes a move the other never gets.
+// The supervisor must reconnect and resync so that only those two moves
+// cross again; then a peer that refuses connections for a while must be
+// retried with backoff until it answers.
+static void bench_ble_link_recovery(const char *name)
+{
+	u8 frames[2 * MOVELINK_FRAME_BYTES];
+	u8 sent[64];
+
+	KYPDInitialize();
+	OledInitialize();
+	SimBle *ble = connect_peer();
+	BoardInit();
+	ResetGame();
+	OledDrain();
+	MoveLink_Initialize(&moveLink);
+	LinkSupervisor_Initialize(&linkSupervisor, &moveLink, (const u8 *) PEER_ADDRESS);
+	curTile = 1;
+
+	// Our move 1 (centre) and the peer's move 1 (top left) go through.
+	sim_kypd_press('5', sim_now_ns() + 5 * SIM_NS_PER_MS, 30000);
+	run_game_loop(cell_drawn, (void *) 4L, 1000);
+	MoveLink_Encode(frames, MOVELINK_TYPE_MOVE, 1, 1, 0, 2);
+	sim_ble_peer_send(ble, frames, MOVELINK_FRAME_BYTES, 0);
+	run_game_loop(cell_drawn, (void *) 0L, 1000);
+	sim_ble_peer_take(ble, sent, sizeof(sent));
+
+	// The link drops; our move 2 (bottom right) goes nowhere, and neither does
+	// the peer's move 2 (top right).
+	sim_ble_drop_link(ble, 0);
+	u64 dropped = sim_now_ns();
+	run_game_loop(link_down, NULL, 1000);
+	report(name, "loss_noticed", ms_since(dropped), "ms");
+	sim_kypd_press('9', sim_now_ns() + 5 * SIM_NS_PER_MS, 30000);
+	run_game_loop(cell_drawn, (void *) 8L, 1000);
+
+	double worst = run_game_loop(link_up, NULL, 5000);
+	u64 up = sim_now_ns();
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	int n = sim_ble_peer_take(ble, sent, sizeof(sent));
+	int resync_bytes = n;
+	report(name, "outage", linkSupervisor.last_outage_us / 1000.0, "ms");
+	report(name, "connect_attempts", linkSupervisor.attempts, "attempts");
+	report(name, "sync_sent", n == MOVELINK_FRAME_BYTES && sent[1] == MOVELINK_TYPE_SYNC
+			&& sent[2] == 2 && sent[3] == 1 && sent[4] == 1, "bool");
+
+	// The peer does what MoveLink does with the SYNC: resends its move 2,
+	// which our ack misses, and answers with its own SYNC, whose ack misses
+	// our move 2.
+	MoveLink_Encode(frames, MOVELINK_TYPE_MOVE, 2, 1, 2, 2);
+	MoveLink_Encode(&frames[MOVELINK_FRAME_BYTES], MOVELINK_TYPE_SYNC, 2, 1, 0, 0);
+	sim_ble_peer_send(ble, frames, sizeof(frames), 0);
+	resync_bytes += sizeof(frames);
+	run_game_loop(cell_drawn, (void *) 2L, 1000);
+	report(name, "resync", ms_since(up), "ms");
+	run_game_loop(never, NULL, 50);
+	sim_run_until(tx_idle, ble, SIM_NS_PER_S);
+	n = sim_ble_peer_take(ble, sent, sizeof(sent));
+	resync_bytes += n;
+	report(name, "resync_bytes", resync_bytes, "B");
+	report(name, "lost_move_resent_once", n == MOVELINK_FRAME_BYTES && sent[1] == MOVELINK_TYPE_MOVE
+			&& sent[2] == 2 && sent[4] == (8 << 4 | 1), "bool");
+	report(name, "boards_agree", Board_TileAt(&board, 2) == BOARD_O && Board_TileAt(&board, 8) == BOARD_X
+			&& curTile == 1, "bool");
+	report(name, "worst_pass", worst, "ms");
+
+	// The peer refuses connections for 5 s.
+	sim_ble_config(ble)->connect_fail = 1;
+	sim_ble_drop_link(ble, 0);
+	run_game_loop(link_down, NULL, 1000);
+	u32 attempts = linkSupervisor.attempts;
+	run_game_loop(never, NULL, 5000);
+	report(name, "attempts_refused_5s", linkSupervisor.attempts - attempts, "attempts");
+	report(name, "backoff_reached", linkSupervisor.backoff_us / 1000.0, "ms");
+	sim_ble_config(ble)->connect_fail = 0;
+	run_game_loop(link_up, NULL, 10000);
+	report(name, "reconnected_after_refusals", linkSupervisor.state == LINKSUPERVISOR_UP, "bool");
+}
+
+// Runs the supervisor a millisecond apart until the link is up.
+static void supervise_until_up(u32 limit_ms)
+{
+	u64 start = sim_now_ns();
+
+	while (!LinkSupervisor_Run(&linkSupervisor) && sim_now_ns() - start < (u64) limit_ms * SIM_NS_PER_MS)
+	{
+		sim_advance_ns(SIM_NS_PER_MS);
+	}
+}
+
+static void drop_and_notice(SimBle *ble)
+{
+	sim_ble_drop_link(ble, 0);
+	while (LinkSupervisor_Run(&linkSupervisor))
+	{
+		sim_advance_ns(SIM_NS_PER_MS);
+	}
+}
+
+// Power-up and reconnect in both roles. As the central (our address below the
+// peer's) we dial; as the peripheral we are dialed and never enter command
+// mode after PmodBLE_Initialize. Neither reconnect asks for our address again.
+static void bench_ble_peer_roles(const char *name)
+{
+	PmodBLE_Peer peer;
+
+	u64 start = sim_now_ns();
+	PmodBLE_Initialize();
+	SimBle *ble = sim_ble_find(XPAR_PMODBLE_0_S_AXI_UART_BASEADDR);
+	SimBleStats *stats = sim_ble_stats(ble);
+	MoveLink_Initialize(&moveLink);
+	LinkSupervisor_Initialize(&linkSupervisor, &moveLink, (const u8 *) PEER_ADDRESS);
+	supervise_until_up(10000);
+	PmodBLE_GetPeer(&peer);
+	report(name, "central_role", peer.role == PMODBLE_ROLE_CENTRAL && linkSupervisor.state == LINKSUPERVISOR_UP, "bool");
+	report(name, "central_power_up", ms_since(start), "ms");
+	report(name, "central_power_up_sessions", stats->cmd_entries, "sessions");
+	report(name, "central_attempts", linkSupervisor.attempts, "attempts");
+
+	drop_and_notice(ble);
+	u64 entries = stats->cmd_entries;
+	u64 lines = stats->cmd_lines;
+	supervise_until_up(10000);
+	report(name, "central_reconnect", linkSupervisor.last_outage_us / 1000.0, "ms");
+	report(name, "central_reconnect_sessions", stats->cmd_entries - entries, "sessions");
+	report(name, "central_reconnect_commands", stats->cmd_lines - lines, "commands");
+
+	// The same board with an address above the peer's, powered up a while
+	// after the link went down.
+	drop_and_notice(ble);
+	sim_advance_ns(SIM_NS_PER_S);
+	strcpy(sim_ble_config(ble)->address, "801F12B7A001");
+	entries = stats->cmd_entries;
+	start = sim_now_ns();
+	PmodBLE_Initialize();
+	LinkSupervisor_Initialize(&linkSupervisor, &moveLink, (const u8 *) PEER_ADDRESS);
+	sim_ble_peer_connect(ble, 200000);
+	supervise_until_up(10000);
+	PmodBLE_GetPeer(&peer);
+	report(name, "peripheral_role", peer.role == PMODBLE_ROLE_PERIPHERAL && linkSupervisor.state == LINKSUPERVISOR_UP, "bool");
+	report(name, "peripheral_power_up", ms_since(start), "ms");
+	report(name, "peripheral_power_up_sessions", stats->cmd_entries - entries, "sessions");
+	report(name, "peripheral_attempts", linkSupervisor.attempts, "attempts");
+
+	drop_and_notice(ble);
+	entries = stats->cmd_entries;
+	sim_ble_peer_connect(ble, 150000);
+	supervise_until_up(10000);
+	report(name, "peripheral_reconnect", linkSupervisor.last_outage_us / 1000.0, "ms");
+	report(name, "peripheral_reconnect_sessions", stats->cmd_entries - entries, "sessions");
+	report(name, "peripheral_attempts_total", linkSupervisor.attempts, "attempts");
+}
+
+// A hub board serving three links, and the three boards at their other ends:
+// six modules and six interface instances in one process. The hub has the
+// lower addresses, so it dials every link.
+#define HUB_LINKS 3
+
+static void bench_ble_hub(const char *name)
+{
+	static PmodBLE_Interface_t ifaces[2 * HUB_LINKS];
+	static MoveLink links[2 * HUB_LINKS];
+	static LinkSupervisor sups[2 * HUB_LINKS];
+	char addresses[2 * HUB_LINKS][SIM_BLE_ADDRESS_LEN + 1];
+	MoveLink_Move moves[4];
+	int got[2 * HUB_LINKS] = {0};
+	int right[2 * HUB_LINKS] = {0};
+
+	// Instances 0..2 are the hub's, 3..5 the boards linked to them.
+	for (int i = 0; i < 2 * HUB_LINKS; i++)
+	{
+		SimBleConfig cfg = sim_ble_default_config;
+		snprintf(addresses[i], sizeof(addresses[i]), "801F12B%d000%d", i < HUB_LINKS ? 5 : 6, i % HUB_LINKS);
+		strcpy(cfg.address, addresses[i]);
+		sim_ble_create(0x45000000 + i * 0x10000, &cfg);
+	}
+	for (int i = 0; i < HUB_LINKS; i++)
+	{
+		sim_ble_link(sim_ble_find(0x45000000 + i * 0x10000), sim_ble_find(0x45000000 + (i + HUB_LINKS) * 0x10000));
+	}
+
+	u64 start = sim_now_ns();
+	for (int i = 0; i < 2 * HUB_LINKS; i++)
+	{
+		int other = (i + HUB_LINKS) % (2 * HUB_LINKS);
+		PmodBLE_Interface_Initialize(&ifaces[i], 0x46000000 + i * 0x10000, 0x45000000 + i * 0x10000);
+		MoveLink_InitializeOn(&links[i], &ifaces[i]);
+		LinkSupervisor_Initialize(&sups[i], &links[i], (const u8 *) addresses[other]);
+	}
+	int up = 0;
+	while (up < 2 * HUB_LINKS && sim_now_ns() - start < 10 * SIM_NS_PER_S)
+	{
+		up = 0;
+		for (int i = 0; i < 2 * HUB_LINKS; i++)
+		{
+			up += LinkSupervisor_Run(&sups[i]);
+		}
+		sim_advance_ns(SIM_NS_PER_MS);
+	}
+	report(name, "all_links_up", up == 2 * HUB_LINKS, "bool");
+	report(name, "setup", ms_since(start), "ms");
+
+	int hub_dials = 0;
+	int spoke_dials = 0;
+	for (int i = 0; i < HUB_LINKS; i++)
+	{
+		hub_dials += sups[i].attempts;
+		spoke_dials += sups[i + HUB_LINKS].attempts;
+	}
+	report(name, "hub_dials", hub_dials, "attempts");
+	report(name, "spoke_dials", spoke_dials, "attempts");
+
+	// Every instance sends its index as the cell; each must get exactly its
+	// partner's.
+	for (int i = 0; i < 2 * HUB_LINKS; i++)
+	{
+		MoveLink_SendMove(&links[i], i, 1);
+	}
+	start = sim_now_ns();
+	while (sim_now_ns() - start < 100 * SIM_NS_PER_MS)
+	{
+		for (int i = 0; i < 2 * HUB_LINKS; i++)
+		{
+			int n = MoveLink_Poll(&links[i], moves, 4);
+			for (int m = 0; m < n; m++)
+			{
+				got[i]++;
+				right[i] += moves[m].cell == (i + HUB_LINKS) % (2 * HUB_LINKS);
+			}
+		}
+		sim_advance_ns(SIM_NS_PER_MS);
+	}
+	int routed = 1;
+	for (int i = 0; i < 2 * HUB_LINKS; i++)
+	{
+		routed &= got[i] == 1 && right[i] == 1;
+	}
+	report(name, "moves_routed", routed, "bool");
+	report(name, "instance_bytes", sizeof(PmodBLE_Interface_t), "B");
+}
+
+static int board_tiles_drawn(void *arg)
+{
+	return __builtin_popcount(BOARD_OCCUPIED(&board)) >= (long) arg && displayCount == 0;
+}
+
+// Single player: our move from the keypad, then the table's reply drawn.
+static void bench_single_player(const char *name)
+{
+	KYPDInitialize();
+	OledInitialize();
+	BoardInit();
+	ResetGame();
+	OledDrain();
+	singlePlayer = 1;
+	curTile = 1;
+
+	u64 press = sim_now_ns() + 5 * SIM_NS_PER_MS;
+	sim_kypd_press('1', press, 30000);
+	double worst = run_game_loop(board_tiles_drawn, (void *) 2L, 1000);
+	report(name, "key_to_reply", (double) (sim_now_ns() - press) / SIM_NS_PER_MS, "ms");
+	report(name, "replied_center", Board_TileAt(&board, 4) == BOARD_O, "bool");
+	report(name, "worst_pass", worst, "ms");
+	singlePlayer = 0;
+}
+
+static int ultimate_replied(void *arg)
+{
+	return __builtin_popcount(ultimate.cells[1][0]) == 1 && displayCount == 0;
+}
+
+// Ultimate: our opening move from the keypad (a sub-board, then a cell), then
+// the MCTS reply searched in slices of the event loop and drawn.
+static void bench_ultimate_game_loop(const char *name)
+{
+	KYPDInitialize();
+	OledInitialize();
+	singlePlayer = 1;
+	ultimateMode = 1;
+	ResetGame();
+	OledDrain();
+
+	sim_kypd_press('5', sim_now_ns() + 5 * SIM_NS_PER_MS, 30000);
+	u64 press = sim_now_ns() + 50 * SIM_NS_PER_MS;
+	sim_kypd_press('1', press, 30000);
+	double worst = run_game_loop(ultimate_replied, NULL, 2000);
+	report(name, "key_to_reply", (double) (sim_now_ns() - press) / SIM_NS_PER_MS, "ms");
+	// Sent to the top left sub-board by our move to its top left cell
+	report(name, "reply_legal", ultimate.to_move == BOARD_X && ultimate.cells[0][4] == 1, "bool");
+	report(name, "worst_pass", worst, "ms");
+
+	// With a pool too small to search, the AI must still answer with a legal
+	// move instead of searching forever.
+	u8 legal[ULTIMATE_MOVES];
+	int pool_ok = Mcts_Initialize(&mcts, mctsPool, MCTS_MIN_POOL - 1, 1);
+	Ultimate_Moves(&ultimate, legal);
+	UltimateMove(legal[0]);
+	int o_before = 0, o_after = 0;
+	for (int sub = 0; sub < BOARD_CELLS; sub++)
+	{
+		o_before += __builtin_popcount(ultimate.cells[1][sub]);
+	}
+	for (int i = 0; i < 100 && ultimate.to_move == BOARD_O; i++)
+	{
+		AiRun();
+	}
+	for (int sub = 0; sub < BOARD_CELLS; sub++)
+	{
+		o_after += __builtin_popcount(ultimate.cells[1][sub]);
+	}
+	report(name, "small_pool_refused", !pool_ok && Mcts_BestMove(&mcts) == -1, "bool");
+	report(name, "small_pool_replies", ultimate.to_move == BOARD_X && o_after == o_before + 1, "bool");
+	singlePlayer = 0;
+	ultimateMode = 0;
+}
+
+static const Bench benches[] = {
+	{ "ble_connect", bench_ble_connect },
+	{ "ble_short_address", bench_ble_short_address },
+	{ "ble_connect_timeout", bench_ble_connect_timeout },
+	{ "ble_connect_refused", bench_ble_connect_refused },
+	{ "ble_cmd_session", bench_ble_cmd_session },
+	{ "ble_cmd_disabled", bench_ble_cmd_disabled },
+	{ "ble_tx", bench_ble_tx },
+	{ "ble_tx_segments", bench_ble_tx_segments },
+	{ "ble_rx_burst", bench_ble_rx_burst },
+	{ "ble_rx_burst_irq", bench_ble_rx_burst_irq },
+	{ "ble_move_link", bench_ble_move_link },
+	{ "ble_status_in_data", bench_ble_status_in_data },
+	{ "ble_percent_tail", bench_ble_percent_tail },
+	{ "ble_read_pending", bench_ble_read_pending },
+	{ "ble_tokenizer", bench_ble_tokenizer },
+	{ "kypd_burst", bench_kypd_burst },
+	{ "kypd_burst_irq", bench_kypd_burst_irq },
+	{ "key_to_pixels", bench_key_to_pixels },
+	{ "game_over_reset", bench_game_over_reset },
+	{ "board_win_table", bench_board_win_table },
+	{ "engine_cross_check", bench_engine_cross_check },
+	{ "engine_check_cost", bench_engine_check_cost },
+	{ "perfect_play", bench_perfect_play },
+	{ "move_log_ring", bench_move_log_ring },
+	{ "move_log_replay", bench_move_log_replay },
+	{ "game_tree", bench_game_tree },
+	{ "game_loop", bench_game_loop },
+	{ "latency", bench_latency },
+	{ "ble_link_recovery", bench_ble_link_recovery },
+	{ "ble_peer_roles", bench_ble_peer_roles },
+	{ "ble_hub", bench_ble_hub },
+	{ "spectators", bench_spectators },
+	{ "single_player", bench_single_player },
+	{ "ultimate_rules", bench_ultimate_rules },
+	{ "mcts_throughput", bench_mcts_throughput },
+	{ "mcts_vs_random", bench_mcts_vs_random },
+	{ "ultimate_game_loop", bench_ultimate_game_loop },
+};
+
+int main(int argc, char **argv)
+{
+	const char *filter = argc > 1 ? argv[1] : "";
+
+	for (unsigned i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+	{
+		if (strncmp(benches[i].name, filter, strlen(filter)) != 0)
+		{
+			continue;
+		}
+		sim_reset();
+		Timebase_Initialize();
+		benches[i].run(benches[i].name);
+	}
+	return 0;
+}
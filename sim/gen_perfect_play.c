@@ -0,0 +1,170 @@
+/*
+ * gen_perfect_play.c
+ *
+ *  Writes PerfectPlayTable.c: the best move in every canonical 3x3 position
+ *  that can come up in a game and is not yet decided (see PerfectPlay.h).
+ *
+ *  Usage: gen_perfect_play > ../PerfectPlayTable.c	(or make -C sim perfect_play)
+ *
+ *  Positions are solved by negamax over the whole game. A win scores
+ *  1 + the empty cells left, so a quicker win beats a slower one and a loss
+ *  is put off as long as possible; a draw scores 0. Among equal moves the
+ *  lowest cell of the canonical position is taken.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Board.h"
+#include "PerfectPlay.h"
+
+#define KEYS 19683		// 3^9
+#define UNSOLVED 127
+
+// PerfectPlay_BestMove is linked in but not used; the table it searches is
+// the one being written.
+const u16 PerfectPlay_Keys[1];
+const u8 PerfectPlay_Moves[1];
+const int PerfectPlay_Entries = 0;
+
+static signed char solved[KEYS];		// Score by raw key, or UNSOLVED
+static u8 best_move[KEYS];				// By canonical key; 0xFF if not in the table
+static int entries = 0;
+
+static int raw_key(u16 mover, u16 opponent)
+{
+	int key = 0, p = 1;
+	for (int cell = 0; cell < BOARD_CELLS; cell++, p *= 3)
+	{
+		key += (mover >> cell & 1) * p + (opponent >> cell & 1) * 2 * p;
+	}
+	return key;
+}
+
+static int empties(u16 mover, u16 opponent)
+{
+	return BOARD_CELLS - __builtin_popcount(mover | opponent);
+}
+
+// Score of the position for the side to move.
+static int solve(u16 mover, u16 opponent)
+{
+	int key = raw_key(mover, opponent);
+
+	if (solved[key] != UNSOLVED)
+	{
+		return solved[key];
+	}
+
+	int best;
+	if (BOARD_IS_WIN(opponent))
+	{
+		best = -(1 + empties(mover, opponent));
+	}
+	else if ((mover | opponent) == BOARD_FULL_MASK)
+	{
+		best = 0;
+	}
+	else
+	{
+		best = -100;
+		for (int cell = 0; cell < BOARD_CELLS; cell++)
+		{
+			if (!((mover | opponent) & BOARD_CELL_BIT(cell)))
+			{
+				int s = -solve(opponent, mover | BOARD_CELL_BIT(cell));
+				best = s > best ? s : best;
+			}
+		}
+	}
+	solved[key] = best;
+	return best;
+}
+
+// Best move of the position, lowest cell on ties.
+static int choose(u16 mover, u16 opponent)
+{
+	int best = -100, move = -1;
+
+	for (int cell = 0; cell < BOARD_CELLS; cell++)
+	{
+		if (!((mover | opponent) & BOARD_CELL_BIT(cell)))
+		{
+			int s = -solve(opponent, mover | BOARD_CELL_BIT(cell));
+			if (s > best)
+			{
+				best = s;
+				move = cell;
+			}
+		}
+	}
+	return move;
+}
+
+// Visits every position of the game from here and records the undecided
+// ones under their canonical key.
+static void visit(u16 mover, u16 opponent)
+{
+	if (BOARD_IS_WIN(opponent) || (mover | opponent) == BOARD_FULL_MASK)
+	{
+		return;
+	}
+
+	int symmetry;
+	u16 key = PerfectPlay_Key(mover, opponent, &symmetry);
+	if (best_move[key] != 0xFF)
+	{
+		return;
+	}
+
+	// Solve the canonical position itself, so the move is in its cells.
+	u16 cm = 0, co = 0;
+	for (int cell = 0; cell < BOARD_CELLS; cell++)
+	{
+		cm |= (mover >> cell & 1) << PerfectPlay_MapCell(symmetry, cell);
+		co |= (opponent >> cell & 1) << PerfectPlay_MapCell(symmetry, cell);
+	}
+	best_move[key] = choose(cm, co);
+	entries++;
+
+	for (int cell = 0; cell < BOARD_CELLS; cell++)
+	{
+		if (!((mover | opponent) & BOARD_CELL_BIT(cell)))
+		{
+			visit(opponent, mover | BOARD_CELL_BIT(cell));
+		}
+	}
+}
+
+int main()
+{
+	memset(solved, UNSOLVED, sizeof(solved));
+	memset(best_move, 0xFF, sizeof(best_move));
+	visit(0, 0);
+
+	printf("/*\n * PerfectPlayTable.c\n *\n"
+			" *  Generated by sim/gen_perfect_play.c (make -C sim perfect_play); do not edit.\n */\n\n"
+			"#include \"PerfectPlay.h\"\n\n");
+	printf("const int PerfectPlay_Entries = %d;\n\n", entries);
+
+	printf("const u16 PerfectPlay_Keys[%d] = {", entries);
+	for (int key = 0, n = 0; key < KEYS; key++)
+	{
+		if (best_move[key] != 0xFF)
+		{
+			printf("%s%5d,", n++ % 10 == 0 ? "\n\t" : " ", key);
+		}
+	}
+	printf("\n};\n\n");
+
+	printf("const u8 PerfectPlay_Moves[%d] = {", entries);
+	for (int key = 0, n = 0; key < KEYS; key++)
+	{
+		if (best_move[key] != 0xFF)
+		{
+			printf("%s%d,", n++ % 20 == 0 ? "\n\t" : " ", best_move[key]);
+		}
+	}
+	printf("\n};\n");
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * gen_sprites.c
+ *
+ *  Writes TileSprites.c: the X and O glyphs of a board cell, rasterised with
+ *  the framebuffer's own line and circle code and packed one u32 per row.
+ *
+ *  Usage: gen_sprites > ../TileSprites.c	(or make -C sim sprites)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "OledFb.h"
+#include "TileSprites.h"
+
+static OledFb fb;
+
+// Packs the inked pixels in the cell at the top left of the framebuffer and
+// prints them as a sprite trimmed to its bounding box.
+static void emit(const char *name)
+{
+	int c1 = TILESPRITE_CELL_WIDTH, r1 = TILESPRITE_CELL_HEIGHT, c2 = -1, r2 = -1;
+
+	for (int r = 0; r < TILESPRITE_CELL_HEIGHT; r++)
+	{
+		for (int c = 0; c < TILESPRITE_CELL_WIDTH; c++)
+		{
+			if (OledFb_GetPixel(&fb, c, r) != 0)
+			{
+				c1 = c < c1 ? c : c1;
+				r1 = r < r1 ? r : r1;
+				c2 = c > c2 ? c : c2;
+				r2 = r > r2 ? r : r2;
+			}
+		}
+	}
+
+	printf("static const u32 %s_rows[%d] = {\n", name, r2 - r1 + 1);
+	for (int r = r1; r <= r2; r++)
+	{
+		u32 bits = 0;
+		for (int c = c1; c <= c2; c++)
+		{
+			if (OledFb_GetPixel(&fb, c, r) != 0)
+			{
+				bits |= (u32) 1 << (c - c1);
+			}
+		}
+		printf("\t0x%08X,\n", (unsigned) bits);
+	}
+	printf("};\n\n");
+	printf("const OledFb_Sprite %s = { %d, %d, %d, %d, %s_rows };\n",
+			name, c1, r1, c2 - c1 + 1, r2 - r1 + 1, name);
+}
+
+int main()
+{
+	printf("/*\n * TileSprites.c\n *\n"
+			" *  Generated by sim/gen_sprites.c (make -C sim sprites); do not edit.\n */\n\n"
+			"#include \"TileSprites.h\"\n\n");
+
+	// X: the two diagonals of the cell, 6 pixels in from the sides and 4 from
+	// the top and bottom.
+	memset(fb.pixels, 0, sizeof(fb.pixels));
+	OledFb_DrawLine(&fb, 6, 4, 26, 17, 0xFFFF);
+	OledFb_DrawLine(&fb, 6, 17, 26, 4, 0xFFFF);
+	emit("TileSprite_X");
+	printf("\n");
+
+	// O: a circle of radius 8 around the middle of the cell.
+	memset(fb.pixels, 0, sizeof(fb.pixels));
+	OledFb_DrawCircle(&fb, 16, 10, 8, 0xFFFF);
+	emit("TileSprite_O");
+
+	return 0;
+}
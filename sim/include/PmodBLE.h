@@ -0,0 +1,26 @@
+/*
+ * PmodBLE.h
+ *
+ *  Host simulator stand-in for the Digilent PmodBLE driver. The calls are
+ *  backed by the simulated RN4871 in sim_ble.c.
+ */
+
+#ifndef SIM_PMODBLE_H_
+#define SIM_PMODBLE_H_
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xuartns550.h"
+
+typedef struct PmodBLE {
+	u32 GPIO_addr;
+	XUartNs550 BLEUart;
+} PmodBLE;
+
+void BLE_Begin(PmodBLE *InstancePtr, u32 GPIO_Address, u32 UART_Address, u32 AXI_ClockFreq, u32 UART_Baud);
+void BLE_End(PmodBLE *InstancePtr);
+int BLE_SendData(PmodBLE *InstancePtr, u8 *Data, int nData);
+int BLE_RecvData(PmodBLE *InstancePtr, u8 *Data, int nData);
+int BLE_IsConnected(PmodBLE *InstancePtr);
+
+#endif /* SIM_PMODBLE_H_ */
@@ -0,0 +1,29 @@
+/*
+ * PmodKYPD.h
+ *
+ *  Host simulator stand-in for the Digilent PmodKYPD driver. Key states come
+ *  from the press schedule in sim_kypd.c.
+ */
+
+#ifndef SIM_PMODKYPD_H_
+#define SIM_PMODKYPD_H_
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_io.h"
+
+#define KYPD_NO_KEY 0
+#define KYPD_SINGLE_KEY 1
+#define KYPD_MULTI_KEY 2
+
+typedef struct PmodKYPD {
+	u32 GPIO_addr;
+	u8 keytable[16];
+} PmodKYPD;
+
+void KYPD_begin(PmodKYPD *InstancePtr, u32 GPIO_Address);
+void KYPD_loadKeyTable(PmodKYPD *InstancePtr, u8 keytable[16]);
+u16 KYPD_getKeyStates(PmodKYPD *InstancePtr);
+XStatus KYPD_getKeyPressed(PmodKYPD *InstancePtr, u16 KeyStates, u8 *cptr);
+
+#endif /* SIM_PMODKYPD_H_ */
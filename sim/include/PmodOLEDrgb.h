@@ -0,0 +1,44 @@
+/*
+ * PmodOLEDrgb.h
+ *
+ *  Host simulator stand-in for the Digilent PmodOLEDrgb driver. Drawing is
+ *  rasterised into a shadow of the SSD1331 GDDRAM in sim_oled.c and every
+ *  call is charged its SPI transaction cost on the virtual clock.
+ */
+
+#ifndef SIM_PMODOLEDRGB_H_
+#define SIM_PMODOLEDRGB_H_
+
+#include "xil_types.h"
+
+#define OLEDRGB_WIDTH 96
+#define OLEDRGB_HEIGHT 64
+#define OLEDRGB_CHARBYTES 8
+#define OLEDRGB_USERCHAR_MAX 0x20
+
+typedef struct PmodOLEDrgb {
+	u32 GPIO_addr;
+	u32 SPI_addr;
+	int xchOledCur;
+	int ychOledCur;
+	u16 m_FontColor;
+	u16 m_FontBkColor;
+	u8 rgbOledRgbFontUser[OLEDRGB_USERCHAR_MAX * OLEDRGB_CHARBYTES];
+} PmodOLEDrgb;
+
+void OLEDrgb_begin(PmodOLEDrgb *InstancePtr, u32 GPIO_Address, u32 SPI_Address);
+void OLEDrgb_end(PmodOLEDrgb *InstancePtr);
+void OLEDrgb_Clear(PmodOLEDrgb *InstancePtr);
+void OLEDrgb_DrawPixel(PmodOLEDrgb *InstancePtr, u8 c, u8 r, u16 pixelColor);
+void OLEDrgb_DrawLine(PmodOLEDrgb *InstancePtr, u8 c1, u8 r1, u8 c2, u8 r2, u16 lineColor);
+void OLEDrgb_DrawRectangle(PmodOLEDrgb *InstancePtr, u8 c1, u8 r1, u8 c2, u8 r2, u16 lineColor, u8 bFill, u16 fillColor);
+void OLEDrgb_DrawBitmap(PmodOLEDrgb *InstancePtr, u8 c1, u8 r1, u8 c2, u8 r2, u8 *pBmp);
+void OLEDrgb_SetCursor(PmodOLEDrgb *InstancePtr, int xch, int ych);
+void OLEDrgb_PutChar(PmodOLEDrgb *InstancePtr, char ch);
+void OLEDrgb_PutString(PmodOLEDrgb *InstancePtr, char *sz);
+void OLEDrgb_SetFontColor(PmodOLEDrgb *InstancePtr, u16 fontColor);
+void OLEDrgb_SetFontBkColor(PmodOLEDrgb *InstancePtr, u16 fontBkColor);
+void OLEDrgb_DefUserChar(PmodOLEDrgb *InstancePtr, char ch, u8 *pbDef);
+u16 OLEDrgb_BuildRGB(u8 R, u8 G, u8 B);
+
+#endif /* SIM_PMODOLEDRGB_H_ */
@@ -0,0 +1,16 @@
+/*
+ * sleep.h
+ *
+ *  Host simulator stand-in for the BSP sleep routines; both advance the
+ *  virtual clock instead of blocking.
+ */
+
+#ifndef SIM_SLEEP_H_
+#define SIM_SLEEP_H_
+
+#include "xil_types.h"
+
+int usleep(unsigned long useconds);
+unsigned sleep(unsigned int seconds);
+
+#endif /* SIM_SLEEP_H_ */
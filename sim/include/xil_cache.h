@@ -0,0 +1,15 @@
+/*
+ * xil_cache.h
+ *
+ *  Host simulator stand-in for the cache control routines (no-ops).
+ */
+
+#ifndef SIM_XIL_CACHE_H_
+#define SIM_XIL_CACHE_H_
+
+static inline void Xil_ICacheEnable(void) {}
+static inline void Xil_ICacheDisable(void) {}
+static inline void Xil_DCacheEnable(void) {}
+static inline void Xil_DCacheDisable(void) {}
+
+#endif /* SIM_XIL_CACHE_H_ */
@@ -0,0 +1,15 @@
+/*
+ * xil_io.h
+ *
+ *  Host simulator stand-in for memory-mapped register access.
+ */
+
+#ifndef SIM_XIL_IO_H_
+#define SIM_XIL_IO_H_
+
+#include "xil_types.h"
+
+void Xil_Out32(UINTPTR Addr, u32 Value);
+u32 Xil_In32(UINTPTR Addr);
+
+#endif /* SIM_XIL_IO_H_ */
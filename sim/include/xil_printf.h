@@ -0,0 +1,15 @@
+/*
+ * xil_printf.h
+ *
+ *  Host simulator stand-in for xil_printf. Output is charged to the virtual
+ *  clock at console baud rate, like the blocking UART on the board.
+ */
+
+#ifndef SIM_XIL_PRINTF_H_
+#define SIM_XIL_PRINTF_H_
+
+#include "xil_types.h"
+
+void xil_printf(const char *fmt, ...);
+
+#endif /* SIM_XIL_PRINTF_H_ */
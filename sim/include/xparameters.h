@@ -0,0 +1,34 @@
+/*
+ * xparameters.h
+ *
+ *  Host simulator hardware description. Base addresses only need to be
+ *  unique; the simulator looks devices up by them.
+ */
+
+#ifndef SIM_XPARAMETERS_H_
+#define SIM_XPARAMETERS_H_
+
+#define XPAR_CPU_M_AXI_DP_FREQ_HZ 100000000
+
+#define XPAR_PMODBLE_0_S_AXI_GPIO_BASEADDR 0x44A00000
+#define XPAR_PMODBLE_0_S_AXI_UART_BASEADDR 0x44A10000
+
+// Spare modules, for spectators
+#define XPAR_PMODBLE_1_S_AXI_GPIO_BASEADDR 0x44B00000
+#define XPAR_PMODBLE_1_S_AXI_UART_BASEADDR 0x44B10000
+#define XPAR_PMODBLE_2_S_AXI_GPIO_BASEADDR 0x44B20000
+#define XPAR_PMODBLE_2_S_AXI_UART_BASEADDR 0x44B30000
+
+#define XPAR_PMODKYPD_0_AXI_LITE_GPIO_BASEADDR 0x44A20000
+
+#define XPAR_PMODOLEDRGB_0_AXI_LITE_GPIO_BASEADDR 0x44A30000
+#define XPAR_PMODOLEDRGB_0_AXI_LITE_SPI_BASEADDR 0x44A40000
+
+#define XPAR_TMRCTR_0_BASEADDR 0x41C00000
+#define XPAR_TMRCTR_0_CLOCK_FREQ_HZ 100000000
+
+#define XPAR_AXI_UARTLITE_0_DEVICE_ID 0
+#define XPAR_AXI_UARTLITE_0_BASEADDR 0x40600000
+#define XPAR_AXI_UARTLITE_0_BAUDRATE 115200
+
+#endif /* SIM_XPARAMETERS_H_ */
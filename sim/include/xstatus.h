@@ -0,0 +1,19 @@
+/*
+ * xstatus.h
+ *
+ *  Host simulator stand-in for the Xilinx BSP status codes.
+ */
+
+#ifndef SIM_XSTATUS_H_
+#define SIM_XSTATUS_H_
+
+#include "xil_types.h"
+
+typedef int XStatus;
+
+#define XST_SUCCESS 0L
+#define XST_FAILURE 1L
+#define XST_DEVICE_NOT_FOUND 2L
+#define XST_INVALID_PARAM 15L
+
+#endif /* SIM_XSTATUS_H_ */
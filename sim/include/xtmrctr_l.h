@@ -0,0 +1,49 @@
+/*
+ * xtmrctr_l.h
+ *
+ *  Host simulator stand-in for the AXI Timer low-level driver. The counter
+ *  register of timer 0 reads the virtual clock; timer 1 can raise periodic
+ *  interrupts (see sim_bsp.c).
+ */
+
+#ifndef SIM_XTMRCTR_L_H_
+#define SIM_XTMRCTR_L_H_
+
+#include "xil_types.h"
+#include "xil_io.h"
+
+#define XTC_TIMER_COUNTER_OFFSET 16
+
+#define XTC_TCSR_OFFSET 0
+#define XTC_TLR_OFFSET 4
+#define XTC_TCR_OFFSET 8
+
+#define XTC_CSR_DOWN_COUNT_MASK 0x00000002
+#define XTC_CSR_AUTO_RELOAD_MASK 0x00000010
+#define XTC_CSR_LOAD_MASK 0x00000020
+#define XTC_CSR_ENABLE_INT_MASK 0x00000040
+#define XTC_CSR_ENABLE_TMR_MASK 0x00000080
+#define XTC_CSR_INT_OCCURED_MASK 0x00000100
+
+#define XTmrCtr_ReadReg(BaseAddress, TmrCtrNumber, RegOffset) \
+	Xil_In32((BaseAddress) + (TmrCtrNumber) * XTC_TIMER_COUNTER_OFFSET + (RegOffset))
+
+#define XTmrCtr_WriteReg(BaseAddress, TmrCtrNumber, RegOffset, ValueToWrite) \
+	Xil_Out32((BaseAddress) + (TmrCtrNumber) * XTC_TIMER_COUNTER_OFFSET + (RegOffset), (ValueToWrite))
+
+#define XTmrCtr_SetControlStatusReg(BaseAddress, TmrCtrNumber, RegisterValue) \
+	XTmrCtr_WriteReg((BaseAddress), (TmrCtrNumber), XTC_TCSR_OFFSET, (RegisterValue))
+
+#define XTmrCtr_GetControlStatusReg(BaseAddress, TmrCtrNumber) \
+	XTmrCtr_ReadReg((BaseAddress), (TmrCtrNumber), XTC_TCSR_OFFSET)
+
+#define XTmrCtr_SetLoadReg(BaseAddress, TmrCtrNumber, RegisterValue) \
+	XTmrCtr_WriteReg((BaseAddress), (TmrCtrNumber), XTC_TLR_OFFSET, (RegisterValue))
+
+#define XTmrCtr_LoadTimerCounterReg(BaseAddress, TmrCtrNumber) \
+	XTmrCtr_WriteReg((BaseAddress), (TmrCtrNumber), XTC_TCSR_OFFSET, XTC_CSR_LOAD_MASK)
+
+#define XTmrCtr_GetTimerCounterReg(BaseAddress, TmrCtrNumber) \
+	XTmrCtr_ReadReg((BaseAddress), (TmrCtrNumber), XTC_TCR_OFFSET)
+
+#endif /* SIM_XTMRCTR_L_H_ */
@@ -0,0 +1,22 @@
+/*
+ * xuartlite.h
+ *
+ *  Host simulator stand-in for the AXI UART Lite driver (system console).
+ */
+
+#ifndef SIM_XUARTLITE_H_
+#define SIM_XUARTLITE_H_
+
+#include "xil_types.h"
+#include "xstatus.h"
+
+typedef struct {
+	UINTPTR RegBaseAddress;
+	u32 IsReady;
+} XUartLite;
+
+int XUartLite_Initialize(XUartLite *InstancePtr, u16 DeviceId);
+unsigned int XUartLite_Send(XUartLite *InstancePtr, u8 *DataBufferPtr, unsigned int NumBytes);
+unsigned int XUartLite_Recv(XUartLite *InstancePtr, u8 *DataBufferPtr, unsigned int NumBytes);
+
+#endif /* SIM_XUARTLITE_H_ */
@@ -0,0 +1,26 @@
+/*
+ * xuartns550.h
+ *
+ *  Host simulator stand-in for the AXI UART 16550 driver used inside the
+ *  PmodBLE IP. Only the pieces the PmodBLE driver touches are modelled.
+ */
+
+#ifndef SIM_XUARTNS550_H_
+#define SIM_XUARTNS550_H_
+
+#include "xil_types.h"
+#include "xstatus.h"
+
+typedef struct {
+	UINTPTR BaseAddress;
+	u32 IsReady;
+	u16 Options;
+} XUartNs550;
+
+#define XUN_OPTION_DATA_INTR 0x0004
+#define XUN_OPTION_FIFOS_ENABLE 0x0040
+
+int XUartNs550_SetOptions(XUartNs550 *InstancePtr, u16 Options);
+u16 XUartNs550_GetOptions(XUartNs550 *InstancePtr);
+
+#endif /* SIM_XUARTNS550_H_ */
@@ -0,0 +1,167 @@
+/*
+ * sim.h
+ *
+ *  Control interface of the host-side hardware simulator.
+ *
+ *  The firmware sources are linked unchanged against the stand-in BSP and
+ *  Digilent headers in sim/include. Every simulated call charges its cost to
+ *  a virtual clock, so busy loops, usleep and peripheral traffic all show up
+ *  as elapsed time that the benchmarks can report.
+ */
+
+#ifndef SIM_SIM_H_
+#define SIM_SIM_H_
+
+#include "xil_types.h"
+#include "PmodBLE.h"
+
+// *********** Virtual Clock *********** //
+#define SIM_NS_PER_US 1000ULL
+#define SIM_NS_PER_MS 1000000ULL
+#define SIM_NS_PER_S  1000000000ULL
+
+// Current virtual time.
+u64 sim_now_ns();
+
+// Charges ns of time and runs every device event that falls due.
+void sim_advance_ns(u64 ns);
+
+// Advances until cond(arg) returns non-zero or limit_ns elapses.
+// Returns 1 if the condition was met.
+int sim_run_until(int (*cond)(void *arg), void *arg, u64 limit_ns);
+
+// Resets the clock, removes all devices and restores the default configs.
+void sim_reset();
+
+// Device models register a hook that reports their next pending event
+// (or ~0 if none) and a hook that processes events up to a time.
+typedef struct SimSource {
+	u64 (*next_event_ns)(void *ctx);
+	void (*process)(void *ctx, u64 now_ns);
+	void *ctx;
+} SimSource;
+
+void sim_add_source(SimSource source);
+
+// *********** Console (xil_printf) *********** //
+typedef struct SimConsoleConfig {
+	u32 baud;		// Console baud rate; each character blocks for 10 bit times.
+	int echo;		// Non-zero to copy console output to stdout.
+} SimConsoleConfig;
+
+typedef struct SimConsoleStats {
+	u64 chars;
+	u64 calls;
+} SimConsoleStats;
+
+extern SimConsoleConfig sim_console_config;
+extern SimConsoleStats sim_console_stats;
+
+// *********** PmodBLE / RN4871 *********** //
+#define SIM_BLE_ADDRESS_LEN 12
+#define SIM_BLE_FIFO_DEPTH 16
+
+typedef struct SimBleConfig {
+	u32 baud;					// UART baud rate between the FPGA and the RN4871.
+	u32 call_ns;				// CPU cost of one BLE_SendData / BLE_RecvData call.
+	u32 cmd_guard_us;			// Silence required before "$$$" is accepted.
+	u32 cmd_enter_delay_us;		// Delay before the "CMD> " prompt.
+	u32 cmd_response_delay_us;	// Delay before answering a command line.
+	u32 connect_delay_us;		// Delay between "Trying" and "%CONNECT,...%".
+	u32 disconnect_delay_us;	// Delay between "AOK" and "%DISCONNECT%".
+	u32 link_latency_us;		// Air latency of data mode bytes to a linked module.
+	int cmd_prompt_disabled;	// Answer "$$$" with "CMD" instead of "CMD> ".
+	int connect_fail;			// Answer "C,0," with "%ERR_CONN%".
+	char address[SIM_BLE_ADDRESS_LEN + 1];	// This module's address.
+} SimBleConfig;
+
+typedef struct SimBleStats {
+	u64 send_calls;
+	u64 recv_calls;
+	u64 tx_bytes;			// Bytes accepted into the TX FIFO.
+	u64 rx_bytes;			// Bytes handed to the CPU.
+	u64 rx_overruns;		// Bytes dropped because the RX FIFO was full.
+	u64 peer_bytes;			// Data mode bytes delivered to the peer.
+	u64 last_tx_done_ns;	// Time the last TX byte left the wire.
+	u64 cmd_entries;		// Times command mode was entered.
+	u64 cmd_lines;			// Command lines run, "---" included.
+} SimBleStats;
+
+typedef struct SimBle SimBle;
+
+// Defaults applied to modules created by BLE_Begin.
+extern SimBleConfig sim_ble_default_config;
+
+// Creates a module behind the given UART base address ahead of BLE_Begin.
+SimBle *sim_ble_create(u32 uart_base, const SimBleConfig *config);
+
+// Module attached to a UART base address, or NULL.
+SimBle *sim_ble_find(u32 uart_base);
+SimBle *sim_ble_of(PmodBLE *InstancePtr);
+
+SimBleConfig *sim_ble_config(SimBle *ble);
+SimBleStats *sim_ble_stats(SimBle *ble);
+int sim_ble_in_command_mode(SimBle *ble);
+int sim_ble_is_connected(SimBle *ble);
+int sim_ble_tx_idle(SimBle *ble);
+
+// Connects the handler for the module's UART interrupt, as the application
+// would on the interrupt controller. It is raised while the receive FIFO
+// holds data and XUN_OPTION_DATA_INTR is set.
+void sim_ble_connect_irq(SimBle *ble, void (*handler)(void *ref), void *ref);
+
+// Links two modules; "C,0,<addr>" on one connects to the other and data
+// mode bytes are carried across.
+void sim_ble_link(SimBle *a, SimBle *b);
+
+// Bytes from an unlinked (scripted) peer, starting delay_us from now.
+void sim_ble_peer_send(SimBle *ble, const u8 *data, int len, u32 delay_us);
+
+// Data mode bytes sent to an unlinked peer are captured here.
+int sim_ble_peer_take(SimBle *ble, u8 *buf, int max);
+
+// An unlinked peer dials us, connecting delay_us from now if we are still
+// advertising then.
+void sim_ble_peer_connect(SimBle *ble, u32 delay_us);
+
+// Drops the link as if the peer went away ("%DISCONNECT%").
+void sim_ble_drop_link(SimBle *ble, u32 delay_us);
+
+// *********** AXI Timer *********** //
+// Calls handler, as the interrupt controller would, each time timer 1 raises
+// its interrupt (see KeypadScan_StartTimer).
+void sim_timer_connect_irq(void (*handler)(void *ref), void *ref);
+
+// *********** PmodKYPD *********** //
+typedef struct SimKypdConfig {
+	u32 scan_ns;	// Cost of one KYPD_getKeyStates call.
+	u32 bounce_us;	// Contact chatter at the start of a press.
+} SimKypdConfig;
+
+extern SimKypdConfig sim_kypd_config;
+
+// Schedules a press of key (a keytable character) at at_ns for hold_us.
+void sim_kypd_press(char key, u64 at_ns, u32 hold_us);
+
+// *********** PmodOLEDrgb *********** //
+typedef struct SimOledConfig {
+	u32 spi_hz;			// SPI clock.
+	u32 txn_ns;			// Fixed cost of one SPI transaction (CS, driver).
+	u32 clear_ns;		// SSD1331 busy time after a clear window command.
+	u32 fill_ns_per_px;	// SSD1331 busy time per pixel for line/rect commands.
+} SimOledConfig;
+
+typedef struct SimOledStats {
+	u64 transactions;
+	u64 bytes;
+	u64 pixels;			// GDDRAM pixels written.
+	u64 busy_ns;		// Time spent in OLED calls.
+} SimOledStats;
+
+extern SimOledConfig sim_oled_config;
+extern SimOledStats sim_oled_stats;
+
+// Pixel in the simulated GDDRAM.
+u16 sim_oled_pixel(int c, int r);
+
+#endif /* SIM_SIM_H_ */
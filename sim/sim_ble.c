@@ -0,0 +1,611 @@
+/*
+ * sim_ble.c
+ *
+ *  Simulated PmodBLE: the FPGA side UART FIFOs, the wire at the configured
+ *  baud rate, and an RN4871 that understands the handful of commands the
+ *  driver uses ($$$, ---, D, A, Y, C,0,<addr> and K,1).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_priv.h"
+
+#define SIM_BLE_MAX_DEVICES 8
+#define SIM_BLE_WIRE_BYTES 8192
+#define SIM_BLE_CAPTURE_BYTES 8192
+#define SIM_BLE_LINE_BYTES 64
+#define SIM_BLE_MAX_ACTIONS 8
+
+// Deferred module state changes.
+#define SIM_ACT_CONNECTED 1
+#define SIM_ACT_DISCONNECTED 2
+#define SIM_ACT_DIALED 3		// An unlinked peer connects to us.
+
+typedef struct SimWireByte {
+	u8 byte;
+	u64 not_before_ns;
+} SimWireByte;
+
+typedef struct SimAction {
+	int kind;
+	u64 at_ns;
+	SimBle *peer;
+} SimAction;
+
+struct SimBle {
+	u32 uart_base;
+	SimBleConfig cfg;
+	SimBleStats stats;
+
+	// FPGA -> module
+	u8 tx_fifo[SIM_BLE_FIFO_DEPTH];
+	int tx_head;
+	int tx_count;
+	u64 tx_done_ns;			// Completion time of the byte at tx_head.
+
+	// module -> FPGA
+	SimWireByte wire[SIM_BLE_WIRE_BYTES];
+	int wire_head;
+	int wire_count;
+	u64 wire_last_ns;		// Arrival time of the previous wire byte.
+	u8 rx_fifo[SIM_BLE_FIFO_DEPTH];
+	int rx_head;
+	int rx_count;
+
+	// UART interrupt
+	u16 uart_options;
+	void (*irq_handler)(void *ref);
+	void *irq_ref;
+
+	// RN4871
+	int cmd_mode;
+	int dollars;			// "$" characters of a pending "$$$".
+	u64 last_host_byte_ns;
+	char line[SIM_BLE_LINE_BYTES];
+	int line_len;
+	int advertising;
+	int connected;
+	SimBle *link;			// Linked module, or NULL for a scripted peer.
+	SimBle *connected_to;
+	SimAction actions[SIM_BLE_MAX_ACTIONS];
+
+	// Scripted peer capture
+	u8 capture[SIM_BLE_CAPTURE_BYTES];
+	int capture_count;
+};
+
+SimBleConfig sim_ble_default_config;
+
+static SimBle *devices[SIM_BLE_MAX_DEVICES];
+static int num_devices = 0;
+
+static const SimBleConfig factory_config = {
+	.baud = 115200,
+	.call_ns = 1500,
+	.cmd_guard_us = 100000,
+	.cmd_enter_delay_us = 2000,
+	.cmd_response_delay_us = 1000,
+	.connect_delay_us = 150000,
+	.disconnect_delay_us = 20000,
+	.link_latency_us = 7500,
+	.cmd_prompt_disabled = 0,
+	.connect_fail = 0,
+	.address = "801F12B5C279",
+};
+
+void sim_ble_reset()
+{
+	for (int i = 0; i < num_devices; i++)
+	{
+		free(devices[i]);
+		devices[i] = NULL;
+	}
+	num_devices = 0;
+	sim_ble_default_config = factory_config;
+}
+
+// *********** Wire Helpers *********** //
+static u64 char_ns(SimBle *ble)
+{
+	return sim_uart_char_ns(ble->cfg.baud);
+}
+
+static void wire_push(SimBle *ble, const u8 *data, int len, u64 not_before_ns)
+{
+	for (int i = 0; i < len && ble->wire_count < SIM_BLE_WIRE_BYTES; i++)
+	{
+		int idx = (ble->wire_head + ble->wire_count) % SIM_BLE_WIRE_BYTES;
+		ble->wire[idx].byte = data[i];
+		ble->wire[idx].not_before_ns = not_before_ns;
+		ble->wire_count++;
+	}
+}
+
+static void respond(SimBle *ble, const char *text, u64 delay_ns)
+{
+	wire_push(ble, (const u8 *) text, strlen(text), sim_now_ns() + delay_ns);
+}
+
+static u64 wire_next_ns(SimBle *ble)
+{
+	if (ble->wire_count == 0)
+	{
+		return SIM_NEVER;
+	}
+
+	u64 start = ble->wire[ble->wire_head].not_before_ns;
+	if (ble->wire_last_ns > start)
+	{
+		start = ble->wire_last_ns;
+	}
+	return start + char_ns(ble);
+}
+
+static void schedule(SimBle *ble, int kind, u64 at_ns, SimBle *peer)
+{
+	for (int i = 0; i < SIM_BLE_MAX_ACTIONS; i++)
+	{
+		if (ble->actions[i].kind == 0)
+		{
+			ble->actions[i].kind = kind;
+			ble->actions[i].at_ns = at_ns;
+			ble->actions[i].peer = peer;
+			return;
+		}
+	}
+}
+
+// *********** Data Mode *********** //
+static void deliver_to_peer(SimBle *ble, u8 byte)
+{
+	if (!ble->connected)
+	{
+		return;
+	}
+
+	ble->stats.peer_bytes++;
+	if (ble->connected_to != NULL)
+	{
+		wire_push(ble->connected_to, &byte, 1, sim_now_ns() + ble->cfg.link_latency_us * SIM_NS_PER_US);
+	}
+	else if (ble->capture_count < SIM_BLE_CAPTURE_BYTES)
+	{
+		ble->capture[ble->capture_count++] = byte;
+	}
+}
+
+// *********** Command Mode *********** //
+static void handle_connect(SimBle *ble, const char *address)
+{
+	u64 now = sim_now_ns();
+	u64 reply_ns = ble->cfg.cmd_response_delay_us * SIM_NS_PER_US;
+	u64 done_ns = reply_ns + ble->cfg.connect_delay_us * SIM_NS_PER_US;
+	char status[32];
+	SimBle *target = NULL;
+	int ok;
+
+	if (strlen(address) != SIM_BLE_ADDRESS_LEN || ble->connected)
+	{
+		respond(ble, "ERR\r\n", reply_ns);
+		return;
+	}
+
+	if (ble->link != NULL)
+	{
+		target = ble->link;
+		ok = strcmp(target->cfg.address, address) == 0 && target->advertising && !target->connected;
+	}
+	else
+	{
+		ok = !ble->cfg.connect_fail;
+	}
+
+	respond(ble, "Trying\r\n", reply_ns);
+	if (ok)
+	{
+		snprintf(status, sizeof(status), "%%CONNECT,0,%s%%", address);
+		respond(ble, status, done_ns);
+		schedule(ble, SIM_ACT_CONNECTED, now + done_ns, target);
+	}
+	else
+	{
+		respond(ble, "%ERR_CONN%", done_ns);
+	}
+}
+
+static void handle_line(SimBle *ble)
+{
+	u64 reply_ns = ble->cfg.cmd_response_delay_us * SIM_NS_PER_US;
+	char text[128];
+
+	ble->line[ble->line_len] = '\0';
+	ble->line_len = 0;
+	ble->stats.cmd_lines++;
+
+	if (strcmp(ble->line, "---") == 0)
+	{
+		ble->cmd_mode = 0;
+		respond(ble, "END\r\n", reply_ns);
+	}
+	else if (strcmp(ble->line, "D") == 0)
+	{
+		snprintf(text, sizeof(text), "BTA=%s\r\nName=RN4871-%s\r\nConnected=%s\r\n",
+				ble->cfg.address, ble->cfg.address + 8, ble->connected ? "yes" : "no");
+		respond(ble, text, reply_ns);
+	}
+	else if (strcmp(ble->line, "A") == 0)
+	{
+		ble->advertising = !ble->connected;
+		respond(ble, ble->connected ? "ERR\r\n" : "AOK\r\n", reply_ns);
+	}
+	else if (strcmp(ble->line, "Y") == 0)
+	{
+		ble->advertising = 0;
+		respond(ble, "AOK\r\n", reply_ns);
+	}
+	else if (strncmp(ble->line, "C,0,", 4) == 0 || strncmp(ble->line, "C,1,", 4) == 0)
+	{
+		handle_connect(ble, ble->line + 4);
+	}
+	else if (strcmp(ble->line, "K,1") == 0)
+	{
+		if (ble->connected)
+		{
+			respond(ble, "AOK\r\n", reply_ns);
+			sim_ble_drop_link(ble, ble->cfg.cmd_response_delay_us + ble->cfg.disconnect_delay_us);
+		}
+		else
+		{
+			respond(ble, "ERR\r\n", reply_ns);
+		}
+	}
+	else
+	{
+		respond(ble, "ERR\r\n", reply_ns);
+	}
+}
+
+static void module_receive(SimBle *ble, u8 byte, u64 now)
+{
+	u64 quiet_ns = now - ble->last_host_byte_ns;
+
+	if (ble->cmd_mode)
+	{
+		if (byte == '\r')
+		{
+			handle_line(ble);
+		}
+		else if (byte != '\n' && ble->line_len < SIM_BLE_LINE_BYTES - 1)
+		{
+			ble->line[ble->line_len++] = byte;
+		}
+	}
+	else if (byte == '$' && (ble->dollars > 0 || ble->last_host_byte_ns == 0
+			|| quiet_ns >= (u64) ble->cfg.cmd_guard_us * SIM_NS_PER_US + char_ns(ble)))
+	{
+		if (++ble->dollars == 3)
+		{
+			ble->dollars = 0;
+			ble->cmd_mode = 1;
+			ble->line_len = 0;
+			ble->stats.cmd_entries++;
+			respond(ble, ble->cfg.cmd_prompt_disabled ? "CMD" : "CMD> ",
+					ble->cfg.cmd_enter_delay_us * SIM_NS_PER_US);
+		}
+	}
+	else
+	{
+		// A broken "$$$" sequence is ordinary data.
+		for (; ble->dollars > 0; ble->dollars--)
+		{
+			deliver_to_peer(ble, '$');
+		}
+		deliver_to_peer(ble, byte);
+	}
+
+	ble->last_host_byte_ns = now;
+}
+
+// *********** Event Source *********** //
+static u64 ble_next_event_ns(void *ctx)
+{
+	SimBle *ble = ctx;
+	u64 next = wire_next_ns(ble);
+
+	if (ble->tx_count > 0 && ble->tx_done_ns < next)
+	{
+		next = ble->tx_done_ns;
+	}
+	for (int i = 0; i < SIM_BLE_MAX_ACTIONS; i++)
+	{
+		if (ble->actions[i].kind != 0 && ble->actions[i].at_ns < next)
+		{
+			next = ble->actions[i].at_ns;
+		}
+	}
+	return next;
+}
+
+static void ble_process(void *ctx, u64 now)
+{
+	SimBle *ble = ctx;
+
+	if (ble->tx_count > 0 && ble->tx_done_ns <= now)
+	{
+		u8 byte = ble->tx_fifo[ble->tx_head];
+		ble->tx_head = (ble->tx_head + 1) % SIM_BLE_FIFO_DEPTH;
+		ble->tx_count--;
+		ble->stats.last_tx_done_ns = ble->tx_done_ns;
+		if (ble->tx_count > 0)
+		{
+			ble->tx_done_ns += char_ns(ble);
+		}
+		module_receive(ble, byte, now);
+	}
+
+	if (wire_next_ns(ble) <= now)
+	{
+		ble->wire_last_ns = wire_next_ns(ble);
+		if (ble->rx_count < SIM_BLE_FIFO_DEPTH)
+		{
+			ble->rx_fifo[(ble->rx_head + ble->rx_count) % SIM_BLE_FIFO_DEPTH] = ble->wire[ble->wire_head].byte;
+			ble->rx_count++;
+		}
+		else
+		{
+			ble->stats.rx_overruns++;
+		}
+		ble->wire_head = (ble->wire_head + 1) % SIM_BLE_WIRE_BYTES;
+		ble->wire_count--;
+
+		if ((ble->uart_options & XUN_OPTION_DATA_INTR) && ble->irq_handler != NULL && ble->rx_count > 0)
+		{
+			ble->irq_handler(ble->irq_ref);
+		}
+	}
+
+	for (int i = 0; i < SIM_BLE_MAX_ACTIONS; i++)
+	{
+		SimAction *act = &ble->actions[i];
+		if (act->kind == 0 || act->at_ns > now)
+		{
+			continue;
+		}
+
+		if (act->kind == SIM_ACT_CONNECTED)
+		{
+			ble->connected = 1;
+			ble->cmd_mode = 0;
+			ble->advertising = 0;
+			ble->connected_to = act->peer;
+			if (act->peer != NULL)
+			{
+				char status[32];
+				snprintf(status, sizeof(status), "%%CONNECT,0,%s%%", ble->cfg.address);
+				respond(act->peer, status, 0);
+				act->peer->connected = 1;
+				act->peer->advertising = 0;
+				act->peer->connected_to = ble;
+			}
+		}
+		else if (act->kind == SIM_ACT_DIALED && ble->advertising && !ble->connected)
+		{
+			ble->connected = 1;
+			ble->cmd_mode = 0;
+			ble->advertising = 0;
+			respond(ble, "%CONNECT,0,000000000000%", 0);
+		}
+		else if (act->kind == SIM_ACT_DISCONNECTED && ble->connected)
+		{
+			// The RN4871 advertises again after a disconnection.
+			SimBle *peer = ble->connected_to;
+			ble->connected = 0;
+			ble->advertising = 1;
+			ble->connected_to = NULL;
+			respond(ble, "%DISCONNECT%", 0);
+			if (peer != NULL && peer->connected)
+			{
+				peer->connected = 0;
+				peer->advertising = 1;
+				peer->connected_to = NULL;
+				respond(peer, "%DISCONNECT%", 0);
+			}
+		}
+		act->kind = 0;
+	}
+}
+
+// *********** Control Interface *********** //
+SimBle *sim_ble_create(u32 uart_base, const SimBleConfig *config)
+{
+	SimBle *ble = sim_ble_find(uart_base);
+
+	if (ble != NULL)
+	{
+		return ble;
+	}
+	if (num_devices == SIM_BLE_MAX_DEVICES)
+	{
+		return NULL;
+	}
+
+	ble = calloc(1, sizeof(*ble));
+	ble->uart_base = uart_base;
+	ble->cfg = config != NULL ? *config : sim_ble_default_config;
+	devices[num_devices++] = ble;
+
+	SimSource source = { ble_next_event_ns, ble_process, ble };
+	sim_add_source(source);
+	return ble;
+}
+
+SimBle *sim_ble_find(u32 uart_base)
+{
+	for (int i = 0; i < num_devices; i++)
+	{
+		if (devices[i]->uart_base == uart_base)
+		{
+			return devices[i];
+		}
+	}
+	return NULL;
+}
+
+SimBle *sim_ble_of(PmodBLE *InstancePtr)
+{
+	return sim_ble_find(InstancePtr->BLEUart.BaseAddress);
+}
+
+SimBleConfig *sim_ble_config(SimBle *ble)
+{
+	return &ble->cfg;
+}
+
+SimBleStats *sim_ble_stats(SimBle *ble)
+{
+	return &ble->stats;
+}
+
+int sim_ble_in_command_mode(SimBle *ble)
+{
+	return ble->cmd_mode;
+}
+
+int sim_ble_is_connected(SimBle *ble)
+{
+	return ble->connected;
+}
+
+int sim_ble_tx_idle(SimBle *ble)
+{
+	return ble->tx_count == 0;
+}
+
+void sim_ble_connect_irq(SimBle *ble, void (*handler)(void *ref), void *ref)
+{
+	ble->irq_handler = handler;
+	ble->irq_ref = ref;
+}
+
+void sim_ble_link(SimBle *a, SimBle *b)
+{
+	a->link = b;
+	b->link = a;
+}
+
+void sim_ble_peer_send(SimBle *ble, const u8 *data, int len, u32 delay_us)
+{
+	wire_push(ble, data, len, sim_now_ns() + (u64) delay_us * SIM_NS_PER_US);
+}
+
+int sim_ble_peer_take(SimBle *ble, u8 *buf, int max)
+{
+	int n = ble->capture_count < max ? ble->capture_count : max;
+
+	memcpy(buf, ble->capture, n);
+	memmove(ble->capture, ble->capture + n, ble->capture_count - n);
+	ble->capture_count -= n;
+	return n;
+}
+
+void sim_ble_peer_connect(SimBle *ble, u32 delay_us)
+{
+	schedule(ble, SIM_ACT_DIALED, sim_now_ns() + (u64) delay_us * SIM_NS_PER_US, NULL);
+}
+
+void sim_ble_drop_link(SimBle *ble, u32 delay_us)
+{
+	schedule(ble, SIM_ACT_DISCONNECTED, sim_now_ns() + (u64) delay_us * SIM_NS_PER_US, NULL);
+}
+
+// *********** Digilent PmodBLE API *********** //
+void BLE_Begin(PmodBLE *InstancePtr, u32 GPIO_Address, u32 UART_Address, u32 AXI_ClockFreq, u32 UART_Baud)
+{
+	(void) AXI_ClockFreq;
+
+	InstancePtr->GPIO_addr = GPIO_Address;
+	InstancePtr->BLEUart.BaseAddress = UART_Address;
+	InstancePtr->BLEUart.IsReady = XIL_COMPONENT_IS_READY;
+	InstancePtr->BLEUart.Options = XUN_OPTION_FIFOS_ENABLE;
+
+	SimBle *ble = sim_ble_create(UART_Address, NULL);
+	if (ble != NULL)
+	{
+		ble->cfg.baud = UART_Baud;
+		ble->uart_options = InstancePtr->BLEUart.Options;
+	}
+}
+
+void BLE_End(PmodBLE *InstancePtr)
+{
+	InstancePtr->BLEUart.IsReady = 0;
+}
+
+int BLE_SendData(PmodBLE *InstancePtr, u8 *Data, int nData)
+{
+	SimBle *ble = sim_ble_of(InstancePtr);
+	int n = 0;
+
+	sim_advance_ns(ble->cfg.call_ns);
+	ble->stats.send_calls++;
+
+	while (n < nData && ble->tx_count < SIM_BLE_FIFO_DEPTH)
+	{
+		if (ble->tx_count == 0)
+		{
+			ble->tx_done_ns = sim_now_ns() + char_ns(ble);
+		}
+		ble->tx_fifo[(ble->tx_head + ble->tx_count) % SIM_BLE_FIFO_DEPTH] = Data[n++];
+		ble->tx_count++;
+	}
+
+	ble->stats.tx_bytes += n;
+	return n;
+}
+
+int BLE_RecvData(PmodBLE *InstancePtr, u8 *Data, int nData)
+{
+	SimBle *ble = sim_ble_of(InstancePtr);
+	int n = 0;
+
+	sim_advance_ns(ble->cfg.call_ns);
+	ble->stats.recv_calls++;
+
+	while (n < nData && ble->rx_count > 0)
+	{
+		Data[n++] = ble->rx_fifo[ble->rx_head];
+		ble->rx_head = (ble->rx_head + 1) % SIM_BLE_FIFO_DEPTH;
+		ble->rx_count--;
+	}
+
+	ble->stats.rx_bytes += n;
+	return n;
+}
+
+// *********** XUartNs550 *********** //
+int XUartNs550_SetOptions(XUartNs550 *InstancePtr, u16 Options)
+{
+	SimBle *ble = sim_ble_find(InstancePtr->BaseAddress);
+
+	InstancePtr->Options = Options;
+	if (ble != NULL)
+	{
+		ble->uart_options = Options;
+	}
+	sim_advance_ns(ble != NULL ? ble->cfg.call_ns : 0);
+	return XST_SUCCESS;
+}
+
+u16 XUartNs550_GetOptions(XUartNs550 *InstancePtr)
+{
+	return InstancePtr->Options;
+}
+
+int BLE_IsConnected(PmodBLE *InstancePtr)
+{
+	SimBle *ble = sim_ble_of(InstancePtr);
+
+	sim_advance_ns(ble->cfg.call_ns);
+	return ble->connected;
+}
@@ -0,0 +1,218 @@
+/*
+ * sim_bsp.c
+ *
+ *  BSP stand-ins: console output, sleep, register access (including the AXI
+ *  Timer) and the system UART Lite.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "sim_priv.h"
+#include "xil_printf.h"
+#include "sleep.h"
+#include "xil_io.h"
+#include "xuartlite.h"
+#include "xparameters.h"
+#include "xtmrctr_l.h"
+
+// AXI Timer 0 state, see Register Access below.
+static u64 timer_origin_ns = 0;
+static int timer_running = 0;
+
+// AXI Timer 1: a periodic interrupt while enabled with ENIT and ARHT.
+static u32 timer1_csr = 0;
+static u32 timer1_load = 0;
+static u64 timer1_next_ns = SIM_NEVER;
+static void (*timer1_handler)(void *ref) = NULL;
+static void *timer1_ref = NULL;
+
+// *********** Console *********** //
+SimConsoleConfig sim_console_config;
+SimConsoleStats sim_console_stats;
+
+void sim_console_reset()
+{
+	sim_console_config.baud = 115200;
+	sim_console_config.echo = 0;
+	memset(&sim_console_stats, 0, sizeof(sim_console_stats));
+	timer_running = 0;
+}
+
+// *********** AXI Timer 1 Interrupt *********** //
+static u64 timer1_period_ns()
+{
+	// A down counter reloads TLR and interrupts every TLR + 2 clock cycles.
+	return ((u64) timer1_load + 2) * SIM_NS_PER_US / (XPAR_TMRCTR_0_CLOCK_FREQ_HZ / 1000000);
+}
+
+static u64 timer1_next_event(void *ctx)
+{
+	(void) ctx;
+	return timer1_handler != NULL ? timer1_next_ns : SIM_NEVER;
+}
+
+static void timer1_process(void *ctx, u64 now)
+{
+	(void) ctx;
+	timer1_csr |= XTC_CSR_INT_OCCURED_MASK;
+	timer1_next_ns = (timer1_csr & XTC_CSR_AUTO_RELOAD_MASK) ? timer1_next_ns + timer1_period_ns() : SIM_NEVER;
+	timer1_handler(timer1_ref);
+	(void) now;
+}
+
+void sim_timer_reset()
+{
+	timer1_csr = 0;
+	timer1_load = 0;
+	timer1_next_ns = SIM_NEVER;
+	timer1_handler = NULL;
+	timer1_ref = NULL;
+	sim_add_source((SimSource) { timer1_next_event, timer1_process, NULL });
+}
+
+void sim_timer_connect_irq(void (*handler)(void *ref), void *ref)
+{
+	timer1_handler = handler;
+	timer1_ref = ref;
+}
+
+/*
+ * xil_printf blocks on the console UART, so the characters it prints are
+ * charged to the virtual clock at the console baud rate.
+ */
+void xil_printf(const char *fmt, ...)
+{
+	char buf[256];
+	va_list args;
+
+	va_start(args, fmt);
+	int n = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+
+	if (n < 0)
+	{
+		return;
+	}
+	if (n >= (int) sizeof(buf))
+	{
+		n = sizeof(buf) - 1;
+	}
+
+	sim_console_stats.calls++;
+	sim_console_stats.chars += n;
+	if (sim_console_config.echo)
+	{
+		fwrite(buf, 1, n, stdout);
+	}
+	sim_advance_ns(n * sim_uart_char_ns(sim_console_config.baud));
+}
+
+// *********** Sleep *********** //
+int usleep(unsigned long useconds)
+{
+	sim_advance_ns((u64) useconds * SIM_NS_PER_US);
+	return 0;
+}
+
+unsigned sleep(unsigned int seconds)
+{
+	sim_advance_ns((u64) seconds * SIM_NS_PER_S);
+	return 0;
+}
+
+// *********** Register Access *********** //
+// Register writes and reads that are not routed to a device model only cost
+// an AXI-Lite round trip. Timer 0 of the AXI Timer counts the virtual clock.
+#define SIM_AXI_ACCESS_NS 100
+
+static int is_timer0(UINTPTR Addr, u32 offset)
+{
+	return Addr == XPAR_TMRCTR_0_BASEADDR + offset;
+}
+
+static int is_timer1(UINTPTR Addr, u32 offset)
+{
+	return Addr == XPAR_TMRCTR_0_BASEADDR + XTC_TIMER_COUNTER_OFFSET + offset;
+}
+
+void Xil_Out32(UINTPTR Addr, u32 Value)
+{
+	sim_advance_ns(SIM_AXI_ACCESS_NS);
+
+	if (is_timer0(Addr, XTC_TCSR_OFFSET))
+	{
+		if (Value & XTC_CSR_LOAD_MASK)
+		{
+			timer_origin_ns = sim_now_ns();
+		}
+		timer_running = (Value & XTC_CSR_ENABLE_TMR_MASK) != 0;
+	}
+	else if (is_timer1(Addr, XTC_TLR_OFFSET))
+	{
+		timer1_load = Value;
+	}
+	else if (is_timer1(Addr, XTC_TCSR_OFFSET))
+	{
+		// The interrupt bit is cleared by writing a 1 to it.
+		u32 pending = (timer1_csr & ~Value) & XTC_CSR_INT_OCCURED_MASK;
+		u32 was_running = timer1_csr & XTC_CSR_ENABLE_TMR_MASK;
+		timer1_csr = (Value & ~XTC_CSR_INT_OCCURED_MASK) | pending;
+
+		u32 want = XTC_CSR_ENABLE_TMR_MASK | XTC_CSR_ENABLE_INT_MASK;
+		if ((timer1_csr & want) != want)
+		{
+			timer1_next_ns = SIM_NEVER;
+		}
+		else if (!was_running)
+		{
+			timer1_next_ns = sim_now_ns() + timer1_period_ns();
+		}
+	}
+}
+
+u32 Xil_In32(UINTPTR Addr)
+{
+	sim_advance_ns(SIM_AXI_ACCESS_NS);
+
+	if (is_timer0(Addr, XTC_TCR_OFFSET) && timer_running)
+	{
+		u64 ns = sim_now_ns() - timer_origin_ns;
+		return (u32) (ns * (XPAR_TMRCTR_0_CLOCK_FREQ_HZ / 1000000) / SIM_NS_PER_US);
+	}
+	if (is_timer1(Addr, XTC_TCSR_OFFSET))
+	{
+		return timer1_csr;
+	}
+	return 0;
+}
+
+// *********** System UART *********** //
+int XUartLite_Initialize(XUartLite *InstancePtr, u16 DeviceId)
+{
+	(void) DeviceId;
+	InstancePtr->RegBaseAddress = XPAR_AXI_UARTLITE_0_BASEADDR;
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	return XST_SUCCESS;
+}
+
+unsigned int XUartLite_Send(XUartLite *InstancePtr, u8 *DataBufferPtr, unsigned int NumBytes)
+{
+	(void) InstancePtr;
+	sim_console_stats.chars += NumBytes;
+	if (sim_console_config.echo)
+	{
+		fwrite(DataBufferPtr, 1, NumBytes, stdout);
+	}
+	sim_advance_ns(NumBytes * sim_uart_char_ns(sim_console_config.baud));
+	return NumBytes;
+}
+
+unsigned int XUartLite_Recv(XUartLite *InstancePtr, u8 *DataBufferPtr, unsigned int NumBytes)
+{
+	(void) InstancePtr;
+	(void) DataBufferPtr;
+	(void) NumBytes;
+	sim_advance_ns(SIM_AXI_ACCESS_NS);
+	return 0;
+}
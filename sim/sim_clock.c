@@ -0,0 +1,105 @@
+/*
+ * sim_clock.c
+ *
+ *  Virtual clock and event loop of the host simulator.
+ */
+
+#include "sim_priv.h"
+
+#define SIM_MAX_SOURCES 32
+
+static u64 now_ns = 0;
+static SimSource sources[SIM_MAX_SOURCES];
+static int num_sources = 0;
+static int advancing = 0;
+
+u64 sim_now_ns()
+{
+	return now_ns;
+}
+
+void sim_add_source(SimSource source)
+{
+	if (num_sources < SIM_MAX_SOURCES)
+	{
+		sources[num_sources++] = source;
+	}
+}
+
+/*
+ * Moves the clock forward, processing device events in time order.
+ *
+ * NOTE: Costs charged while an event is being processed (e.g. an interrupt
+ *       handler calling back into a device) only move the clock; the events
+ *       they make due are picked up by the outer loop.
+ */
+void sim_advance_ns(u64 ns)
+{
+	u64 target = now_ns + ns;
+
+	if (advancing)
+	{
+		now_ns = target;
+		return;
+	}
+
+	advancing = 1;
+	while (1)
+	{
+		int next = -1;
+		u64 next_ns = SIM_NEVER;
+
+		for (int i = 0; i < num_sources; i++)
+		{
+			u64 t = sources[i].next_event_ns(sources[i].ctx);
+			if (t < next_ns)
+			{
+				next_ns = t;
+				next = i;
+			}
+		}
+
+		if (next < 0 || next_ns > target)
+		{
+			break;
+		}
+
+		if (next_ns > now_ns)
+		{
+			now_ns = next_ns;
+		}
+		sources[next].process(sources[next].ctx, now_ns);
+	}
+
+	if (now_ns < target)
+	{
+		now_ns = target;
+	}
+	advancing = 0;
+}
+
+int sim_run_until(int (*cond)(void *arg), void *arg, u64 limit_ns)
+{
+	u64 end = now_ns + limit_ns;
+
+	while (!cond(arg))
+	{
+		if (now_ns >= end)
+		{
+			return 0;
+		}
+		sim_advance_ns(SIM_NS_PER_US);
+	}
+	return 1;
+}
+
+void sim_reset()
+{
+	num_sources = 0;
+	now_ns = 0;
+	sim_console_reset();
+	sim_timer_reset();
+	sim_ble_reset();
+	sim_kypd_reset();
+	sim_oled_reset();
+}
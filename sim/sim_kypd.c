@@ -0,0 +1,116 @@
+/*
+ * sim_kypd.c
+ *
+ *  Simulated PmodKYPD: key presses are scheduled against the virtual clock
+ *  and KYPD_getKeyStates samples them when it is called.
+ */
+
+#include <string.h>
+#include "sim_priv.h"
+#include "PmodKYPD.h"
+
+#define SIM_KYPD_MAX_PRESSES 256
+#define SIM_KYPD_CHATTER_NS (50 * SIM_NS_PER_US)
+
+typedef struct SimPress {
+	char key;
+	u64 start_ns;
+	u64 end_ns;
+} SimPress;
+
+SimKypdConfig sim_kypd_config;
+
+static SimPress presses[SIM_KYPD_MAX_PRESSES];
+static int num_presses = 0;
+
+void sim_kypd_reset()
+{
+	sim_kypd_config.scan_ns = 8000;
+	sim_kypd_config.bounce_us = 0;
+	num_presses = 0;
+}
+
+void sim_kypd_press(char key, u64 at_ns, u32 hold_us)
+{
+	// Drop presses that have already been released to keep the list short.
+	int n = 0;
+	for (int i = 0; i < num_presses; i++)
+	{
+		if (presses[i].end_ns > sim_now_ns())
+		{
+			presses[n++] = presses[i];
+		}
+	}
+	num_presses = n;
+
+	if (num_presses < SIM_KYPD_MAX_PRESSES)
+	{
+		presses[num_presses].key = key;
+		presses[num_presses].start_ns = at_ns;
+		presses[num_presses].end_ns = at_ns + (u64) hold_us * SIM_NS_PER_US;
+		num_presses++;
+	}
+}
+
+void KYPD_begin(PmodKYPD *InstancePtr, u32 GPIO_Address)
+{
+	InstancePtr->GPIO_addr = GPIO_Address;
+}
+
+void KYPD_loadKeyTable(PmodKYPD *InstancePtr, u8 keytable[16])
+{
+	memcpy(InstancePtr->keytable, keytable, 16);
+}
+
+u16 KYPD_getKeyStates(PmodKYPD *InstancePtr)
+{
+	u64 bounce_ns = (u64) sim_kypd_config.bounce_us * SIM_NS_PER_US;
+	u16 states = 0;
+
+	sim_advance_ns(sim_kypd_config.scan_ns);
+	u64 now = sim_now_ns();
+
+	for (int i = 0; i < num_presses; i++)
+	{
+		SimPress *p = &presses[i];
+		if (now < p->start_ns || now >= p->end_ns)
+		{
+			continue;
+		}
+		// Contacts chatter for bounce_us after they first close.
+		if (now - p->start_ns < bounce_ns && ((now - p->start_ns) / SIM_KYPD_CHATTER_NS) % 2 == 1)
+		{
+			continue;
+		}
+
+		for (int bit = 0; bit < 16; bit++)
+		{
+			if (InstancePtr->keytable[bit] == (u8) p->key)
+			{
+				states |= 1 << bit;
+			}
+		}
+	}
+
+	return states;
+}
+
+XStatus KYPD_getKeyPressed(PmodKYPD *InstancePtr, u16 KeyStates, u8 *cptr)
+{
+	int found = 0;
+
+	for (int bit = 0; bit < 16; bit++)
+	{
+		if (KeyStates & (1 << bit))
+		{
+			if (found)
+			{
+				return KYPD_MULTI_KEY;
+			}
+			*cptr = InstancePtr->keytable[bit];
+			found = 1;
+		}
+	}
+
+	return found ? KYPD_SINGLE_KEY : KYPD_NO_KEY;
+}
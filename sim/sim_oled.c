@@ -0,0 +1,243 @@
+/*
+ * sim_oled.c
+ *
+ *  Simulated PmodOLEDrgb. Each driver call is charged the SPI traffic the
+ *  Digilent driver generates for it, and its pixels are written into a
+ *  shadow of the SSD1331 GDDRAM so benchmarks can check what was drawn.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "sim_priv.h"
+#include "PmodOLEDrgb.h"
+
+#define SIM_OLED_CHAR_W 8
+#define SIM_OLED_CHAR_H 8
+#define SIM_OLED_COLS (OLEDRGB_WIDTH / SIM_OLED_CHAR_W)
+#define SIM_OLED_ROWS (OLEDRGB_HEIGHT / SIM_OLED_CHAR_H)
+
+SimOledConfig sim_oled_config;
+SimOledStats sim_oled_stats;
+
+static u16 gddram[OLEDRGB_HEIGHT][OLEDRGB_WIDTH];
+
+void sim_oled_reset()
+{
+	sim_oled_config.spi_hz = 6250000;
+	sim_oled_config.txn_ns = 4000;
+	sim_oled_config.clear_ns = 400000;
+	sim_oled_config.fill_ns_per_px = 10;
+	memset(&sim_oled_stats, 0, sizeof(sim_oled_stats));
+	memset(gddram, 0, sizeof(gddram));
+}
+
+u16 sim_oled_pixel(int c, int r)
+{
+	if (c < 0 || c >= OLEDRGB_WIDTH || r < 0 || r >= OLEDRGB_HEIGHT)
+	{
+		return 0;
+	}
+	return gddram[r][c];
+}
+
+// One chip-select framed SPI transfer of n bytes, plus busy time.
+static void spi_txn(int n, u64 busy_ns)
+{
+	u64 ns = sim_oled_config.txn_ns + busy_ns
+			+ (u64) n * 8 * SIM_NS_PER_S / sim_oled_config.spi_hz;
+
+	sim_oled_stats.transactions++;
+	sim_oled_stats.bytes += n;
+	sim_oled_stats.busy_ns += ns;
+	sim_advance_ns(ns);
+}
+
+static void plot(int c, int r, u16 color)
+{
+	if (c >= 0 && c < OLEDRGB_WIDTH && r >= 0 && r < OLEDRGB_HEIGHT)
+	{
+		gddram[r][c] = color;
+		sim_oled_stats.pixels++;
+	}
+}
+
+void OLEDrgb_begin(PmodOLEDrgb *InstancePtr, u32 GPIO_Address, u32 SPI_Address)
+{
+	memset(InstancePtr, 0, sizeof(*InstancePtr));
+	InstancePtr->GPIO_addr = GPIO_Address;
+	InstancePtr->SPI_addr = SPI_Address;
+	InstancePtr->m_FontColor = 0xFFFF;
+
+	// Reset pulse, power-up sequence and the initialisation command list.
+	spi_txn(38, 100 * SIM_NS_PER_MS);
+	OLEDrgb_Clear(InstancePtr);
+}
+
+void OLEDrgb_end(PmodOLEDrgb *InstancePtr)
+{
+	(void) InstancePtr;
+	spi_txn(1, 0);
+}
+
+void OLEDrgb_Clear(PmodOLEDrgb *InstancePtr)
+{
+	(void) InstancePtr;
+	memset(gddram, 0, sizeof(gddram));
+	sim_oled_stats.pixels += OLEDRGB_WIDTH * OLEDRGB_HEIGHT;
+	spi_txn(5, sim_oled_config.clear_ns);
+}
+
+void OLEDrgb_DrawPixel(PmodOLEDrgb *InstancePtr, u8 c, u8 r, u16 pixelColor)
+{
+	(void) InstancePtr;
+	plot(c, r, pixelColor);
+	spi_txn(6, 0);	// Column and row window
+	spi_txn(2, 0);	// Pixel data
+}
+
+void OLEDrgb_DrawLine(PmodOLEDrgb *InstancePtr, u8 c1, u8 r1, u8 c2, u8 r2, u16 lineColor)
+{
+	(void) InstancePtr;
+	int x = c1, y = r1;
+	int dx = abs(c2 - c1), sx = c1 < c2 ? 1 : -1;
+	int dy = -abs(r2 - r1), sy = r1 < r2 ? 1 : -1;
+	int err = dx + dy;
+	int n = 0;
+
+	while (1)
+	{
+		plot(x, y, lineColor);
+		n++;
+		if (x == c2 && y == r2)
+		{
+			break;
+		}
+		int e2 = 2 * err;
+		if (e2 >= dy)
+		{
+			err += dy;
+			x += sx;
+		}
+		if (e2 <= dx)
+		{
+			err += dx;
+			y += sy;
+		}
+	}
+
+	spi_txn(8, (u64) n * sim_oled_config.fill_ns_per_px);
+}
+
+void OLEDrgb_DrawRectangle(PmodOLEDrgb *InstancePtr, u8 c1, u8 r1, u8 c2, u8 r2, u16 lineColor, u8 bFill, u16 fillColor)
+{
+	(void) InstancePtr;
+	int n = 0;
+
+	for (int r = r1; r <= r2; r++)
+	{
+		for (int c = c1; c <= c2; c++)
+		{
+			int edge = r == r1 || r == r2 || c == c1 || c == c2;
+			if (edge || bFill)
+			{
+				plot(c, r, edge ? lineColor : fillColor);
+				n++;
+			}
+		}
+	}
+
+	spi_txn(2, 0);	// Fill enable
+	spi_txn(11, (u64) n * sim_oled_config.fill_ns_per_px);
+}
+
+void OLEDrgb_DrawBitmap(PmodOLEDrgb *InstancePtr, u8 c1, u8 r1, u8 c2, u8 r2, u8 *pBmp)
+{
+	(void) InstancePtr;
+	int n = 0;
+
+	for (int r = r1; r <= r2; r++)
+	{
+		for (int c = c1; c <= c2; c++)
+		{
+			plot(c, r, (pBmp[2 * n] << 8) | pBmp[2 * n + 1]);
+			n++;
+		}
+	}
+
+	spi_txn(6, 0);		// Column and row window
+	spi_txn(2 * n, 0);	// Pixel data
+}
+
+void OLEDrgb_SetCursor(PmodOLEDrgb *InstancePtr, int xch, int ych)
+{
+	InstancePtr->xchOledCur = xch;
+	InstancePtr->ychOledCur = ych;
+}
+
+/*
+ * The simulator has no font ROM; a character cell is painted in the
+ * background colour with a glyph-sized block of the font colour so tests
+ * can still see where text landed.
+ */
+void OLEDrgb_PutChar(PmodOLEDrgb *InstancePtr, char ch)
+{
+	if (ch == '\n')
+	{
+		InstancePtr->xchOledCur = 0;
+		InstancePtr->ychOledCur++;
+		return;
+	}
+
+	int x0 = InstancePtr->xchOledCur * SIM_OLED_CHAR_W;
+	int y0 = InstancePtr->ychOledCur * SIM_OLED_CHAR_H;
+	for (int r = 0; r < SIM_OLED_CHAR_H; r++)
+	{
+		for (int c = 0; c < SIM_OLED_CHAR_W; c++)
+		{
+			int ink = ch != ' ' && c > 0 && c < 6 && r > 0 && r < 7;
+			plot(x0 + c, y0 + r, ink ? InstancePtr->m_FontColor : InstancePtr->m_FontBkColor);
+		}
+	}
+	spi_txn(6, 0);
+	spi_txn(2 * SIM_OLED_CHAR_W * SIM_OLED_CHAR_H, 0);
+
+	if (++InstancePtr->xchOledCur >= SIM_OLED_COLS)
+	{
+		InstancePtr->xchOledCur = 0;
+		if (++InstancePtr->ychOledCur >= SIM_OLED_ROWS)
+		{
+			InstancePtr->ychOledCur = 0;
+		}
+	}
+}
+
+void OLEDrgb_PutString(PmodOLEDrgb *InstancePtr, char *sz)
+{
+	while (*sz != '\0')
+	{
+		OLEDrgb_PutChar(InstancePtr, *sz++);
+	}
+}
+
+void OLEDrgb_SetFontColor(PmodOLEDrgb *InstancePtr, u16 fontColor)
+{
+	InstancePtr->m_FontColor = fontColor;
+}
+
+void OLEDrgb_SetFontBkColor(PmodOLEDrgb *InstancePtr, u16 fontBkColor)
+{
+	InstancePtr->m_FontBkColor = fontBkColor;
+}
+
+void OLEDrgb_DefUserChar(PmodOLEDrgb *InstancePtr, char ch, u8 *pbDef)
+{
+	if ((u8) ch < OLEDRGB_USERCHAR_MAX)
+	{
+		memcpy(&InstancePtr->rgbOledRgbFontUser[(u8) ch * OLEDRGB_CHARBYTES], pbDef, OLEDRGB_CHARBYTES);
+	}
+}
+
+u16 OLEDrgb_BuildRGB(u8 R, u8 G, u8 B)
+{
+	return ((R >> 3) << 11) | ((G >> 2) << 5) | (B >> 3);
+}
@@ -0,0 +1,27 @@
+/*
+ * sim_priv.h
+ *
+ *  Hooks shared between the simulator's device models.
+ */
+
+#ifndef SIM_SIM_PRIV_H_
+#define SIM_SIM_PRIV_H_
+
+#include "sim.h"
+
+#define SIM_NEVER (~0ULL)
+
+// Reset hooks, called by sim_reset().
+void sim_console_reset();
+void sim_timer_reset();
+void sim_ble_reset();
+void sim_kypd_reset();
+void sim_oled_reset();
+
+// Time for one UART character (start + 8 data + stop bits).
+static inline u64 sim_uart_char_ns(u32 baud)
+{
+	return (10ULL * SIM_NS_PER_S) / baud;
+}
+
+#endif /* SIM_SIM_PRIV_H_ */
@@ -10,6 +10,19 @@
 #include <stdio.h>
 #include "PmodOLEDrgb.h"
 #include "PmodBLE_Interface.h"
+#include "Timebase.h"
+#include "MoveLink.h"
+#include "LinkSupervisor.h"
+#include "KeypadScan.h"
+#include "OledFb.h"
+#include "TileSprites.h"
+#include "Board.h"
+#include "PerfectPlay.h"
+#include "Ultimate.h"
+#include "Mcts.h"
+#include "MoveLog.h"
+#include "Spectators.h"
+#include "Latency.h"
 
 // Required definitions for sending & receiving data over host board's UART port
 #ifdef __MICROBLAZE__
@@ -28,6 +41,17 @@ typedef XUartPs SysUart;
 #define BT2_UART_AXI_CLOCK_FREQ 100000000
 #endif
 
+// Interrupt controller; the PmodBLE UART interrupt feeds the BLE receive ring
+// and the AXI Timer interrupt drives the keypad scanner
+#ifdef XPAR_INTC_0_DEVICE_ID
+#include "xintc.h"
+#include "xil_exception.h"
+#define INTC_DEVICE_ID          XPAR_INTC_0_DEVICE_ID
+// Interrupt inputs; names depend on the block design (see xparameters.h)
+#define BLE_UART_INTR_ID        XPAR_MICROBLAZE_0_AXI_INTC_PMODBLE_0_BLE_UART_INTERRUPT_INTR
+#define KYPD_TIMER_INTR_ID      XPAR_MICROBLAZE_0_AXI_INTC_AXI_TIMER_0_INTERRUPT_INTR
+#endif
+
 /* ------------------------------------------------------------ */
 /*               Global Variables and Defines                   */
 /* ------------------------------------------------------------ */
@@ -38,8 +62,95 @@ typedef XUartPs SysUart;
 #define O_TILE 2
 PmodKYPD myKypd;
 PmodOLEDrgb oledrgb;
+OledFb oledFb;
 SysUart myUart;
-int board[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+#ifdef XPAR_INTC_0_DEVICE_ID
+XIntc myIntc;
+#endif
+Board board;
+MoveLink moveLink;
+LinkSupervisor linkSupervisor;
+
+// Moves of recent games; with MOVE_LOG_STREAM set the log is also sent out of
+// the system UART as it is written (binary, between the console text)
+#ifndef MOVE_LOG_STREAM
+#define MOVE_LOG_STREAM 0
+#endif
+MoveLog moveLog;
+
+// Spectators: boards that only watch connect to the spare PmodBLE modules, if
+// the hardware design has any, and are sent every move of the 3x3 game.
+// A watching board connects to SPECTATE_ADDR, the address of such a module
+#if defined(XPAR_PMODBLE_2_S_AXI_UART_BASEADDR)
+#define SPECTATOR_MODULES 2
+#elif defined(XPAR_PMODBLE_1_S_AXI_UART_BASEADDR)
+#define SPECTATOR_MODULES 1
+#else
+#define SPECTATOR_MODULES 0
+#endif
+#ifndef SPECTATE_ADDR
+#define SPECTATE_ADDR "000000000000"
+#endif
+Spectators spectators;
+PmodBLE_Interface_t spectatorBle[SPECTATOR_MODULES + 1];
+Spectators_View spectatorView;
+LinkSupervisor spectateSupervisor;
+u8 spectateBleAddress[12 + 1] = SPECTATE_ADDR;
+int watching = 0;
+
+// Game state; changed only by the event handlers below
+#define GAME_PLAYING 0
+#define GAME_OVER 1
+int gameState = GAME_PLAYING;
+int curTile = X_TILE;
+
+// Single player: the other tile is played from the perfect-play table
+// instead of by the other board over BLE; chosen at start up
+int singlePlayer = 0;
+
+// Ultimate tic-tac-toe (single player) against the MCTS opponent. The AI
+// thinks in slices of one loop pass each until its budget is spent; on the
+// host the playout cap ends the search, since simulated time does not pass
+// while it computes
+#define ULTIMATE_AI_NODES 1024
+#define ULTIMATE_AI_BUDGET_US 500000
+#define ULTIMATE_AI_SLICE_US 2000
+#define ULTIMATE_AI_SLICE_PLAYOUTS 64
+#define ULTIMATE_AI_MAX_PLAYOUTS 20000
+int ultimateMode = 0;
+Ultimate ultimate;
+Mcts mcts;
+Mcts_Node mctsPool[ULTIMATE_AI_NODES];
+int aiThinking = 0;
+u8 ultimatePick = ULTIMATE_ANY_BOARD;   // Sub-board picked by a first key
+
+// Display jobs; queued by the game logic and drawn one per loop pass
+#define DISPLAY_QUEUE_LEN 16
+#define JOB_DRAW_BOARD 1
+#define JOB_DRAW_TILE 2
+#define JOB_GAME_OVER 3
+#define JOB_RESET_BOARD 4
+#define JOB_DRAW_MARK 5        // Ultimate: cell is the move
+#define JOB_CLOSE_BOARD 6      // Ultimate: cell is the sub-board won by tile
+#define JOB_HIGHLIGHT 7        // Ultimate: frame where the next move may go
+#define JOB_REDRAW 8           // Whole board from the game state
+
+// First pixel row of the game-over text (text row 1)
+#define GAME_OVER_TEXT_TOP 8
+typedef struct DisplayJob {
+   u8 kind;
+   u8 cell;
+   u8 tile;
+} DisplayJob;
+DisplayJob displayQueue[DISPLAY_QUEUE_LEN];
+int displayHead = 0;
+int displayCount = 0;
+
+// What the panel shows, so a reset repaints only what changed: the tile drawn
+// in each cell, and whether the game-over text covers the board
+int shownBoard[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+int textShown = 0;
+u16 shownHighlight = 0;   // Ultimate: sub-boards with a frame
 
 // Player X
 #define MY_TILE X_TILE
@@ -59,50 +170,136 @@ u8 rgbUserFont[] = {
    0x07, 0x0C, 0xFA, 0x2F, 0x2F, 0xFA, 0x0C, 0x07  // 0x04
 }; // This table defines 5 user characters, although only one is used
 
+/* ------------------------------------------------------------ */
+/*                      Forward Declarations                    */
+/* ------------------------------------------------------------ */
+void EnableCaches();
+void DisableCaches();
+void BoardInit();
+int turnChange(int currentTile);
+int updateBoard(int tile, int row, int col);
+void ResetGame();
+void OledPost(u8 kind, u8 cell, u8 tile);
+void gameOver(PmodOLEDrgb* oled, int tile);
+void ReplayGame();
+void MoveLogBegin();
+void LatencyDump();
+void UltimateKey(char key);
+
 /* ------------------------------------------------------------ */
 /*                         Keypad PMOD                          */
 /* ------------------------------------------------------------ */
+// Scan the keypad from the AXI Timer interrupt so presses made while we draw
+// or talk to the BLE module are queued instead of missed
+void KYPDInterruptInitialize() {
+#ifdef XPAR_INTC_0_DEVICE_ID
+   XIntc_Connect(&myIntc, KYPD_TIMER_INTR_ID,
+      (XInterruptHandler) KeypadScan_TimerHandler, NULL);
+   XIntc_Enable(&myIntc, KYPD_TIMER_INTR_ID);
+   KeypadScan_StartTimer();
+#endif
+}
+
 void KYPDInitialize() {
     KYPD_begin(&myKypd, XPAR_PMODKYPD_0_AXI_LITE_GPIO_BASEADDR);
     KYPD_loadKeyTable(&myKypd, (u8*) DEFAULT_KEYTABLE);
+    Xil_Out32(myKypd.GPIO_addr, 0xF);
+    KeypadScan_Initialize(&myKypd);
+    KYPDInterruptInitialize();
  }
- 
- char KYPDGetKey() {
-   u16 keystate;
-   XStatus status, last_status = KYPD_NO_KEY;
-   u8 key, last_key = 'x';
-   // Initial value of last_key cannot be contained in loaded KEYTABLE string
 
-   Xil_Out32(myKypd.GPIO_addr, 0xF);
+ // Takes the next key press from the scanner's queue; never waits.
+ // Returns the key, or 0 if there is none.
+ char KYPDPollKey() {
+   KeypadScan_Event event;
+
+   // Without the timer interrupt, scan from here
+   KeypadScan_Service();
+
+   while (KeypadScan_Poll(&event)) {
+      if (event.pressed) {
+         LATENCY_MARK_AT(LATENCY_MARK_KEY, event.timestamp);
+         xil_printf("Key pressed: %c\r\n", event.key);
+         return event.key;
+      }
+   }
+   return 0;
+}
+
+ // Waits for the next key press
+ char KYPDGetKey() {
+   KeypadScan_Event event;
 
    while (1) {
-      // Capture state of each key
-      keystate = KYPD_getKeyStates(&myKypd);
+      if (KeypadScan_Wait(&event, Timebase_Deadline(KEYPADSCAN_PERIOD_US)) && event.pressed) {
+         LATENCY_MARK_AT(LATENCY_MARK_KEY, event.timestamp);
+         xil_printf("Key pressed: %c\r\n", event.key);
+         return event.key;
+      }
+   }
+}
 
-      // Determine which single key is pressed, if any
-      status = KYPD_getKeyPressed(&myKypd, keystate, &key);
+// Keypad event handler: a local move, or a key to leave the game over screen
+void KYPDRun() {
+   char key = KYPDPollKey();
+   if (key == 0)
+      return;
 
-      // Print key detect if a new key is pressed or if status has changed
-      if (status == KYPD_SINGLE_KEY
-            && (status != last_status || key != last_key)) {
-         last_key = key;
-         xil_printf("Key pressed: %c\r\n", key);
-         return last_key;
-      } else if (status == KYPD_MULTI_KEY && status != last_status)
-         xil_printf("Error: Multiple keys pressed\r\n");
+   // F sends the latency histograms over the system UART during a game; on
+   // the game over screen it is one of the keys that continue
+   if (key == 'F' && gameState == GAME_PLAYING) {
+      LatencyDump();
+      return;
+   }
 
-      last_status = status;
+   // 0 shows the finished game again from the move log, the other numeric
+   // keys do nothing, and the rest start a new game
+   if (gameState == GAME_OVER) {
+      if (key == '0')
+         ReplayGame();
+      else if (key < '1' || key > '9')
+         ResetGame();
+      return;
+   }
 
-      usleep(1000);
+   if (ultimateMode) {
+      UltimateKey(key);
+      return;
    }
+
+   // Only our own moves come from the keypad
+   int pos = key - '1';
+   if (curTile != MY_TILE || pos < 0 || pos > 8 || Board_TileAt(&board, pos) != BOARD_EMPTY)
+      return;
+
+   // Send before drawing so the other board updates while ours does
+   if (!singlePlayer) {
+      MoveLink_SendMove(&moveLink, pos, curTile);
+      LATENCY_SPAN(LATENCY_KEY_TO_TX, LATENCY_MARK_KEY);
+   }
+   curTile = updateBoard(curTile, pos / 3, pos % 3);
 }
 
 /* ------------------------------------------------------------ */
 /*                            BLE PMOD                          */
 /* ------------------------------------------------------------ */
+// Hook the PmodBLE UART interrupt up to the receive ring so bytes arriving
+// while we draw or scan the keypad are not lost in the UART FIFO
+void BleInterruptInitialize()
+{
+#ifdef XPAR_INTC_0_DEVICE_ID
+   XIntc_Connect(&myIntc, BLE_UART_INTR_ID,
+      (XInterruptHandler) PmodBLE_RxInterruptHandler, NULL);
+   XIntc_Enable(&myIntc, BLE_UART_INTR_ID);
+
+   PmodBLE_EnableRxInterrupt();
+#endif
+}
+
 void BleInitialize()
 {
    PmodBLE_Initialize();
+   BleInterruptInitialize();
    // To get BLE addresses:
    // uint8 address[12] = {0};
    // int status = PmodBLE_GetDeviceAddress(&address);
@@ -111,30 +308,234 @@ void BleInitialize()
    //    OLEDrgb_SetCursor(&oledrgb, 0, 0);
    //    OLEDrgb_PutString(&oledrgb, (char*)address);  // Print response
    // }
-   PmodBLE_ConnectTo(otherBleAddress);
-   while (!PmodBLE_IsConnected) {
-      OLEDrgb_Clear(&oledrgb);
-      OLEDrgb_SetCursor(&oledrgb, 0, 0);
-      OLEDrgb_PutString(&oledrgb, "Connecting to other device..."); 
-   }
+   // The supervisor makes the first connection the way it makes every later
+   // one: the board with the lower address dials, retrying with backoff until
+   // the other board answers, and the other one waits to be dialed
+   LinkSupervisor_Initialize(&linkSupervisor, &moveLink, otherBleAddress);
+   OLEDrgb_Clear(&oledrgb);
+   OLEDrgb_SetCursor(&oledrgb, 0, 0);
+   OLEDrgb_PutString(&oledrgb, "Connecting to other device...");
+   while (!LinkSupervisor_Run(&linkSupervisor))
+      ;
    OLEDrgb_Clear(&oledrgb);
    OLEDrgb_SetCursor(&oledrgb, 0, 0);
    OLEDrgb_PutString(&oledrgb, "Successfully connected!");
    usleep(300000);
 }
 
+// BLE event handler: applies the other player's moves as soon as they arrive.
+// After a link loss the supervisor reconnects and resyncs; moves made
+// meanwhile are sent again then, so play goes on where it stopped
 void BleRun()
 {
-   // u8 buf[1] = 8;
-   // int n;
-
-   // while (1) {
-   //    BT2_SendData(&myBT2, buf, 1);
-   //    n = BT2_RecvData(&myBT2, buf, 1);
-   //    if (n != 0) {
-   //       OLEDrgb_PutString(oled, "Received bluetooth");
-   //    }
-   // }
+   MoveLink_Move move;
+
+   if (singlePlayer || !LinkSupervisor_Run(&linkSupervisor))
+      return;
+
+   // Moves made after the other side left its game over screen wait in the
+   // link until ours is left as well.
+   if (gameState != GAME_PLAYING)
+      return;
+
+   // A move is only taken, and so acked, on the other player's turn; one
+   // sent early waits in the link until ours has been made.
+   if (curTile == MY_TILE || MoveLink_Poll(&moveLink, &move, 1) != 1)
+      return;
+
+   // Anything else means the boards disagree: the move is logged instead of
+   // dropped, and a resync makes the other board resend what we lack.
+   if (move.cell >= 9 || move.tile != curTile || Board_TileAt(&board, move.cell) != BOARD_EMPTY) {
+      xil_printf("BLE: move %d of tile %d to cell %d refused\r\n", move.seq, move.tile, move.cell);
+      MoveLink_Resync(&moveLink);
+      return;
+   }
+   curTile = updateBoard(move.tile, move.cell / 3, move.cell % 3);
+}
+
+/* ------------------------------------------------------------ */
+/*                       Single player                          */
+/* ------------------------------------------------------------ */
+// Start up menu; waits for 1 (against the table), 2 (against the other
+// board over BLE), 3 (ultimate, against the MCTS opponent) or 4 (watch a
+// game played on another board)
+void ChooseMode() {
+   OLEDrgb_Clear(&oledrgb);
+   OLEDrgb_SetCursor(&oledrgb, 0, 1);
+   OLEDrgb_PutString(&oledrgb, "1: 1 player 2: 2 players3: ultimate 4: watch");
+   while (1) {
+      char key = KYPDGetKey();
+      if (key >= '1' && key <= '4') {
+         singlePlayer = key == '1' || key == '3';
+         ultimateMode = key == '3';
+         watching = key == '4';
+         return;
+      }
+   }
+}
+
+void UltimateAiRun();
+
+// Opponent event handler in single player: answers on the other tile's turn
+// with a table lookup, so it never holds up the loop
+void AiRun() {
+   if (ultimateMode) {
+      UltimateAiRun();
+      return;
+   }
+   if (!singlePlayer || gameState != GAME_PLAYING || curTile == MY_TILE)
+      return;
+
+   int pos = PerfectPlay_BestMove(&board, curTile);
+   if (pos >= 0)
+      curTile = updateBoard(curTile, pos / 3, pos % 3);
+}
+
+/* ------------------------------------------------------------ */
+/*                         Spectators                           */
+/* ------------------------------------------------------------ */
+// Seats for watching boards on the spare PmodBLE modules; they advertise
+// from here on
+void SpectatorsInitialize() {
+   Spectators_Initialize(&spectators);
+#if SPECTATOR_MODULES >= 1
+   PmodBLE_Interface_Initialize(&spectatorBle[0], XPAR_PMODBLE_1_S_AXI_GPIO_BASEADDR,
+      XPAR_PMODBLE_1_S_AXI_UART_BASEADDR);
+   Spectators_AddSeat(&spectators, &spectatorBle[0]);
+#endif
+#if SPECTATOR_MODULES >= 2
+   PmodBLE_Interface_Initialize(&spectatorBle[1], XPAR_PMODBLE_2_S_AXI_GPIO_BASEADDR,
+      XPAR_PMODBLE_2_S_AXI_UART_BASEADDR);
+   Spectators_AddSeat(&spectators, &spectatorBle[1]);
+#endif
+}
+
+// Watch mode: connects to the watched board, which starts with a snapshot.
+// The seats there only advertise, so the supervisor always dials, with the
+// same backoff as the link between the players
+void SpectateInitialize() {
+   PmodBLE_Initialize();
+   BleInterruptInitialize();
+   Spectators_ViewInitialize(&spectatorView, PmodBLE_DefaultInterface());
+   LinkSupervisor_InitializeDialer(&spectateSupervisor, PmodBLE_DefaultInterface(), spectateBleAddress);
+   OLEDrgb_Clear(&oledrgb);
+   OLEDrgb_SetCursor(&oledrgb, 0, 0);
+   OLEDrgb_PutString(&oledrgb, "Connecting to game...");
+   while (!LinkSupervisor_Run(&spectateSupervisor))
+      ;
+   OledPost(JOB_DRAW_BOARD, 0, 0);
+}
+
+// Watch mode event handler: draws the watched game's moves as they come.
+// A snapshot (a new game, or the game so far after connecting) is drawn
+// in one job; after a link loss the supervisor connects again and the
+// watched board sends a new one
+void SpectateRun() {
+   Spectators_Event events[4];
+
+   if (!LinkSupervisor_Run(&spectateSupervisor))
+      return;
+
+   int n = Spectators_Watch(&spectatorView, events, 4);
+   for (int i = 0; i < n; i++) {
+      if (events[i].kind == SPECTATORS_EVENT_MOVE) {
+         curTile = updateBoard(events[i].tile, events[i].cell / 3, events[i].cell % 3);
+         continue;
+      }
+      board = events[i].board;
+      curTile = events[i].to_move;
+      gameState = GAME_PLAYING;
+      if (BOARD_OCCUPIED(&board) == 0)
+         MoveLogBegin();
+      OledPost(JOB_REDRAW, 0, 0);
+      int result = Board_Result(&board, turnChange(curTile));
+      if (result != BOARD_RESULT_PLAYING)
+         gameOver(&oledrgb, result);
+   }
+}
+
+/* ------------------------------------------------------------ */
+/*                   Ultimate tic-tac-toe                       */
+/* ------------------------------------------------------------ */
+void UltimateInitialize() {
+   Ultimate_Initialize(&ultimate);
+   Mcts_Initialize(&mcts, mctsPool, ULTIMATE_AI_NODES, Timebase_Ticks());
+   aiThinking = 0;
+   ultimatePick = ULTIMATE_ANY_BOARD;
+}
+
+// Plays a move for the side to move and queues what it changed on screen
+void UltimateMove(int move) {
+   int tile = ultimate.to_move;
+   int sub = move / 9;
+
+   if (!Ultimate_Play(&ultimate, move))
+      return;
+   MoveLog_Append(&moveLog, move);
+   OledPost(JOB_DRAW_MARK, move, tile);
+   // A sub-board can only be played while open, so a line in it is new
+   if (BOARD_IS_WIN(ultimate.cells[tile - 1][sub]))
+      OledPost(JOB_CLOSE_BOARD, sub, tile);
+   OledPost(JOB_HIGHLIGHT, ultimate.next, 0);
+   if (ultimate.result != BOARD_RESULT_PLAYING)
+      gameOver(&oledrgb, ultimate.result);
+}
+
+// Keys in ultimate mode: 1-9 pick the cell in the sub-board we are sent to.
+// When we may play anywhere, the first key picks the sub-board and the
+// second the cell; any other key drops that pick
+void UltimateKey(char key) {
+   int pos = key - '1';
+   if (ultimate.to_move != MY_TILE)
+      return;
+
+   if (pos < 0 || pos > 8) {
+      if (ultimatePick != ULTIMATE_ANY_BOARD) {
+         ultimatePick = ULTIMATE_ANY_BOARD;
+         OledPost(JOB_HIGHLIGHT, ULTIMATE_ANY_BOARD, 0);
+      }
+      return;
+   }
+
+   int sub = ultimate.next != ULTIMATE_ANY_BOARD ? ultimate.next : ultimatePick;
+   if (sub == ULTIMATE_ANY_BOARD) {
+      if (!(ultimate.closed & BOARD_CELL_BIT(pos))) {
+         ultimatePick = pos;
+         OledPost(JOB_HIGHLIGHT, pos, 0);
+      }
+      return;
+   }
+
+   ultimatePick = ULTIMATE_ANY_BOARD;
+   UltimateMove(sub * 9 + pos);
+}
+
+// AI event handler in ultimate mode: one slice of search per call, and the
+// most visited move once the budget is spent
+void UltimateAiRun() {
+   if (gameState != GAME_PLAYING || ultimate.to_move == MY_TILE)
+      return;
+
+   if (!aiThinking) {
+      Mcts_Begin(&mcts, &ultimate);
+      aiThinking = 1;
+   }
+   // A slice that runs nothing will never reach the budget; answer now
+   u32 ran = Mcts_Run(&mcts, ULTIMATE_AI_SLICE_US, ULTIMATE_AI_SLICE_PLAYOUTS);
+   if (ran > 0 && mcts.search_us < ULTIMATE_AI_BUDGET_US && mcts.playouts < ULTIMATE_AI_MAX_PLAYOUTS)
+      return;
+
+   aiThinking = 0;
+   xil_printf("AI: %d playouts in %d us\r\n", (int) mcts.playouts, (int) mcts.search_us);
+   int move = Mcts_BestMove(&mcts);
+   if (move < 0) {
+      // No search result (e.g. the pool is too small); any legal move keeps
+      // the game going
+      u8 legal[ULTIMATE_MOVES];
+      Ultimate_Moves(&ultimate, legal);
+      move = legal[0];
+   }
+   UltimateMove(move);
 }
 
 /* ------------------------------------------------------------ */
@@ -143,14 +544,116 @@ void BleRun()
 void OledInitialize() {
    OLEDrgb_begin(&oledrgb, XPAR_PMODOLEDRGB_0_AXI_LITE_GPIO_BASEADDR,
       XPAR_PMODOLEDRGB_0_AXI_LITE_SPI_BASEADDR);
+   OledFb_Initialize(&oledFb, &oledrgb);
+   displayHead = 0;
+   displayCount = 0;
+}
+
+void DrawX(OledFb* fb, int row, int col, u16 color);
+void DrawO(OledFb* fb, int row, int col, u16 color);
+void DrawGameOver(PmodOLEDrgb* oled, int tile);
+void ResetBoard();
+void DrawMark(OledFb* fb, int move, int tile);
+void DrawClosedBoard(OledFb* fb, int sub, int tile);
+void DrawHighlight(OledFb* fb, u8 sub);
+void RedrawBoard();
+
+// Runs one queued display job; the tiles and grid are drawn into the
+// framebuffer and sent to the panel in one flush at the end
+void OledRunJob(DisplayJob *job) {
+   switch (job->kind) {
+      case JOB_DRAW_BOARD:
+         BoardInit();
+         break;
+      case JOB_DRAW_TILE:
+         if (job->tile == X_TILE)
+            DrawX(&oledFb, job->cell / 3, job->cell % 3, OLEDrgb_BuildRGB(255, 0, 0));
+         else
+            DrawO(&oledFb, job->cell / 3, job->cell % 3, OLEDrgb_BuildRGB(0, 0, 255));
+         shownBoard[job->cell] = job->tile;
+         break;
+      case JOB_GAME_OVER:
+         DrawGameOver(&oledrgb, job->tile);
+         break;
+      case JOB_RESET_BOARD:
+         ResetBoard();
+         break;
+      case JOB_DRAW_MARK:
+         DrawMark(&oledFb, job->cell, job->tile);
+         break;
+      case JOB_CLOSE_BOARD:
+         DrawClosedBoard(&oledFb, job->cell, job->tile);
+         break;
+      case JOB_HIGHLIGHT:
+         DrawHighlight(&oledFb, job->cell);
+         break;
+      case JOB_REDRAW:
+         RedrawBoard();
+         break;
+      default:
+         break;
+   }
+   OledFb_Flush(&oledFb);
+
+   // A tile is on the panel: ours since its key press, the other board's
+   // since it arrived
+   if (job->kind == JOB_DRAW_TILE && !watching) {
+      if (job->tile == MY_TILE)
+         LATENCY_SPAN(LATENCY_KEY_TO_DRAWN, LATENCY_MARK_KEY);
+      else if (!singlePlayer)
+         LATENCY_SPAN(LATENCY_RX_TO_DRAWN, LATENCY_MARK_RX);
+   }
+}
+
+// Queues a display job; if the queue is full the oldest job is drawn first
+void OledPost(u8 kind, u8 cell, u8 tile) {
+   if (displayCount == DISPLAY_QUEUE_LEN) {
+      OledRunJob(&displayQueue[displayHead]);
+      displayHead = (displayHead + 1) % DISPLAY_QUEUE_LEN;
+      displayCount--;
+   }
+   DisplayJob *job = &displayQueue[(displayHead + displayCount) % DISPLAY_QUEUE_LEN];
+   job->kind = kind;
+   job->cell = cell;
+   job->tile = tile;
+   displayCount++;
+}
+
+// Display event handler: draws at most one queued job per call so the keypad
+// and BLE are polled between jobs
+void OledRun() {
+   if (displayCount == 0)
+      return;
+   OledRunJob(&displayQueue[displayHead]);
+   displayHead = (displayHead + 1) % DISPLAY_QUEUE_LEN;
+   displayCount--;
+}
+
+// Draws every queued job
+void OledDrain() {
+   while (displayCount > 0)
+      OledRun();
 }
  
 /* ------------------------------------------------------------ */
 /*                     Set up / Clean up                        */
 /* ------------------------------------------------------------ */
+// Start the interrupt controller; the Pmod initializers connect their handlers
+void InterruptInitialize() {
+#ifdef XPAR_INTC_0_DEVICE_ID
+   XIntc_Initialize(&myIntc, INTC_DEVICE_ID);
+   XIntc_Start(&myIntc, XIN_REAL_MODE);
+
+   Xil_ExceptionInit();
+   Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+      (Xil_ExceptionHandler) XIntc_InterruptHandler, &myIntc);
+   Xil_ExceptionEnable();
+#endif
+}
+
  void Cleanup() {
     DisableCaches();
-    OLED_End(&oledrgb);
+    OLEDrgb_end(&oledrgb);
  }
 
 // Initialize the system UART device
@@ -188,14 +691,81 @@ void SysUartInit() {
  #endif
  }
 
+/* ------------------------------------------------------------ */
+/*                          Move log                            */
+/* ------------------------------------------------------------ */
+void MoveLogSend(const u8 *bytes, int count) {
+   SysUart_Send(&myUart, (u8 *) bytes, count);
+}
+
+// Starts logging a new game of the current mode
+void MoveLogBegin() {
+   if (ultimateMode)
+      MoveLog_BeginGame(&moveLog, MOVELOG_ULTIMATE, ultimate.to_move);
+   else
+      MoveLog_BeginGame(&moveLog, MOVELOG_PLAIN, curTile);
+}
+
+// Rebuilds the state of the latest game from the move log (to review it, or
+// to pick it up again after the state was lost) and draws it in one job,
+// however many moves it took
+void ReplayGame() {
+   MoveLog_Game game;
+   u8 moves[MOVELOG_MAX_MOVES];
+   int n = MoveLog_Read(&moveLog, 0, &game, moves);
+   if (n < 0 || game.variant != (ultimateMode ? MOVELOG_ULTIMATE : MOVELOG_PLAIN))
+      return;
+
+   int result;
+   if (ultimateMode) {
+      Ultimate_Initialize(&ultimate);
+      for (int i = 0; i < n; i++)
+         Ultimate_Play(&ultimate, moves[i]);
+      aiThinking = 0;
+      ultimatePick = ULTIMATE_ANY_BOARD;
+      result = ultimate.result;
+   } else {
+      int tile = game.first_tile;
+      Board_Clear(&board);
+      for (int i = 0; i < n; i++) {
+         Board_Place(&board, tile, moves[i]);
+         tile = turnChange(tile);
+      }
+      curTile = tile;
+      result = Board_Result(&board, turnChange(tile));
+   }
+   gameState = result == BOARD_RESULT_PLAYING ? GAME_PLAYING : GAME_OVER;
+   OledPost(JOB_REDRAW, 0, 0);
+   // The redraw clears the game over text; a finished game gets it back
+   if (gameState == GAME_OVER)
+      OledPost(JOB_GAME_OVER, 0, result);
+}
+
+/* ------------------------------------------------------------ */
+/*                          Latency                             */
+/* ------------------------------------------------------------ */
+// Sends the latency histograms as text over the system UART
+void LatencyDump() {
+   Latency_Dump(MoveLogSend);
+}
+
 /* ------------------------------------------------------------ */
 /*               Auxiliary functions & Main                     */
 /* ------------------------------------------------------------ */
 void ResetGame() {
-   BoardInit();
-   for (int i = 0; i < 9; i++) {
-      board[i] = 0;
+   Board_Clear(&board);
+   gameState = GAME_PLAYING;
+   if (ultimateMode) {
+      // The marks are too many to erase one by one; start from a clean panel
+      UltimateInitialize();
+      MoveLogBegin();
+      OledPost(JOB_DRAW_BOARD, 0, 0);
+      OledPost(JOB_HIGHLIGHT, ULTIMATE_ANY_BOARD, 0);
+      return;
    }
+   MoveLogBegin();
+   Spectators_NewGame(&spectators, curTile);
+   OledPost(JOB_RESET_BOARD, 0, 0);
 }
 
 // Empty board
@@ -207,103 +777,168 @@ void BoardInit() {
    //    OLEDrgb_DefUserChar(&oledrgb, ch, &rgbUserFont[ch * 8]);
    // }
 
-   OLEDrgb_Clear(&oledrgb);
+   OledFb_Clear(&oledFb);
 
    // Set color (white)
    u16 color = OLEDrgb_BuildRGB(255, 255, 255);
 
    // Vertical lines (x = 32, x = 64)
-   OLEDrgb_DrawLine(&oledrgb, 32, 0, 32, 63, color);
-   OLEDrgb_DrawLine(&oledrgb, 64, 0, 64, 63, color);
+   OledFb_DrawLine(&oledFb, 32, 0, 32, 63, color);
+   OledFb_DrawLine(&oledFb, 64, 0, 64, 63, color);
 
    // Horizontal lines (y = 21, y = 42)
-   OLEDrgb_DrawLine(&oledrgb, 0, 21, 95, 21, color);
-   OLEDrgb_DrawLine(&oledrgb, 0, 42, 95, 42, color);
+   OledFb_DrawLine(&oledFb, 0, 21, 95, 21, color);
+   OledFb_DrawLine(&oledFb, 0, 42, 95, 42, color);
+
+   for (int i = 0; i < 9; i++) {
+      shownBoard[i] = 0;
+   }
+   textShown = 0;
+   shownHighlight = 0;
 }
 
-// Draw X
-void DrawX(PmodOLEDrgb* oled, int row, int col, u16 color) {
-   int x0 = col * 32 + 6;
-   int y0 = row * 21 + 4;
-   int x1 = col * 32 + 26;
-   int y1 = row * 21 + 17;
-
-   // Diagonals
-   OLEDrgb_DrawLine(oled, x0, y0, x1, y1, color);
-   OLEDrgb_DrawLine(oled, x0, y1, x1, y0, color);
-
-   board[row*3 + col] = X_TILE;
-}
-
-// Draw circle
-void OLEDrgb_DrawCircle(PmodOLEDrgb* oled, int cx, int cy, int r, u16 color) {
-   int x = 0;
-   int y = r;
-   int d = 1 - r;
-
-   while (x <= y) {
-       // 8-way symmetry
-       OLEDrgb_DrawPixel(oled, cx + x, cy + y, color);
-       OLEDrgb_DrawPixel(oled, cx - x, cy + y, color);
-       OLEDrgb_DrawPixel(oled, cx + x, cy - y, color);
-       OLEDrgb_DrawPixel(oled, cx - x, cy - y, color);
-       OLEDrgb_DrawPixel(oled, cx + y, cy + x, color);
-       OLEDrgb_DrawPixel(oled, cx - y, cy + x, color);
-       OLEDrgb_DrawPixel(oled, cx + y, cy - x, color);
-       OLEDrgb_DrawPixel(oled, cx - y, cy - x, color);
-
-       if (d < 0) {
-           d += 2 * x + 3;
-       } else {
-           d += 2 * (x - y) + 5;
-           y--;
-       }
-       x++;
+// Back to the empty board without blanking the panel: erase the tiles that
+// are shown and give back the grid under the game-over text
+void ResetBoard() {
+   for (int i = 0; i < 9; i++) {
+      if (shownBoard[i] == 0)
+         continue;
+      const OledFb_Sprite *sprite = shownBoard[i] == X_TILE ? &TileSprite_X : &TileSprite_O;
+      int c = (i % 3) * TILESPRITE_CELL_WIDTH + sprite->c;
+      int r = (i / 3) * TILESPRITE_CELL_HEIGHT + sprite->r;
+      OledFb_Erase(&oledFb, c, r, c + sprite->width - 1, r + sprite->height - 1);
+      shownBoard[i] = 0;
+   }
+
+   if (textShown) {
+      OledFb_Repaint(&oledFb, 0, GAME_OVER_TEXT_TOP, OLEDFB_WIDTH - 1, OLEDFB_HEIGHT - 1);
+      textShown = 0;
+   }
+}
+
+// The board drawn from scratch from the game state, in one job: everything
+// goes into the framebuffer first and the job's one flush sends it
+void RedrawBoard() {
+   BoardInit();
+   if (!ultimateMode) {
+      for (int i = 0; i < 9; i++) {
+         shownBoard[i] = Board_TileAt(&board, i);
+         if (shownBoard[i] == X_TILE)
+            DrawX(&oledFb, i / 3, i % 3, OLEDrgb_BuildRGB(255, 0, 0));
+         else if (shownBoard[i] == O_TILE)
+            DrawO(&oledFb, i / 3, i % 3, OLEDrgb_BuildRGB(0, 0, 255));
+      }
+      return;
    }
+
+   for (int sub = 0; sub < 9; sub++) {
+      if (BOARD_IS_WIN(ultimate.cells[0][sub])) {
+         DrawX(&oledFb, sub / 3, sub % 3, OLEDrgb_BuildRGB(255, 0, 0));
+         continue;
+      }
+      if (BOARD_IS_WIN(ultimate.cells[1][sub])) {
+         DrawO(&oledFb, sub / 3, sub % 3, OLEDrgb_BuildRGB(0, 0, 255));
+         continue;
+      }
+      for (int cell = 0; cell < 9; cell++) {
+         if (ultimate.cells[0][sub] & BOARD_CELL_BIT(cell))
+            DrawMark(&oledFb, sub * 9 + cell, X_TILE);
+         else if (ultimate.cells[1][sub] & BOARD_CELL_BIT(cell))
+            DrawMark(&oledFb, sub * 9 + cell, O_TILE);
+      }
+   }
+   if (ultimate.result == BOARD_RESULT_PLAYING)
+      DrawHighlight(&oledFb, ultimate.next);
+}
+
+// Draw X
+void DrawX(OledFb* fb, int row, int col, u16 color) {
+   OledFb_DrawSprite(fb, &TileSprite_X, col * TILESPRITE_CELL_WIDTH,
+      row * TILESPRITE_CELL_HEIGHT, color);
 }
 
 // Draw O
-void DrawO(PmodOLEDrgb* oled, int row, int col, u16 color) {
-   int cx = col * 32 + 16;
-   int cy = row * 21 + 10;
-   int r = 8;
-
-   OLEDrgb_DrawCircle(oled, cx, cy, r, color);
-
-   board[row*3 + col] = O_TILE;
-}
-
-int checkWin(int board[9], int player) {
-   // All 8 possible winning combinations (by index)
-   int wins[8][3] = {
-       {0, 1, 2},  // Row 1
-       {3, 4, 5},  // Row 2
-       {6, 7, 8},  // Row 3
-       {0, 3, 6},  // Col 1
-       {1, 4, 7},  // Col 2
-       {2, 5, 8},  // Col 3
-       {0, 4, 8},  // Diagonal TL–BR
-       {2, 4, 6}   // Diagonal TR–BL
-   };
-
-   for (int i = 0; i < 8; i++) {
-       if (board[wins[i][0]] == player &&
-           board[wins[i][1]] == player &&
-           board[wins[i][2]] == player) {
-           return player;
-       }
+void DrawO(OledFb* fb, int row, int col, u16 color) {
+   OledFb_DrawSprite(fb, &TileSprite_O, col * TILESPRITE_CELL_WIDTH,
+      row * TILESPRITE_CELL_HEIGHT, color);
+}
+
+// Ultimate: each cell of the big grid holds a sub-board of 10x6 pixel cells,
+// inset 2 pixels so a frame fits around them
+#define SUB_CELL_WIDTH 10
+#define SUB_CELL_HEIGHT 6
+#define SUB_INSET 2
+
+// Small X or O in one cell of a sub-board
+void DrawMark(OledFb* fb, int move, int tile) {
+   int sub = move / 9, cell = move % 9;
+   int x = (sub % 3) * TILESPRITE_CELL_WIDTH + SUB_INSET + (cell % 3) * SUB_CELL_WIDTH + 4;
+   int y = (sub / 3) * TILESPRITE_CELL_HEIGHT + SUB_INSET + (cell / 3) * SUB_CELL_HEIGHT + 2;
+
+   if (tile == X_TILE) {
+      u16 color = OLEDrgb_BuildRGB(255, 0, 0);
+      OledFb_DrawLine(fb, x - 2, y - 2, x + 2, y + 2, color);
+      OledFb_DrawLine(fb, x - 2, y + 2, x + 2, y - 2, color);
+   } else {
+      OledFb_DrawCircle(fb, x, y, 2, OLEDrgb_BuildRGB(0, 0, 255));
    }
+}
+
+// A won sub-board is wiped and shows the winner's big tile instead
+void DrawClosedBoard(OledFb* fb, int sub, int tile) {
+   int x = (sub % 3) * TILESPRITE_CELL_WIDTH;
+   int y = (sub / 3) * TILESPRITE_CELL_HEIGHT;
+
+   OledFb_Erase(fb, x + 1, y + 1, x + TILESPRITE_CELL_WIDTH - 1, y + TILESPRITE_CELL_HEIGHT - 1);
+   shownHighlight &= ~BOARD_CELL_BIT(sub);
+   if (tile == X_TILE)
+      DrawX(fb, sub / 3, sub % 3, OLEDrgb_BuildRGB(255, 0, 0));
+   else
+      DrawO(fb, sub / 3, sub % 3, OLEDrgb_BuildRGB(0, 0, 255));
+}
+
+// Frames the sub-board the next move must go to, or every open one (sub is
+// ULTIMATE_ANY_BOARD); only frames that change are touched, and old ones are
+// erased with the panel's fill command so they cost no pixel data
+void DrawHighlight(OledFb* fb, u8 sub) {
+   u16 want = sub == ULTIMATE_ANY_BOARD ? ~ultimate.closed & BOARD_FULL_MASK : BOARD_CELL_BIT(sub);
+   u16 change = want ^ shownHighlight;
+   u16 color = OLEDrgb_BuildRGB(255, 255, 0);
 
    for (int i = 0; i < 9; i++) {
-      if (board[i] == 0)
-         return -1;
+      if (!(change & BOARD_CELL_BIT(i)))
+         continue;
+      int x0 = (i % 3) * TILESPRITE_CELL_WIDTH + 1;
+      int y0 = (i / 3) * TILESPRITE_CELL_HEIGHT + 1;
+      int x1 = x0 + TILESPRITE_CELL_WIDTH - 2;
+      int y1 = y0 + TILESPRITE_CELL_HEIGHT - 2;
+      if (want & BOARD_CELL_BIT(i)) {
+         OledFb_DrawLine(fb, x0, y0, x1, y0, color);
+         OledFb_DrawLine(fb, x0, y1, x1, y1, color);
+         OledFb_DrawLine(fb, x0, y0, x0, y1, color);
+         OledFb_DrawLine(fb, x1, y0, x1, y1, color);
+      } else {
+         OledFb_Erase(fb, x0, y0, x1, y0);
+         OledFb_Erase(fb, x0, y1, x1, y1);
+         OledFb_Erase(fb, x0, y0, x0, y1);
+         OledFb_Erase(fb, x1, y0, x1, y1);
+      }
    }
-
-   return 0;
+   shownHighlight = want;
 }
 
+// Ends the game; a letter key starts a new one, 0 reviews it (see KYPDRun)
 void gameOver(PmodOLEDrgb* oled, int tile) {
-   OLEDrgb_Clear(oled);
+   gameState = GAME_OVER;
+   MoveLog_EndGame(&moveLog);
+   OledPost(JOB_GAME_OVER, 0, tile);
+}
+
+// The text is written straight to the panel over the board, below its first
+// text row; the framebuffer keeps the board, and ResetBoard repaints it there
+void DrawGameOver(PmodOLEDrgb* oled, int tile) {
+   OLEDrgb_DrawRectangle(oled, 0, GAME_OVER_TEXT_TOP, OLEDFB_WIDTH - 1, OLEDFB_HEIGHT - 1, 0, 1, 0);
+   textShown = 1;
 
    char* winnerLine;
    if (tile == X_TILE)
@@ -313,45 +948,27 @@ void gameOver(PmodOLEDrgb* oled, int tile) {
    else
       winnerLine = "It's a tie!\n";
 
-   // Compute centered column
-   int col1 = (16 - 10) / 2;
-   int col2 = (16 - 12) / 2;
-   int col3 = (16 - 26) / 2;
-
    // Choose vertical rows
    OLEDrgb_SetCursor(oled, 0, 1);
    OLEDrgb_PutString(oled, " Game Over!\n");
    OLEDrgb_SetCursor(oled, 0, 2);
    OLEDrgb_PutString(oled, winnerLine);
    OLEDrgb_SetCursor(oled, 0, 4);
-   OLEDrgb_PutString(oled, "Press any   non-numeric key to      continue.");
-
-   // Get key
-   KYPDGetKey();
-   ResetGame();
+   OLEDrgb_PutString(oled, "0: review   A-F: new    game");
 }
 
  // Update board, returns next tile
  int updateBoard(int tile, int row, int col) {
-   u16 red = OLEDrgb_BuildRGB(255, 0, 0);
-   u16 blue = OLEDrgb_BuildRGB(0, 0, 255);
-    // Display new board
-   if(board[3*row+col] != 0){
+   if(!Board_Place(&board, tile, 3*row+col)){
 	   return tile;
    }
-    switch (tile) {
-      case X_TILE:
-         DrawX(&oledrgb, row, col, red);
-         break;
-      case O_TILE:
-         DrawO(&oledrgb, row, col, blue);
-         break;
-      default:
-         break;
-    }
+    MoveLog_Append(&moveLog, 3*row+col);
+    Spectators_Publish(&spectators, 3*row+col, tile);
+    // Queue the new tile for display
+    OledPost(JOB_DRAW_TILE, 3*row+col, tile);
     // Check for win condition
-    int winner = checkWin(board, tile);
-    if (winner >= 0)
+    int winner = Board_Result(&board, tile);
+    if (winner != BOARD_RESULT_PLAYING)
       gameOver(&oledrgb, winner);
     return turnChange(tile);
  }
@@ -366,52 +983,46 @@ void gameOver(PmodOLEDrgb* oled, int tile) {
 int main() {
     // Initialize all peripherals
     EnableCaches(); // pulled it out of pmod initializations so only runs once
+    Timebase_Initialize();
+    InterruptInitialize();
     KYPDInitialize();
     OledInitialize();
-    BleInitialize();
-    BoardInit();
+    ChooseMode();
+    MoveLink_Initialize(&moveLink);
+    MoveLog_Initialize(&moveLog);
+    if (watching) {
+       SpectateInitialize();
+       while (1) {
+          SpectateRun();
+          OledRun();
+       }
+    }
+    if (!singlePlayer)
+       BleInitialize();
+    SpectatorsInitialize();
+    // The latency dump (F) uses the system UART whether or not the move log
+    // streams out of it
+    SysUartInit();
+#if MOVE_LOG_STREAM
+    MoveLog_SetSink(&moveLog, MoveLogSend);
+#endif
 
-    int curTile = X_TILE;
+    curTile = X_TILE;
+    if (ultimateMode) {
+       ResetGame();
+    } else {
+       OledPost(JOB_DRAW_BOARD, 0, 0);
+       MoveLogBegin();
+       Spectators_NewGame(&spectators, curTile);
+    }
 
+    // Event loop; every handler returns without waiting
     while(1) {
-         // OledRun();
-        // Get move
-        char key = KYPDGetKey();
-        int pos = key - '0';
-        switch (pos) {
-         case 1:
-            curTile = updateBoard(curTile, 0, 0);
-            break;
-         case 2:
-        	 curTile = updateBoard(curTile, 0, 1);
-            break;
-         case 3:
-        	 curTile = updateBoard(curTile, 0, 2);
-            break;
-         case 4:
-        	 curTile = updateBoard(curTile, 1, 0);
-            break;
-         case 5:
-        	 curTile = updateBoard(curTile, 1, 1);
-            break;
-         case 6:
-        	 curTile = updateBoard(curTile, 1, 2);
-            break;
-         case 7:
-        	 curTile = updateBoard(curTile, 2, 0);
-            break;
-         case 8:
-        	 curTile = updateBoard(curTile, 2, 1);
-            break;
-         case 9:
-        	 curTile = updateBoard(curTile, 2, 2);
-            break;
-         default:
-            break;
-        }
-        // Update board
-        // Wait for other move
-        // Update board
+        KYPDRun();
+        BleRun();
+        AiRun();
+        OledRun();
+        Spectators_Run(&spectators);
     }
     Cleanup();
     return 0;